@@ -4,7 +4,9 @@ CPP_SOURCES := \
 	./gb4xbee.cpp \
 	./xbee_notify.cpp \
 	./gb4mqtt.cpp \
+	./mqtt5_packet.cpp \
 	./main.cpp \
+	./stack_monitor.cpp \
 
 HEADERS := ./
 
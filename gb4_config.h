@@ -0,0 +1,72 @@
+/**
+ * gb4_config.h
+ * Buffer sizes of GB4MQTT and GB4XBee, and the blocks of the GB4MQTT payload
+ * pool, chosen for the whole build at compile time. A build picks a GB4Config
+ * by defining GB4_CONFIG as its type, such as GB4_CONFIG="GB4SmallConfig" or
+ * GB4_CONFIG="GB4Config<64,128,64,1500,16,4,0>" in SYMBOLS, and gets
+ * GB4DefaultConfig otherwise. The sizes are checked against each other when
+ * the configuration is used, and gb4mqtt.h and gb4mqtt.cpp check that the
+ * largest message fits in the payload pool, and its PUBLISH packet in an XBee
+ * message.
+ */
+
+#ifndef GB4_CONFIG_H
+#define GB4_CONFIG_H
+
+#include <cstddef>
+
+/**
+ *	@tparam MQTT_MAX_PACKET - Largest MQTT packet accepted from the broker,
+ *	                          which it is told on connecting
+ *	@tparam MQTT_MESSAGE_MAX - Largest message that can be published
+ *	@tparam XBEE_RECEIVE_PAYLOAD - Size of the buffer data received on the
+ *	                               XBee socket is kept in until it is read
+ *	@tparam XBEE_MESSAGE_MAX - Largest message GB4XBee sends on the socket
+ *	                           at once
+ *	@tparam PAYLOAD_SMALL - Number of 64 byte blocks in the payload pool
+ *	@tparam PAYLOAD_MEDIUM - Number of 256 byte blocks in the payload pool
+ *	@tparam PAYLOAD_LARGE - Number of 1024 byte blocks in the payload pool.
+ *	                        A class given no blocks takes up no RAM, but the
+ *	                        largest message must fit in a class that has some
+ */
+template <
+	size_t MQTT_MAX_PACKET,
+	size_t MQTT_MESSAGE_MAX,
+	size_t XBEE_RECEIVE_PAYLOAD,
+	size_t XBEE_MESSAGE_MAX,
+	size_t PAYLOAD_SMALL,
+	size_t PAYLOAD_MEDIUM,
+	size_t PAYLOAD_LARGE>
+class GB4Config {
+	public:
+	static size_t constexpr MQTT_MAX_PACKET_SIZE = MQTT_MAX_PACKET;
+	static size_t constexpr MQTT_MESSAGE_MAX_SIZE = MQTT_MESSAGE_MAX;
+	static size_t constexpr XBEE_RECEIVE_PAYLOAD_SIZE = XBEE_RECEIVE_PAYLOAD;
+	static size_t constexpr XBEE_MESSAGE_MAX_SIZE = XBEE_MESSAGE_MAX;
+	static size_t constexpr PAYLOAD_SMALL_BLOCKS = PAYLOAD_SMALL;
+	static size_t constexpr PAYLOAD_MEDIUM_BLOCKS = PAYLOAD_MEDIUM;
+	static size_t constexpr PAYLOAD_LARGE_BLOCKS = PAYLOAD_LARGE;
+
+	static_assert(
+		XBEE_RECEIVE_PAYLOAD_SIZE >= MQTT_MAX_PACKET_SIZE,
+		"XBEE_RECEIVE_PAYLOAD must hold the largest packet from the broker");
+	static_assert(
+		XBEE_RECEIVE_PAYLOAD_SIZE <= XBEE_MESSAGE_MAX_SIZE,
+		"XBEE_RECEIVE_PAYLOAD must not exceed XBEE_MESSAGE_MAX");
+};
+
+//Sizes GB4MQTT and GB4XBee have always had
+typedef GB4Config<128, 900, 300, 1500, 16, 8, 4> GB4DefaultConfig;
+//Devices that only publish short messages, such as single reports, which
+//	never need a large block
+typedef GB4Config<64, 128, 64, 1500, 16, 4, 0> GB4SmallConfig;
+//Gateways that publish the largest batches the payload pool holds
+typedef GB4Config<1024, 1024, 1024, 1500, 16, 8, 4> GB4GatewayConfig;
+
+#ifdef GB4_CONFIG
+typedef GB4_CONFIG GB4BuildConfig;
+#else
+typedef GB4DefaultConfig GB4BuildConfig;
+#endif //GB4_CONFIG
+
+#endif //GB4_CONFIG_H
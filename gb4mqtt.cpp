@@ -4,6 +4,27 @@
 
 #include "gb4mqtt.h"
 
+static uint8_t constexpr PINGREQ_PACKET[] = {PINGREQ << 4, 0x00};
+static uint8_t constexpr DISCONNECT_PACKET[] = {DISCONNECT << 4, 0x00};
+//Fixed header (1) + remaining length (up to 4) + packet ID (2)
+static size_t constexpr PUBLISH_HEADER_SIZE = 7;
+static_assert(
+	(PUBLISH_HEADER_SIZE +
+	MQTTTopicRegistry::TOPIC_HEADER_SIZE +
+	MQTTV5_PUBLISH_PROPERTIES_MAX_SIZE +
+	MQTTRequest::MESSAGE_MAX_SIZE) <= GB4XBEE_RECEIVED_MESSAGE_MAX_SIZE,
+	"The largest PUBLISH packet must fit in an XBee message");
+//A stored publish keeps its topic ID, QoS, priority class and disconnect
+//	flag in the tag of its record
+static uint16_t constexpr STORE_TAG_TOPIC_MASK = 0x07;
+static uint8_t constexpr STORE_TAG_QOS_SHIFT = 3;
+static uint8_t constexpr STORE_TAG_PRIORITY_SHIFT = 5;
+static uint16_t constexpr STORE_TAG_DISCONNECT = 1 << 7;
+//The record itself starts with the expiry interval of the publish, and the
+//	millis() time it was made at, ahead of the message
+static size_t constexpr STORE_RECORD_HEADER_SIZE =
+	sizeof(uint32_t) + sizeof(int32_t);
+
 GB4MQTT::GB4MQTT(
 	uint32_t radio_baud,
 	char const *radio_apn,
@@ -22,8 +43,34 @@ GB4MQTT::GB4MQTT(
 {
 	connect_start_time = 0;
 	allow_connect = false;
+	session_retries = 0;
+	linger_interval = GB4MQTT_DEFAULT_LINGER_INTERVAL;
+	linger_start_time = 0;
+	linger_pending = false;
+	prewarm_interval = GB4MQTT_DEFAULT_PREWARM_INTERVAL;
+	scheduled_publish_time = 0;
+	scheduled_priority = MQTTPriority::NORMAL;
+	publish_scheduled = false;
+	protocol_version = GB4MQTT_MQTT_VERSION_3_1_1;
+	message_expiry = GB4MQTT_DEFAULT_MESSAGE_EXPIRY;
+	send_quota = MQTTV5ConnackProperties::DEFAULT_RECEIVE_MAXIMUM;
+	topic_alias_maximum = 0;
+	topic_alias_sent = 0;
+	maximum_qos = 2;
+	maximum_packet_size = 0;
+	coalesce_topics = 0;
+	coalesced_count = 0;
+	expired_count = 0;
+	failed_count = 0;
+	bytes_sent = 0;
+	publishes_sent = 0;
+	budget_refused_count = 0;
+	m_publish_request = nullptr;
+	m_store = nullptr;
+	m_store_pending = false;
 	state = State::INIT;
 	err = 0;
+	buildConnectPacket();
 }
 
 
@@ -48,11 +95,39 @@ bool GB4MQTT::begin()
 
 
 /**
- *	Enqueue a message to publish. The message will be sent via the state
- *		machine in subsequent calls to GB4MQTT::poll().
- *	Note (1st March 2021): Because of reasons, only one message can be enqueued
+ *	Register a publish topic. The topic is stored and encoded once, and
+ *	publish requests refer to it by the returned ID.
  *	@param topic - Publish topic string
  *	@param topic_len - Length of topic in bytes
+ *	@param topic_id - Output - ID to pass to GB4MQTT::publish()
+ *	@return
+ *		GB4MQTT::Return::TOPIC_REGISTRY_FULL - The topic is too long, or
+ *		                                       GB4MQTT_MAX_TOPICS topics have
+ *		                                       already been registered
+ *		GB4MQTT::Return::TOPIC_REGISTERED
+ */
+GB4MQTT::Return GB4MQTT::registerTopic(
+	char const topic[],
+	size_t topic_len,
+	uint8_t *topic_id)
+{
+	*topic_id = m_topics.add(topic, topic_len);
+	if(MQTTTopicRegistry::INVALID_ID == *topic_id)
+	{
+		return Return::TOPIC_REGISTRY_FULL;
+	}
+	return Return::TOPIC_REGISTERED;
+}
+
+
+/**
+ *	Enqueue a message to publish. The message will be sent via the state
+ *		machine in subsequent calls to GB4MQTT::poll().
+ *	Up to GB4MQTT_MAX_QUEUE_DEPTH messages are queued per priority class.
+ *	Higher classes are sent first, and each class is sent in order.
+ *	On a topic set to coalesce with GB4MQTT::setCoalescing(), the message
+ *	replaces a queued one on the same topic that has not been sent yet.
+ *	@param topic_id - Publish topic ID given by GB4MQTT::registerTopic()
  *	@param message - Message to publish
  *	@param message_len - Length of message in bytes
  *	@param qos - Publish Quality of Serice
@@ -62,9 +137,511 @@ bool GB4MQTT::begin()
  *	@param disconnect - Indicates to the state machine whether or not the
  *	                    connection should be terminated after the publish
  *	                    request has been sent
- *	             true - Disconnect after publish
+ *	             true - Disconnect after publish, once the linger interval
+ *	                    set with GB4MQTT::setLinger() has elapsed
  *	            false - Stay connected a after publish
- *	@return GB4MQTT::Return::PUBLISH_QUEUED
+ *	@param priority - Priority class. See MQTTPriority
+ *	@param expiry - Seconds after which the message is dropped if it hasn't
+ *	                been sent, or acknowledged. 0 never expires. See
+ *	                GB4MQTT::setMessageExpiry()
+ *	@return
+ *		GB4MQTT::Return::TOPIC_UNKNOWN - topic_id was not registered
+ *		GB4MQTT::Return::PUBLISH_PACKET_ERROR - The message is larger than
+ *		                                        MQTTRequest::MESSAGE_MAX_SIZE
+ *		GB4MQTT::Return::PUBLISH_QUEUE_FULL - GB4MQTT_MAX_QUEUE_DEPTH messages
+ *		                                      of the priority class are
+ *		                                      already waiting, or the
+ *		                                      payload pool has no block
+ *		                                      for the message
+ *		GB4MQTT::Return::PUBLISH_BUDGET_EXHAUSTED - The priority class has used
+ *		                                            up its budget. See
+ *		                                            GB4MQTT::setBudget()
+ *		GB4MQTT::Return::PUBLISH_COALESCED - The message replaced a queued one
+ *		GB4MQTT::Return::PUBLISH_STORED - The message was kept in the store
+ *		                                  given to GB4MQTT::setStore()
+ *		GB4MQTT::Return::PUBLISH_QUEUED
+ */
+GB4MQTT::Return GB4MQTT::publish(
+	uint8_t topic_id,
+	uint8_t const message[],
+	size_t message_len,
+	uint8_t qos, 
+	bool disconnect,
+	MQTTPriority priority,
+	uint32_t expiry)
+{
+	if(false == m_topics.isValid(topic_id))
+	{
+		return Return::TOPIC_UNKNOWN;
+	}
+	if(message_len > MQTTRequest::MESSAGE_MAX_SIZE)
+	{
+		return Return::PUBLISH_PACKET_ERROR;
+	}
+	return queuePublishRequest(
+		topic_id,
+		message,
+		message_len,
+		qos,
+		disconnect,
+		priority,
+		expiry,
+		true);
+}
+
+
+/**
+ *	Enqueue a message to publish without copying it. The buffer is sent from
+ *	directly, so it must not be changed until GB4MQTT::isBufferInUse()
+ *	returns false for it. See GB4MQTT::publish(uint8_t, ...)
+ */
+GB4MQTT::Return GB4MQTT::publishBuffer(
+	uint8_t topic_id,
+	uint8_t const message[],
+	size_t message_len,
+	uint8_t qos,
+	bool disconnect,
+	MQTTPriority priority,
+	uint32_t expiry)
+{
+	if(false == m_topics.isValid(topic_id))
+	{
+		return Return::TOPIC_UNKNOWN;
+	}
+	if(message_len > MQTTRequest::MESSAGE_MAX_SIZE)
+	{
+		return Return::PUBLISH_PACKET_ERROR;
+	}
+	return queuePublishRequest(
+		topic_id,
+		message,
+		message_len,
+		qos,
+		disconnect,
+		priority,
+		expiry,
+		false);
+}
+
+
+/**
+ *	Queue a publish request for a message already checked by
+ *	GB4MQTT::publish() or GB4MQTT::publishBuffer(), or coalesce it into a
+ *	queued request on the same topic. A new request is charged to the budget
+ *	of its priority class, while a coalesced one takes the place, and the
+ *	budget, of the request it replaces. A request that can't be queued goes
+ *	to the store, if there is one. See GB4MQTT::setStore()
+ *	@param message - Message to publish
+ *	@param expiry - Expiry interval in seconds, or GB4MQTT_USE_DEFAULT_EXPIRY
+ *	@param copy - true - Copy message into a block of the payload pool
+ *	              false - Send from message directly. It belongs to the caller
+ *	@return
+ *		GB4MQTT::Return::PUBLISH_QUEUE_FULL
+ *		GB4MQTT::Return::PUBLISH_BUDGET_EXHAUSTED
+ *		GB4MQTT::Return::PUBLISH_COALESCED
+ *		GB4MQTT::Return::PUBLISH_STORED
+ *		GB4MQTT::Return::PUBLISH_QUEUED
+ */
+GB4MQTT::Return GB4MQTT::queuePublishRequest(
+	uint8_t topic_id,
+	uint8_t const message[],
+	size_t message_len,
+	uint8_t qos,
+	bool disconnect,
+	MQTTPriority priority,
+	uint32_t expiry,
+	bool copy)
+{
+	if(GB4MQTT_USE_DEFAULT_EXPIRY == expiry)
+	{
+		expiry = message_expiry;
+	}
+	//Make room for the request by dropping requests that have expired
+	dropExpiredRequests();
+	Return status = Return::PUBLISH_COALESCED;
+	uint8_t *block = nullptr;
+	MQTTRequest *req = findCoalescableRequest(topic_id, priority);
+	if(nullptr != req)
+	{
+		//The replaced request was paid for at its own length, so only the
+		//	difference is charged, or given back
+		size_t p = static_cast<size_t>(priority);
+		size_t header_len =
+			PUBLISH_HEADER_SIZE +
+			m_topics.headerLength(topic_id) +
+			MQTTV5_PUBLISH_PROPERTIES_MAX_SIZE;
+		uint32_t cost = linkCost(header_len + message_len);
+		uint32_t paid = linkCost(header_len + req->message_len);
+		if((cost > paid) && (false == m_byte_budgets[p].has(cost - paid)))
+		{
+			budget_refused_count++;
+			return Return::PUBLISH_BUDGET_EXHAUSTED;
+		}
+		//The replaced request was never sent, so its packet ID and its
+		//	place in the queue are reused, and so is its block if the message
+		//	fits in it
+		if(true == copy)
+		{
+			block = req->message;
+			if(
+				(nullptr == block) ||
+				(false == m_payloads.resize(block, message_len)))
+			{
+				block = m_payloads.allocate(message_len);
+				if(nullptr == block)
+				{
+					return Return::PUBLISH_QUEUE_FULL;
+				}
+			}
+		}
+		if(cost > paid)
+		{
+			m_byte_budgets[p].take(cost - paid);
+		}
+		else
+		{
+			m_byte_budgets[p].give(paid - cost);
+		}
+		coalesced_count++;
+	}
+	else
+	{
+		size_t p = static_cast<size_t>(priority);
+		//Running out of blocks is the same as running out of slots
+		bool full =
+			(true == m_publish_queues[p].isFull()) ||
+			((true == copy) && (false == m_payloads.canAllocate(message_len)));
+		//Alarms don't wait behind a backlog in the store
+		bool store =
+			(nullptr != m_store) &&
+			((true == full) ||
+			((MQTTPriority::ALARM != priority) &&
+			(false == m_store->isEmpty())));
+		if((false == store) && (true == full))
+		{
+			return Return::PUBLISH_QUEUE_FULL;
+		}
+		//The first transmission is paid for up front, at its largest
+		uint32_t cost = linkCost(
+			PUBLISH_HEADER_SIZE +
+			m_topics.headerLength(topic_id) +
+			MQTTV5_PUBLISH_PROPERTIES_MAX_SIZE +
+			message_len);
+		if(
+			(false == m_byte_budgets[p].has(cost)) ||
+			(false == m_message_budgets[p].has(1)))
+		{
+			budget_refused_count++;
+			return Return::PUBLISH_BUDGET_EXHAUSTED;
+		}
+		if(true == store)
+		{
+			status = storePublishRequest(
+				topic_id,
+				message,
+				message_len,
+				qos,
+				disconnect,
+				priority,
+				expiry);
+			if(Return::PUBLISH_STORED == status)
+			{
+				m_byte_budgets[p].take(cost);
+				m_message_budgets[p].take(1);
+				linger_pending = false;
+				if(priority == scheduled_priority)
+				{
+					publish_scheduled = false;
+				}
+			}
+			return status;
+		}
+		if(true == copy)
+		{
+			block = m_payloads.allocate(message_len);
+			if(nullptr == block)
+			{
+				return Return::PUBLISH_QUEUE_FULL;
+			}
+		}
+		//Built in its slot, rather than copied in
+		req = m_publish_queues[p].emplace();
+		if(nullptr == req)
+		{
+			m_payloads.free(block);
+			return Return::PUBLISH_QUEUE_FULL;
+		}
+		m_byte_budgets[p].take(cost);
+		m_message_budgets[p].take(1);
+		req->packet_id = packet_id.get_next();
+		req->priority = priority;
+		status = Return::PUBLISH_QUEUED;
+	}
+
+	if(true == copy)
+	{
+		memcpy(block, message, message_len);
+		message = block;
+	}
+	if(block != req->message)
+	{
+		releasePayload(*req);
+		req->message = block;
+	}
+	req->topic_id = topic_id;
+	req->payload = message;
+	req->message_len = message_len;
+	req->qos = qos;
+	req->retain = 0;
+	req->duplicate = 0;
+	req->start_time = millis();
+	req->queue_time = req->start_time;
+	req->expiry_interval = expiry;
+	req->tries = 0;
+	req->in_flight = false;
+	req->disconnect = disconnect;
+	req->got_puback = false;
+	req->ready_to_send = true;
+	req->active = true;
+	linger_pending = false;
+	if(priority == scheduled_priority)
+	{
+		publish_scheduled = false;
+	}
+	
+	return status;	
+}
+
+
+/**
+ *	Find a queued publish request that a new publish on the topic may replace
+ *	@param topic_id - Topic of the new publish
+ *	@param priority - Priority class of the new publish. Only requests of the
+ *	                  same class are replaced
+ *	@return
+ *		nullptr - The topic doesn't coalesce, or every queued request on it
+ *		          has been sent at least once, or came from the store
+ *		Otherwise, the request to replace
+ */
+MQTTRequest *GB4MQTT::findCoalescableRequest(
+	uint8_t topic_id,
+	MQTTPriority priority)
+{
+	if(0 == (coalesce_topics & (1 << topic_id)))
+	{
+		return nullptr;
+	}
+	return m_publish_queues.findCoalescable(
+		topic_id,
+		static_cast<size_t>(priority));
+}
+
+
+/**
+ *	Check if any publish request is queued, in any priority class, or stored
+ */
+bool GB4MQTT::hasPublishRequests()
+{
+	if((nullptr != m_store) && (false == m_store->isEmpty()))
+	{
+		return true;
+	}
+	return false == m_publish_queues.isEmpty();
+}
+
+
+/**
+ *	Drop the queued publish requests that have expired. The request being
+ *	sent is left to GB4MQTT::handlePublishRequests(), which checks it before
+ *	every transmission.
+ */
+void GB4MQTT::dropExpiredRequests()
+{
+	int32_t now = millis();
+	MQTTRequest *req;
+	while(
+		nullptr !=
+		(req = m_publish_queues.removeExpired(now, m_publish_request)))
+	{
+		releaseStoredRequest(*req);
+		releasePayload(*req);
+		expired_count++;
+	}
+}
+
+
+/**
+ *	Append a publish request that can't be queued to the store, along with
+ *	its expiry interval and the time it was made at, so that it still
+ *	expires while it is stored
+ *	@param expiry - Expiry interval in seconds. 0 never expires
+ *	@return
+ *		GB4MQTT::Return::PUBLISH_QUEUE_FULL - The store is full, or can't be
+ *		                                      written
+ *		GB4MQTT::Return::PUBLISH_STORED
+ */
+GB4MQTT::Return GB4MQTT::storePublishRequest(
+	uint8_t topic_id,
+	uint8_t const message[],
+	size_t message_len,
+	uint8_t qos,
+	bool disconnect,
+	MQTTPriority priority,
+	uint32_t expiry)
+{
+	uint8_t record[STORE_RECORD_HEADER_SIZE + MQTTRequest::MESSAGE_MAX_SIZE];
+	int32_t queue_time = millis();
+	memcpy(&record[0], &expiry, sizeof expiry);
+	memcpy(&record[sizeof expiry], &queue_time, sizeof queue_time);
+	memcpy(&record[STORE_RECORD_HEADER_SIZE], message, message_len);
+	uint16_t tag =
+		(topic_id & STORE_TAG_TOPIC_MASK) |
+		((qos & 0x03) << STORE_TAG_QOS_SHIFT) |
+		(static_cast<uint16_t>(priority) << STORE_TAG_PRIORITY_SHIFT);
+	if(true == disconnect)
+	{
+		tag |= STORE_TAG_DISCONNECT;
+	}
+	FlashQueue::Return r = m_store->push(
+		tag,
+		record,
+		STORE_RECORD_HEADER_SIZE + message_len);
+	if(FlashQueue::Return::RECORD_ADDED != r)
+	{
+		return Return::PUBLISH_QUEUE_FULL;
+	}
+	return Return::PUBLISH_STORED;
+}
+
+
+/**
+ *	Queue the publish request at the front of the store, unless one from the
+ *	store is already queued, or its priority class or the payload pool has no
+ *	room. Records that are corrupt, or that name a topic that is no longer
+ *	registered, are dropped, and so are records that have expired.
+ *	millis() starts over on a reset, so a record made before one is only
+ *	known to be at least as old as the time since the reset, and is counted
+ *	from then.
+ */
+void GB4MQTT::feedStoredRequest()
+{
+	if((nullptr == m_store) || (true == m_store_pending))
+	{
+		return;
+	}
+	//Find the length of the record first, to only read it once it has a block
+	uint8_t record[STORE_RECORD_HEADER_SIZE + MQTTRequest::MESSAGE_MAX_SIZE];
+	size_t record_len = 0;
+	uint16_t tag = 0;
+	FlashQueue::Return r = m_store->peek(&tag, record, &record_len);
+	if(FlashQueue::Return::QUEUE_EMPTY == r)
+	{
+		return;
+	}
+	if(
+		((FlashQueue::Return::BUFFER_TOO_SMALL != r) &&
+		(FlashQueue::Return::RECORD_READ != r)) ||
+		(record_len < STORE_RECORD_HEADER_SIZE) ||
+		(record_len > sizeof record))
+	{
+		m_store->pop();
+		return;
+	}
+	size_t message_len = record_len - STORE_RECORD_HEADER_SIZE;
+	uint8_t *block = m_payloads.allocate(message_len);
+	if(nullptr == block)
+	{
+		return;
+	}
+	r = m_store->peek(&tag, record, &record_len);
+	uint8_t topic_id = tag & STORE_TAG_TOPIC_MASK;
+	size_t p = (tag >> STORE_TAG_PRIORITY_SHIFT) & 0x03;
+	if(
+		(FlashQueue::Return::RECORD_READ != r) ||
+		(false == m_topics.isValid(topic_id)) ||
+		(p >= GB4MQTT_PRIORITY_CLASSES))
+	{
+		m_payloads.free(block);
+		m_store->pop();
+		return;
+	}
+	uint32_t expiry;
+	int32_t queue_time;
+	memcpy(&expiry, &record[0], sizeof expiry);
+	memcpy(&queue_time, &record[sizeof expiry], sizeof queue_time);
+	int32_t now = millis();
+	int32_t age = now - queue_time;
+	if(age < 0)
+	{
+		age = now;
+	}
+	if(
+		(0 != expiry) &&
+		((static_cast<uint32_t>(age) / 1000) >= expiry))
+	{
+		m_payloads.free(block);
+		m_store->pop();
+		expired_count++;
+		return;
+	}
+	MQTTRequest *req = m_publish_queues[p].emplace();
+	if(nullptr == req)
+	{
+		m_payloads.free(block);
+		return;
+	}
+	memcpy(block, &record[STORE_RECORD_HEADER_SIZE], message_len);
+	MQTTPriority priority = static_cast<MQTTPriority>(p);
+	req->message = block;
+	req->topic_id = topic_id;
+	req->payload = req->message;
+	req->message_len = message_len;
+	req->qos = (tag >> STORE_TAG_QOS_SHIFT) & 0x03;
+	req->packet_id = packet_id.get_next();
+	req->priority = priority;
+	req->start_time = now;
+	//The MQTT 5 expiry is sent as what is left of the interval
+	req->queue_time = now - age;
+	req->expiry_interval = expiry;
+	req->disconnect = (0 != (tag & STORE_TAG_DISCONNECT));
+	req->ready_to_send = true;
+	req->active = true;
+	req->stored = true;
+	m_store_pending = true;
+}
+
+
+/**
+ *	Remove the record of a publish request fed from the store, once the
+ *	request is done with
+ */
+void GB4MQTT::releaseStoredRequest(MQTTRequest &req)
+{
+	if(false == req.stored)
+	{
+		return;
+	}
+	req.stored = false;
+	m_store->pop();
+	m_store_pending = false;
+}
+
+
+/**
+ *	Give the block holding the message of a publish request back to the
+ *	payload pool, once the request is done with, or has a new message
+ */
+void GB4MQTT::releasePayload(MQTTRequest &req)
+{
+	m_payloads.free(req.message);
+	req.message = nullptr;
+}
+
+
+/**
+ *	Enqueue a message to publish on a topic given by name. The topic is
+ *	registered on first use. See GB4MQTT::registerTopic() and
+ *	GB4MQTT::publish(uint8_t, ...)
  */
 GB4MQTT::Return GB4MQTT::publish(
 	char const topic[],
@@ -72,24 +649,24 @@ GB4MQTT::Return GB4MQTT::publish(
 	uint8_t const message[],
 	size_t message_len,
 	uint8_t qos, 
-	bool disconnect)
-{
-	strncpy(m_publish_request.topic, topic, topic_len);
-	m_publish_request.topic_len = topic_len;
-	memcpy(m_publish_request.message, message, message_len);
-	m_publish_request.message_len = message_len;
-	m_publish_request.qos = qos;
-	m_publish_request.retain = 0;
-	m_publish_request.duplicate = 0;
-	m_publish_request.start_time = millis();
-	m_publish_request.tries = 0;
-	m_publish_request.packet_id = packet_id.get_next();
-	m_publish_request.disconnect = disconnect;
-	m_publish_request.got_puback = false;
-	m_publish_request.ready_to_send = true;
-	m_publish_request.active = true;
-	
-	return Return::PUBLISH_QUEUED;	
+	bool disconnect,
+	MQTTPriority priority,
+	uint32_t expiry)
+{
+	uint8_t topic_id;
+	Return status = registerTopic(topic, topic_len, &topic_id);
+	if(Return::TOPIC_REGISTERED != status)
+	{
+		return status;
+	}
+	return publish(
+		topic_id,
+		message,
+		message_len,
+		qos,
+		disconnect,
+		priority,
+		expiry);
 }
 
 
@@ -110,17 +687,21 @@ GB4MQTT::Return GB4MQTT::publish(
  */
 GB4MQTT::Return GB4MQTT::poll()
 {
+	//Requests that expire while the link is down are dropped, rather than
+	//	opening a connection for them once it is back
+	dropExpiredRequests();
 	GB4XBee::State radio_state = radio.poll();
 	if(radio_state < GB4XBee::State::SOCKET_READY)
 	{
 		state = State::NOT_CONNECTED;
+		session_retries = 0;
 		return Return::IN_PROGRESS;
 	}
 
 	switch(state)
 	{
 		case State::NOT_CONNECTED:
-		if((nullptr == address) || (false == m_publish_request.active))
+		if((nullptr == address) || (false == needConnection()))
 		{
 			break;
 		}
@@ -145,6 +726,7 @@ GB4MQTT::Return GB4MQTT::poll()
 			state = State::NOT_CONNECTED;
 			break;
 		}
+		session_retries = 0;
 		state = State::CONNECT_MQTT;
 		break;
 
@@ -154,10 +736,12 @@ GB4MQTT::Return GB4MQTT::poll()
 			case Return::CONNECT_SENT: 
 			state = State::AWAIT_CONNACK;
 			break;
+
+			case Return::IN_PROGRESS:
+			break;
 			
 			case Return::CONNECT_SOCKET_ERROR:
-			radio.resetSocket();
-			state = State::NOT_CONNECTED;
+			retryConnect();
 			break;
 
 			case Return::CONNECT_PACKET_ERROR:
@@ -176,34 +760,59 @@ GB4MQTT::Return GB4MQTT::poll()
 				break;
 	
 				case Return::GOT_CONNACK:
+				session_retries = 0;
+				allow_connect = false;
 				state = State::BEGIN_STANDBY;
 				break;
 	
 				//According to the specification, we should close the connection if the
 				//	CONNACK doesn't come in within a reasonable amount of time.
+				//	The CONNECT has left the device, so a second one on the
+				//	socket would be a protocol violation [MQTT-3.1.0-2]
 				case Return::CONNACK_TIMEOUT:
+				//The broker closes the connection after a rejection
 				case Return::CONNACK_REJECTED:
 				case Return::CONNACK_ERROR:
 				default:
-				radio.resetSocket();
-				state = State::NOT_CONNECTED;
+				resetConnection();
 				break;
 			}
 		}
 		break;
  
 		case GB4MQTT::State::BEGIN_STANDBY:
+		//A session opened ahead of a scheduled publish lingers as if a
+		//	publish had asked to disconnect, so that it is closed if the
+		//	publish never comes
+		if((false == hasPublishRequests()) && (true == publish_scheduled))
+		{
+			linger_pending = true;
+			linger_start_time = millis();
+		}
 		state = State::STANDBY;
 		//Flow-through OK
 
 		case State::STANDBY:
 		dispatchIncomming();
+		feedStoredRequest();
 		if(false == handlePublishRequests())
 		{
-			radio.resetSocket();
-			state = State::NOT_CONNECTED;
+			resetConnection();
 			break;
 		}
+		if(State::STANDBY != state)
+		{
+			break;
+		}
+		if(false == handleKeepAlive())
+		{
+			resetConnection();
+			break;
+		}
+		if(true == pollLinger())
+		{
+			disconnect();
+		}
 		break;
 	}
 
@@ -221,15 +830,57 @@ GB4MQTT::Return GB4MQTT::poll()
 
 
 /**
- *	Formulate and transmit an MQTT CONNECT request packet to the broker
+ *	Serialize the MQTT CONNECT request packet, and keep it for every subsequent
+ *	connection attempt. Called on construction, and whenever the client ID,
+ *	name, password, or protocol version changes.
+ *	@return
+ *		true - The packet was serialized
+ *		false - The packet is too long to fit into the buffer. CONNECT requests
+ *		        will fail until the credentials are changed
+ */
+bool GB4MQTT::buildConnectPacket()
+{
+	MQTTPacket_connectData conn = MQTTPacket_connectData_initializer;
+	conn.clientID.cstring = const_cast<char*>(client_id);
+	conn.username.cstring = const_cast<char*>(client_name);
+	conn.password.cstring = const_cast<char*>(client_password);
+	conn.keepAliveInterval = GB4MQTT_NETWORK_TIMEOUT_INTERVAL_SECONDS;
+	conn.cleansession = 1;
+	int len;
+	if(GB4MQTT_MQTT_VERSION_5 == protocol_version)
+	{
+		MQTTV5ConnectProperties properties;
+		properties.receive_maximum = GB4MQTT_MQTT5_RECEIVE_MAXIMUM;
+		properties.maximum_packet_size = GB4MQTT_MAX_PACKET_SIZE;
+		len = MQTTV5Serialize_connect(
+			connect_packet,
+			GB4MQTT_CONNECT_PACKET_SIZE,
+			&conn,
+			&properties);
+	}
+	else
+	{
+		len = MQTTSerialize_connect(
+			connect_packet,
+			GB4MQTT_CONNECT_PACKET_SIZE,
+			&conn);
+	}
+	connect_packet_len = (len > 0) ? len : 0;
+	return 0 != connect_packet_len;
+}
+
+
+/**
+ *	Transmit the MQTT CONNECT request packet to the broker
  *	Must be done before messages can be published
  *	@return
  *		GB4MQTT::Return::CONNECT_PACKET_ERROR - There is a problem with the
  *		                                        packet. Most likely, the packet
  *		                                        is too long to fit into a buffer
- *		GB4MQTT::Return::CONNECT_SOCKET_ERROR - There is a problem with the
- *		                                        socket, and a new connection
- *		                                        should be established
+ *		GB4MQTT::Return::CONNECT_SOCKET_ERROR - The radio did not take the
+ *		                                        packet. Nothing was sent, so
+ *		                                        it may be sent again if the
+ *		                                        socket is still connected
  *		GB4MQTT::Return::IN_PROGRESS - The radio is busy sending another packet
  *		                               Wait for the transmission to end or
  *		                               timeout
@@ -240,22 +891,11 @@ GB4MQTT::Return GB4MQTT::poll()
  */
 GB4MQTT::Return GB4MQTT::sendConnectRequest()
 {
-	uint8_t connect_packet[GB4MQTT_CONNECT_PACKET_SIZE];
-	MQTTPacket_connectData conn = MQTTPacket_connectData_initializer;
-	conn.clientID.cstring = const_cast<char*>(client_id);
-	conn.username.cstring = const_cast<char*>(client_name);
-	conn.password.cstring = const_cast<char*>(client_password);
-	conn.keepAliveInterval = GB4MQTT_NETWORK_TIMEOUT_INTERVAL_SECONDS;
-	conn.cleansession = 1;
-	int connect_packet_len = MQTTSerialize_connect(
-		connect_packet,
-		GB4MQTT_CONNECT_PACKET_SIZE,
-		&conn);
 	if(0 == connect_packet_len)
 	{
 		return Return::CONNECT_PACKET_ERROR;
 	}
-	GB4XBee::Return r = radio.sendMessage(connect_packet, connect_packet_len);
+	GB4XBee::Return r = sendPacket(connect_packet, connect_packet_len);
 	switch(r)
 	{
 		case GB4XBee::Return::MESSAGE_SENT:
@@ -362,6 +1002,10 @@ GB4MQTT::Return GB4MQTT::pollIncomming(
 /**
  *	Check if a received message contains a CONNACK.
  *	If so, look at its contents to see if the connection was accepted
+ *	In MQTT 5 mode, the broker's receive maximum, topic alias maximum,
+ *	maximum QoS and maximum packet size are taken from the CONNACK
+ *	properties, and topic aliases start over. A publish request that was
+ *	sent, but not acknowledged, is sent again over the new connection.
  *	@param message - Input - Message buffer that may contain a CONNACK packet
  *	@param message_len - Length of message in bytes
  *	@return 
@@ -375,13 +1019,24 @@ GB4MQTT::Return GB4MQTT::pollIncomming(
  */
 GB4MQTT::Return GB4MQTT::checkConnack(uint8_t message[], size_t message_len)
 {
-	enum connack_return_codes code;
+	uint8_t code;
 	uint8_t session;
-	if(0 == MQTTDeserialize_connack(
-		&session,
-		(uint8_t*)&code,
-		message,
-		message_len))
+	MQTTV5ConnackProperties properties;
+	int status;
+	if(GB4MQTT_MQTT_VERSION_5 == protocol_version)
+	{
+		status = MQTTV5Deserialize_connack(
+			&session,
+			&code,
+			&properties,
+			message,
+			message_len);
+	}
+	else
+	{
+		status = MQTTDeserialize_connack(&session, &code, message, message_len);
+	}
+	if(0 == status)
 	{
 		return Return::CONNACK_ERROR;
 	}
@@ -391,6 +1046,28 @@ GB4MQTT::Return GB4MQTT::checkConnack(uint8_t message[], size_t message_len)
 		return Return::CONNACK_REJECTED;
 	}
 	
+	send_quota = properties.receive_maximum;
+	topic_alias_maximum = properties.topic_alias_maximum;
+	topic_alias_sent = 0;
+	maximum_qos = properties.maximum_qos;
+	maximum_packet_size = properties.maximum_packet_size;
+	if(
+		(nullptr != m_publish_request) &&
+		(false == m_publish_request->ready_to_send) &&
+		(false == m_publish_request->got_puback))
+	{
+		m_publish_request->ready_to_send = true;
+	}
+	for(size_t p = 0; p < GB4MQTT_PRIORITY_CLASSES; p++)
+	{
+		for(
+			LinkedNode<MQTTRequest> *node = m_publish_queues[p].peakNode();
+			nullptr != node;
+			node = node->next())
+		{
+			node->value().in_flight = false;
+		}
+	}
 	return Return::GOT_CONNACK;
 }
 
@@ -412,12 +1089,12 @@ bool GB4MQTT::checkPuback(uint8_t message[], size_t message_len)
 	{
 		return false;
 	}
-	if(m_publish_request.packet_id != id)
+	if((nullptr == m_publish_request) || (m_publish_request->packet_id != id))
 	{
 		return false;
 	}
-	m_publish_request.got_puback = true;
-	return true;	
+	m_publish_request->got_puback = true;
+	return true;
 }
 
 
@@ -539,15 +1216,9 @@ GB4MQTT::Return GB4MQTT::pollConnackStatus()
  */
 GB4MQTT::Return GB4MQTT::sendPingRequest()
 {
-	static size_t constexpr PINGREQ_SIZE = 2;
-	uint8_t ping_request[PINGREQ_SIZE];
-	
-	if(PINGREQ_SIZE != MQTTSerialize_pingreq(ping_request, PINGREQ_SIZE))
-	{
-		return Return::PING_PACKET_ERROR;
-	}
-
-	GB4XBee::Return r = radio.sendMessage(ping_request, PINGREQ_SIZE);
+	GB4XBee::Return r = sendPacket(
+		PINGREQ_PACKET,
+		sizeof PINGREQ_PACKET);
 	switch(r)
 	{
 		case GB4XBee::Return::MESSAGE_SENT:
@@ -621,40 +1292,116 @@ GB4MQTT::Return GB4MQTT::pollKeepAliveTimer()
  *		                                        socket and it must be
  *		                                        disconnected
  *		GB4MQTT::Return::PUBLISH_PACKET_ERROR - There was a problem formatting
- *		                                        the control packet
+ *		                                        the control packet, or it is
+ *		                                        larger than the broker's
+ *		                                        maximum packet size
  *		GB4MQTT::Return::PUBLISH_SENT - The PUBLISH packet has been
  *		                                successfully queued for
  *		                                transmission
  */
 GB4MQTT::Return GB4MQTT::sendPublishRequest(MQTTRequest &req)
 {
-	static size_t constexpr PUBLISH_HEADER_SIZE = 6;
 	static size_t constexpr PACKET_MAX_SIZE = 
-		MQTTRequest::TOPIC_MAX_SIZE + 
+		MQTTTopicRegistry::TOPIC_HEADER_SIZE + 
 		MQTTRequest::MESSAGE_MAX_SIZE +
+		MQTTV5_PUBLISH_PROPERTIES_MAX_SIZE +
 		PUBLISH_HEADER_SIZE;
+	static uint8_t constexpr ALIASED_TOPIC_HEADER[] = {0x00, 0x00};
+
+	if(
+		(false == m_topics.isValid(req.topic_id)) ||
+		(req.message_len > MQTTRequest::MESSAGE_MAX_SIZE))
+	{
+		return Return::PUBLISH_PACKET_ERROR;
+	}
+	//A broker that doesn't support the QoS of the request gets it at the
+	//	highest QoS it does support
+	if(req.qos > maximum_qos)
+	{
+		req.qos = maximum_qos;
+	}
+
+	//The topic is pre-encoded by MQTTTopicRegistry, so the packet is
+	//	assembled by copying instead of being serialized with
+	//	MQTTSerialize_publish()
+	uint8_t const *topic = m_topics.header(req.topic_id);
+	size_t topic_len = m_topics.headerLength(req.topic_id);
+	uint8_t properties[MQTTV5_PUBLISH_PROPERTIES_MAX_SIZE];
+	size_t properties_len = 0;
+	uint16_t topic_alias = 0;
+	if(GB4MQTT_MQTT_VERSION_5 == protocol_version)
+	{
+		//Once the broker has seen the topic with its alias, the alias alone
+		//	stands in for the topic for the rest of the connection
+		if(req.topic_id < topic_alias_maximum)
+		{
+			topic_alias = req.topic_id + 1;
+			if(0 != (topic_alias_sent & (1 << req.topic_id)))
+			{
+				topic = ALIASED_TOPIC_HEADER;
+				topic_len = sizeof ALIASED_TOPIC_HEADER;
+			}
+		}
+		//Deduct the time the message has spent waiting in the queue
+		uint32_t expiry = req.expiry_interval;
+		if(0 != expiry)
+		{
+			uint32_t waited = (millis() - req.queue_time) / 1000;
+			expiry = (expiry > waited) ? (expiry - waited) : 1;
+		}
+		properties_len = MQTTV5Serialize_publishProperties(
+			properties,
+			topic_alias,
+			expiry);
+	}
 
 	uint8_t packet[PACKET_MAX_SIZE];
-	MQTTString topic = {.cstring = req.topic};
-	int32_t packet_len = MQTTSerialize_publish(
-		packet, PACKET_MAX_SIZE,
-		req.duplicate,
-		req.qos,
-		req.retain,
-		req.packet_id,
-		topic,
-		req.message, req.message_len);
-	if(packet_len <= 0)
+	uint8_t *ptr = packet;
+	size_t remaining_len = topic_len + properties_len + req.message_len;
+	if(0 != req.qos)
+	{
+		remaining_len += 2;
+	}
+	*ptr++ =
+		(PUBLISH << 4) |
+		((req.duplicate & 0x01) << 3) |
+		((req.qos & 0x03) << 1) |
+		(req.retain & 0x01);
+	ptr += MQTTPacket_encode(ptr, remaining_len);
+	memcpy(ptr, topic, topic_len);
+	ptr += topic_len;
+	if(0 != req.qos)
+	{
+		*ptr++ = static_cast<uint8_t>(req.packet_id >> 8);
+		*ptr++ = static_cast<uint8_t>(req.packet_id & 0xFF);
+	}
+	memcpy(ptr, properties, properties_len);
+	ptr += properties_len;
+	memcpy(ptr, req.payload, req.message_len);
+	ptr += req.message_len;
+	size_t packet_len = ptr - packet;
+	if((0 != maximum_packet_size) && (packet_len > maximum_packet_size))
 	{
 		return Return::PUBLISH_PACKET_ERROR;
 	}
 
 	Return status;
-	GB4XBee::Return r = radio.sendMessage(packet, packet_len);
+	GB4XBee::Return r = sendPacket(packet, packet_len);
 	switch(r)
 	{
 		case GB4XBee::Return::MESSAGE_SENT:
 		status = Return::PUBLISH_SENT;
+		publishes_sent++;
+		//Only the first transmission was paid for when the request was queued
+		if(0 != req.tries)
+		{
+			m_byte_budgets[static_cast<size_t>(req.priority)].take(
+				linkCost(packet_len));
+		}
+		if(0 != topic_alias)
+		{
+			topic_alias_sent |= 1 << req.topic_id;
+		}
 		break;
 
 		case GB4XBee::Return::IN_PROGRESS:
@@ -676,44 +1423,76 @@ GB4MQTT::Return GB4MQTT::sendPublishRequest(MQTTRequest &req)
 /**
  *	Handle the transmission a PUBLISH control packets, and keep track of its
  *	state while waiting for a response if Quality of Service is greater than 0.
- *	Retransmit failed packets.
+ *	Retransmit failed packets, unless they have expired. In MQTT 5 mode, a
+ *	packet is only retransmitted over a new connection.
+ *	A packet the broker can't take is dropped, and counted as failed.
  *	Disconnect when finised if the disconnect is true.
  *	@return
  *		true - Everything's fine
- *		false - There was a problem requiring the socket to be reset
+ *		false - The socket failed, or in MQTT 5 mode a PUBACK didn't come in
+ *		        time, and the MQTT session must be re-established. See
+ *		        GB4MQTT::resetConnection()
  */
 bool GB4MQTT::handlePublishRequests()
 {
-	if(false == m_publish_request.active)
+	//Only one request is in flight at a time, and it is served until it is
+	//	done before the next one is picked
+	if(nullptr == m_publish_request)
 	{
-		return true;
-	}	
+		m_publish_request = m_publish_queues.next();
+		if(nullptr == m_publish_request)
+		{
+			return true;
+		}
+	}
+	MQTTRequest *req = m_publish_request;
 
-	if(true == m_publish_request.ready_to_send)
+	if(true == req->ready_to_send)
 	{
-		m_publish_request.ready_to_send = false;
-		Return send_ok = sendPublishRequest(m_publish_request);
+		//Neither send nor retransmit a request nobody wants any more
+		if(true == req->isExpired(millis()))
+		{
+			expired_count++;
+			finishPublishRequest(*req);
+			return true;
+		}
+		//The broker's receive maximum bounds the number of unacknowledged
+		//	QoS 1 and 2 publish requests. Hold back until a PUBACK frees
+		//	the quota
+		if(
+			(0 != req->qos) &&
+			(false == req->in_flight) &&
+			(0 == send_quota))
+		{
+			return true;
+		}
+		req->ready_to_send = false;
+		Return send_ok = sendPublishRequest(*req);
 		switch(send_ok)
 		{
 			case Return::PUBLISH_SENT:
-			if(0 == m_publish_request.qos)
+			if(0 == req->qos)
 			{
-				m_publish_request.active = false;
+				finishPublishRequest(*req);
+				break;
 			}
-			else if(
-				(0 != m_publish_request.qos) &&
-				(0 == m_publish_request.duplicate))
+			//A retransmission over a new connection takes its share of the
+			//	new connection's receive maximum again
+			if(false == req->in_flight)
 			{
-				if(false == m_publish_request.disconnect)
-				{
-					m_publish_request.duplicate = 1;
-				}
-				m_publish_request.start_time = millis();	
+				req->in_flight = true;
+				send_quota--;
 			}
+			if(false == req->disconnect)
+			{
+				req->duplicate = 1;
+			}
+			req->start_time = millis();	
 			break;
 	
 			case Return::PUBLISH_PACKET_ERROR:
-			m_publish_request.active = false;
+			failed_count++;
+			finishPublishRequest(*req);
 			break;
 		
 			case Return::IN_PROGRESS:
@@ -726,43 +1505,276 @@ bool GB4MQTT::handlePublishRequests()
 	}
 	else
 	{
-		if(true == m_publish_request.got_puback)
+		if(true == req->got_puback)
 		{
-			m_publish_request.active = false;
-			if(true == m_publish_request.disconnect)
-			{
-				//Disconnect after transmission
-				uint8_t disconn[2] = {0xE0, 0x00};
-				radio.sendMessage(disconn, 2);
-				return false; //Forces socket to reset
-			}
+			finishPublishRequest(*req);
 			return true;
 		}
 	
-		if((millis() - m_publish_request.start_time) < GB4MQTT_PUBLISH_TIMEOUT)
+		if((millis() - req->start_time) < GB4MQTT_PUBLISH_TIMEOUT)
 		{
 			return true;
 		}
 
-		if(true == m_publish_request.disconnect)
+		if(true == req->disconnect)
 		{
-			//Disconnect after transmission
-			uint8_t disconn[2] = {0xE0, 0x00};
-			radio.sendMessage(disconn, 2);
-			m_publish_request.active = false;
-			return false; //Forces socket to reset
+			finishPublishRequest(*req);
+			linger_pending = false;
+			disconnect();
+			return true;
 		}
 
-		if(m_publish_request.tries > GB4MQTT_PUBLISH_MAX_TRIES)
+		//The session is still up, so only the request is given up on
+		if(req->tries > GB4MQTT_PUBLISH_MAX_TRIES)
 		{
-			m_publish_request.active = false;
-			return false;;
+			failed_count++;
+			finishPublishRequest(*req);
+			linger_pending = false;
+			return true;
 		}
-		m_publish_request.start_time = millis();
-		m_publish_request.tries++;
-		m_publish_request.ready_to_send = true;
+		req->start_time = millis();
+		req->tries++;
+		//An MQTT 5 client must not resend a PUBLISH until it reconnects
+		//	[MQTT-4.4.0-1]. The connection the PUBACK didn't come in on is
+		//	given up on, and GB4MQTT::checkConnack() resends the request
+		//	over the next one
+		if(GB4MQTT_MQTT_VERSION_5 == protocol_version)
+		{
+			return false;
+		}
+		req->ready_to_send = true;
 	}
 	
 	return true;
 }
 
+
+
+/**
+ *	Retire a publish request: release its share of the broker's receive
+ *	maximum, start the linger interval if it asked to disconnect, and remove
+ *	it from the queue
+ *	@param req - The publish request that is done, successfully or not
+ */
+void GB4MQTT::finishPublishRequest(MQTTRequest &req)
+{
+	StaticQueue<MQTTRequest, GB4MQTT_MAX_QUEUE_DEPTH> &queue =
+		m_publish_queues[static_cast<size_t>(req.priority)];
+	for(
+		LinkedNode<MQTTRequest> *node = queue.peakNode();
+		nullptr != node;
+		node = node->next())
+	{
+		if(&req == &node->value())
+		{
+			queue.remove(node);
+			break;
+		}
+	}
+	if(&req == m_publish_request)
+	{
+		m_publish_request = nullptr;
+	}
+	releaseStoredRequest(req);
+	releasePayload(req);
+	req.active = false;
+	if(true == req.in_flight)
+	{
+		req.in_flight = false;
+		send_quota++;
+	}
+	if(true == req.disconnect)
+	{
+		linger_pending = true;
+		linger_start_time = millis();
+	}
+}
+
+
+/**
+ *	Recover from a CONNECT request that could not be handed to the radio.
+ *	The request never left the device, so if the socket is still connected
+ *	it is sent again over the existing socket, avoiding the socket cooldown,
+ *	creation, and TLS handshake. The socket is only rebuilt if it has failed,
+ *	or after GB4MQTT_SESSION_RETRY_MAX consecutive failures over the same
+ *	socket. Once a CONNECT has been sent, it is never sent again on the same
+ *	socket [MQTT-3.1.0-2]; see GB4MQTT::resetConnection()
+ */
+void GB4MQTT::retryConnect()
+{
+	if(
+		(true == radio.isConnected()) &&
+		(session_retries < GB4MQTT_SESSION_RETRY_MAX))
+	{
+		session_retries++;
+		state = State::CONNECT_MQTT;
+		return;
+	}
+	resetConnection();
+}
+
+
+/**
+ *	Recover from a failure that leaves the socket unusable for MQTT: a
+ *	CONNACK that didn't come in time, a rejected CONNECT, after which the
+ *	broker closes the connection, a send failure, a broker that stopped
+ *	answering PINGREQs, or in MQTT 5 mode a PUBACK that didn't come in time.
+ *	The socket is rebuilt, and the session is established again over the
+ *	new one.
+ */
+void GB4MQTT::resetConnection()
+{
+	session_retries = 0;
+	radio.resetSocket();
+	state = State::NOT_CONNECTED;
+}
+
+
+/**
+ *	Send an MQTT DISCONNECT control packet and close the socket.
+ *	The broker closes the network connection upon receiving a DISCONNECT, so
+ *	the socket can not be reused, and a new one is created for the next
+ *	connection.
+ */
+void GB4MQTT::disconnect()
+{
+	sendPacket(DISCONNECT_PACKET, sizeof DISCONNECT_PACKET);
+	radio.resetSocket();
+	session_retries = 0;
+	state = State::NOT_CONNECTED;
+}
+
+
+/**
+ *	Check if the state machine should open a connection to the broker
+ *	@return
+ *		true - A publish request is waiting, GB4MQTT::startConnect() was
+ *		       called, or a publish scheduled with GB4MQTT::schedulePublish()
+ *		       is due within the pre-warm interval
+ *		false - There is nothing to send
+ */
+bool GB4MQTT::needConnection()
+{
+	if((true == hasPublishRequests()) || (true == allow_connect))
+	{
+		return true;
+	}
+	if(false == hasScheduledPublish())
+	{
+		return false;
+	}
+	int32_t time_to_publish = scheduled_publish_time - millis();
+	return time_to_publish <= prewarm_interval;
+}
+
+
+/**
+ *	Check if a publish is scheduled with GB4MQTT::schedulePublish(). A
+ *	schedule more than the linger interval past due is given up on, since
+ *	the publish was refused, dropped, or never made, and is cleared.
+ */
+bool GB4MQTT::hasScheduledPublish()
+{
+	if(false == publish_scheduled)
+	{
+		return false;
+	}
+	int32_t overdue = millis() - scheduled_publish_time;
+	if(overdue > linger_interval)
+	{
+		publish_scheduled = false;
+	}
+	return publish_scheduled;
+}
+
+
+/**
+ *	Send a PINGREQ when the keepalive timer requires it, so that the broker
+ *	does not drop a session left open between publishes
+ *	@return
+ *		true - Everything's fine
+ *		false - The broker has stopped responding, or the PINGREQ could not
+ *		        be sent. The session must be re-established
+ */
+bool GB4MQTT::handleKeepAlive()
+{
+	switch(pollKeepAliveTimer())
+	{
+		case Return::KEEPALIVE_TIMER_RECONNECT:
+		return false;
+
+		case Return::KEEPALIVE_TIMER_PING:
+		if(Return::PING_SOCKET_ERROR == sendPingRequest())
+		{
+			return false;
+		}
+		break;
+
+		case Return::KEEPALIVE_TIMER_RUNNING:
+		default:
+		break;
+	}
+	return true;
+}
+
+
+/**
+ *	Check if a lingering session should now be closed
+ *	@return
+ *		true - The linger interval has elapsed with no further publish requests
+ *		       and none are due within the pre-warm interval
+ *		false - Keep the session open
+ */
+bool GB4MQTT::pollLinger()
+{
+	if((false == linger_pending) || (true == hasPublishRequests()))
+	{
+		return false;
+	}
+	int32_t lingered = millis() - linger_start_time;
+	if(lingered < linger_interval)
+	{
+		return false;
+	}
+	if((true == hasScheduledPublish()) && (true == needConnection()))
+	{
+		return false;
+	}
+	linger_pending = false;
+	return true;
+}
+
+
+/**
+ *	Bytes a packet costs on the uplink, including the API frame it is sent
+ *	to the radio in, and the TCP/IP and TLS overhead it is sent with
+ *	@param packet_len - Length of the MQTT packet in bytes
+ */
+size_t GB4MQTT::linkCost(size_t packet_len)
+{
+	size_t cost =
+		packet_len +
+		GB4XBEE_SEND_FRAME_OVERHEAD +
+		GB4MQTT_TCPIP_OVERHEAD;
+	if(true == radio.usesTLS())
+	{
+		cost += GB4MQTT_TLS_RECORD_OVERHEAD;
+	}
+	return cost;
+}
+
+
+/**
+ *	Send a packet to the broker, and count the bytes it costs. The counters
+ *	are kept across connections. See GB4MQTT::getBytesSent()
+ *	@return See GB4XBee::sendMessage()
+ */
+GB4XBee::Return GB4MQTT::sendPacket(uint8_t const packet[], size_t packet_len)
+{
+	GB4XBee::Return r = radio.sendMessage(packet, packet_len);
+	if(GB4XBee::Return::MESSAGE_SENT == r)
+	{
+		bytes_sent += linkCost(packet_len);
+	}
+	return r;
+}
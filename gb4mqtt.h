@@ -5,11 +5,18 @@
 #ifndef GB4MQTT_H
 #define GB4MQTT_H
 
+#include "flash_queue.h"
 #include "gb4xbee.h"
 #include "MQTTPacket.h"
+#include "mqtt5_packet.h"
+#include "mqtt_publish_queues.h"
+#include "size_class_pool.h"
+#include "static_queue.h"
+#include "token_bucket.h"
 
 static int32_t constexpr GB4MQTT_CONNACK_TIMEOUT = 10000;
-static size_t constexpr GB4MQTT_MAX_PACKET_SIZE = 128;
+static size_t constexpr GB4MQTT_MAX_PACKET_SIZE =
+	GB4BuildConfig::MQTT_MAX_PACKET_SIZE;
 
 static uint16_t constexpr GB4MQTT_NETWORK_TIMEOUT_INTERVAL_SECONDS = 120;
 //static uint16_t constexpr GB4MQTT_NETWORK_TIMEOUT_INTERVAL_SECONDS = 20;
@@ -20,74 +27,218 @@ static int32_t constexpr GB4MQTT_KEEPALIVE_INTERVAL =
 	GB4MQTT_NETWORK_TIMEOUT_INTERVAL / GB4MQTT_NETWORK_KEEPALIVE_MODIFIER;
 
 static char constexpr GB4MQTT_DEFAULT_CLIENT_ID[] = "UNNAMED_GB4";
-static char constexpr GB4MQTT_CONNECT_PACKET_SIZE = 80;
+static size_t constexpr GB4MQTT_CONNECT_PACKET_SIZE = 96;
 static int32_t constexpr GB4MQTT_PUBLISH_TIMEOUT = 10000;
 static uint8_t constexpr GB4MQTT_PUBLISH_MAX_TRIES = 4;
-static size_t constexpr GB4MQTT_MAX_QUEUE_DEPTH = 2;
+static size_t constexpr GB4MQTT_MAX_QUEUE_DEPTH = 8;
+static uint8_t constexpr GB4MQTT_SESSION_RETRY_MAX = 2;
+static int32_t constexpr GB4MQTT_DEFAULT_LINGER_INTERVAL = 0;
+static int32_t constexpr GB4MQTT_DEFAULT_PREWARM_INTERVAL = 0;
+static size_t constexpr GB4MQTT_MAX_TOPICS = 4;
+static uint8_t constexpr GB4MQTT_MQTT_VERSION_3_1_1 = 4;
+static uint8_t constexpr GB4MQTT_MQTT_VERSION_5 = MQTTV5_PROTOCOL_VERSION;
+static uint16_t constexpr GB4MQTT_MQTT5_RECEIVE_MAXIMUM = 1;
+static uint32_t constexpr GB4MQTT_DEFAULT_MESSAGE_EXPIRY = 0;
+//Expiry given to GB4MQTT::publish() to use the one set with
+//	GB4MQTT::setMessageExpiry()
+static uint32_t constexpr GB4MQTT_USE_DEFAULT_EXPIRY = 0xFFFFFFFF;
+static size_t constexpr GB4MQTT_PRIORITY_CLASSES = 3;
+static uint8_t constexpr GB4MQTT_STARVATION_LIMIT = 4;
+//Bytes each packet costs on the uplink besides itself: IPv4 and TCP
+//	headers, and the header, explicit nonce and tag of a TLS 1.2 AES-GCM record
+static size_t constexpr GB4MQTT_TCPIP_OVERHEAD = 40;
+static size_t constexpr GB4MQTT_TLS_RECORD_OVERHEAD = 29;
+//Blocks of 64, 256 and 1024 bytes that the payloads of queued publish
+//	requests are copied into. See GB4MQTT::getPayloadPool()
+static size_t constexpr GB4MQTT_PAYLOAD_SMALL_BLOCKS =
+	GB4BuildConfig::PAYLOAD_SMALL_BLOCKS;
+static size_t constexpr GB4MQTT_PAYLOAD_MEDIUM_BLOCKS =
+	GB4BuildConfig::PAYLOAD_MEDIUM_BLOCKS;
+static size_t constexpr GB4MQTT_PAYLOAD_LARGE_BLOCKS =
+	GB4BuildConfig::PAYLOAD_LARGE_BLOCKS;
 
+typedef SizeClassPool<
+	GB4MQTT_PAYLOAD_SMALL_BLOCKS,
+	GB4MQTT_PAYLOAD_MEDIUM_BLOCKS,
+	GB4MQTT_PAYLOAD_LARGE_BLOCKS> GB4MQTTPayloadPool;
 
-class MQTTRequest {
+//Topic aliases already sent on a connection, and topics that coalesce, are
+//	tracked in byte-wide masks
+static_assert(GB4MQTT_MAX_TOPICS <= 8, "GB4MQTT_MAX_TOPICS must not exceed 8");
+
+
+/**
+ *	Stores each publish topic once, pre-encoded as it appears in the PUBLISH
+ *	variable header (2 byte big-endian length followed by the topic string),
+ *	and hands out a small integer ID for publish requests to refer to.
+ */
+class MQTTTopicRegistry {
 	public:
 	static size_t constexpr TOPIC_MAX_SIZE = 64;
-	static size_t constexpr MESSAGE_MAX_SIZE = 900;
+	static size_t constexpr TOPIC_HEADER_SIZE = TOPIC_MAX_SIZE + 2;
+	static uint8_t constexpr INVALID_ID = 0xFF;
+
+	MQTTTopicRegistry()
+	{
+		m_count = 0;
+	}
+
+	/**
+	 *	Intern a topic. Registering a topic that already exists returns the
+	 *	ID it was first registered with.
+	 *	@param topic - Topic string. Need not be null terminated
+	 *	@param topic_len - Maximum length of topic in bytes
+	 *	@return
+	 *		MQTTTopicRegistry::INVALID_ID - The topic is longer than
+	 *		                                TOPIC_MAX_SIZE, or the registry is
+	 *		                                full
+	 *		Otherwise, the topic ID
+	 */
+	uint8_t add(char const topic[], size_t topic_len)
+	{
+		size_t len = strnlen(topic, topic_len);
+		if(len > TOPIC_MAX_SIZE)
+		{
+			return INVALID_ID;
+		}
+		uint8_t id = find(topic, len);
+		if((INVALID_ID != id) || (m_count >= GB4MQTT_MAX_TOPICS))
+		{
+			return id;
+		}
+		Entry &entry = m_topics[m_count];
+		entry.header[0] = static_cast<uint8_t>(len >> 8);
+		entry.header[1] = static_cast<uint8_t>(len & 0xFF);
+		memcpy(&entry.header[2], topic, len);
+		entry.header_len = len + 2;
+		return m_count++;
+	}
+
+	uint8_t find(char const topic[], size_t len)
+	{
+		for(uint8_t id = 0; id < m_count; id++)
+		{
+			if(
+				((len + 2) == m_topics[id].header_len) &&
+				(0 == memcmp(&m_topics[id].header[2], topic, len)))
+			{
+				return id;
+			}
+		}
+		return INVALID_ID;
+	}
+
+	bool isValid(uint8_t id)
+	{
+		return id < m_count;
+	}
+
+	uint8_t const *header(uint8_t id)
+	{
+		return m_topics[id].header;
+	}
+
+	size_t headerLength(uint8_t id)
+	{
+		return m_topics[id].header_len;
+	}
+
+	private:
+	struct Entry {
+		uint8_t header[TOPIC_HEADER_SIZE];
+		size_t header_len;
+	};
+	Entry m_topics[GB4MQTT_MAX_TOPICS];
+	uint8_t m_count;
+};
+
+
+/**
+ *	Publish priority classes, highest first. Each class has its own queue of
+ *	GB4MQTT_MAX_QUEUE_DEPTH requests, and the highest class with a request
+ *	waiting is served first. A class that has been passed over
+ *	GB4MQTT_STARVATION_LIMIT times in a row is served next regardless.
+ */
+enum class MQTTPriority : uint8_t {
+	ALARM = 0,
+	NORMAL,
+	BULK,
+};
+
+
+class MQTTRequest {
+	public:
+	static size_t constexpr MESSAGE_MAX_SIZE =
+		GB4BuildConfig::MQTT_MESSAGE_MAX_SIZE;
+	static_assert(
+		MESSAGE_MAX_SIZE <= GB4MQTTPayloadPool::MAX_SIZE,
+		"MESSAGE_MAX_SIZE must fit in a block of the payload pool");
 
 	MQTTRequest()
 	{
-		topic_len = 0;
+		topic_id = MQTTTopicRegistry::INVALID_ID;
+		message = nullptr;
+		payload = nullptr;
 		message_len = 0;
 		qos = 0;
 		retain = 0;
 		packet_id = 0;
+		priority = MQTTPriority::NORMAL;
 		start_time = 0;
+		queue_time = 0;
+		expiry_interval = 0;
 		tries = 0;
 		duplicate = false;
+		in_flight = false;
 		got_puback = false;
 		ready_to_send = false;
 		disconnect = false;
 		active = false;
+		stored = false;
 	}
 
-	MQTTRequest(
-		char const top[], size_t toplen,
-		uint8_t const mes[], size_t meslen,
-		uint8_t q = 0, uint8_t r = 0, uint16_t id = 0,
-		bool disconn = false)
-	{
-		strncpy(topic, top, toplen);
-		topic_len = toplen;
-		memcpy(message, mes, meslen);
-		message_len = meslen;
-		qos = q;
-		retain = r;
-		packet_id = id;
-		start_time = millis();
-		tries = 0;
-		duplicate = 0;
-		got_puback = false;
-		ready_to_send = true;
-		disconnect = disconn;
-		active = false;
+	/**
+	 *	Check if the request has outlived its expiry interval
+	 *	@param now - Current time, as given by millis()
+	 */
+	bool isExpired(int32_t now)
+	{
+		uint32_t age = static_cast<uint32_t>(now - queue_time) / 1000;
+		return (0 != expiry_interval) && (age >= expiry_interval);
 	}
 
-	char topic[TOPIC_MAX_SIZE];
-	size_t topic_len;
-	uint8_t message[MESSAGE_MAX_SIZE];
+	uint8_t topic_id;
+	//Block from the payload pool holding a copy of the message, or nullptr
+	uint8_t *message;
+	//Either message, or a buffer owned by the caller of
+	//	GB4MQTT::publishBuffer()
+	uint8_t const *payload;
 	size_t message_len;
 	uint8_t qos;
 	uint8_t retain;
 	uint8_t duplicate = 0;
 	uint16_t packet_id;
+	MQTTPriority priority;
 	int32_t start_time;
+	int32_t queue_time;
+	uint32_t expiry_interval;
 	uint8_t tries = 0;
+	bool in_flight = false;
 	bool got_puback = false;
 	bool ready_to_send = false;
 	bool disconnect = false;
 	bool active = false;
+	//The message is the record at the front of the store. See
+	//	GB4MQTT::setStore()
+	bool stored = false;
 };
 
 
 class GB4MQTT {
 	public:
+	//Largest message GB4MQTT::publish() and GB4MQTT::publishBuffer() take
+	static size_t constexpr MESSAGE_MAX_SIZE = MQTTRequest::MESSAGE_MAX_SIZE;
+
 	GB4MQTT(
 		uint32_t radio_baud,
 		char const *radio_apn,
@@ -99,6 +250,9 @@ class GB4MQTT {
 		char *pwd = const_cast<char*>(""));
 
 	enum class Return {
+		PUBLISH_BUDGET_EXHAUSTED = -19,
+		TOPIC_UNKNOWN = -18,
+		TOPIC_REGISTRY_FULL = -17,
 		NOT_READY = -16,
 		PUBACK_MALFORMED = -15,
 		PUBLISH_TIMEOUT = -14,
@@ -133,16 +287,41 @@ class GB4MQTT {
 		GOT_PUBACK,
 		DISPATCHED_PUBACK,
 		IN_PROGRESS,
+		TOPIC_REGISTERED,
+		PUBLISH_COALESCED,
+		PUBLISH_STORED,
 	};
 
 	bool begin();
+	Return registerTopic(
+		char const topic[],
+		size_t topic_len,
+		uint8_t *topic_id);
+	Return publish(
+		uint8_t topic_id,
+		uint8_t const message[],
+		size_t message_len,
+		uint8_t qos = 0,
+		bool disconnect = false,
+		MQTTPriority priority = MQTTPriority::NORMAL,
+		uint32_t expiry = GB4MQTT_USE_DEFAULT_EXPIRY);
 	Return publish(
 		char const topic[],
 		size_t topic_len,
 		uint8_t const message[],
 		size_t message_len,
 		uint8_t qos = 0,
-		bool disconenct = false);
+		bool disconenct = false,
+		MQTTPriority priority = MQTTPriority::NORMAL,
+		uint32_t expiry = GB4MQTT_USE_DEFAULT_EXPIRY);
+	Return publishBuffer(
+		uint8_t topic_id,
+		uint8_t const message[],
+		size_t message_len,
+		uint8_t qos = 0,
+		bool disconnect = false,
+		MQTTPriority priority = MQTTPriority::NORMAL,
+		uint32_t expiry = GB4MQTT_USE_DEFAULT_EXPIRY);
 	Return poll();
 
 	void end();
@@ -162,19 +341,183 @@ class GB4MQTT {
 		return (state == State::STANDBY);
 	}
 
+	/**
+	 *	Check whether a buffer given to GB4MQTT::publishBuffer() still
+	 *	belongs to a pending publish request
+	 */
+	bool isBufferInUse(uint8_t const buffer[])
+	{
+		for(size_t p = 0; p < GB4MQTT_PRIORITY_CLASSES; p++)
+		{
+			for(
+				LinkedNode<MQTTRequest> *node = m_publish_queues[p].peakNode();
+				nullptr != node;
+				node = node->next())
+			{
+				if(buffer == node->value().payload)
+				{
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	/**
+	 *	Latest-value mode for a topic. A publish on a coalescing topic
+	 *	replaces a queued request on the same topic that has not been sent
+	 *	yet, instead of queueing behind it, so a backlog never sends state
+	 *	that has already been superseded. The byte budget is charged, or
+	 *	given back, the difference in size from the replaced request.
+	 *	@param topic_id - Publish topic ID given by GB4MQTT::registerTopic()
+	 *	@param enable - true to coalesce, false (default) to queue every publish
+	 *	@return
+	 *		true - The mode was set
+	 *		false - topic_id was not registered
+	 */
+	bool setCoalescing(uint8_t topic_id, bool enable)
+	{
+		if(false == m_topics.isValid(topic_id))
+		{
+			return false;
+		}
+		if(true == enable)
+		{
+			coalesce_topics |= 1 << topic_id;
+		}
+		else
+		{
+			coalesce_topics &= ~(1 << topic_id);
+		}
+		return true;
+	}
+
+	/**
+	 *	Number of queued publish requests that were replaced by a newer
+	 *	publish on a coalescing topic before they were sent
+	 */
+	uint32_t getCoalescedCount()
+	{
+		return coalesced_count;
+	}
+
+	/**
+	 *	Keep publishes that can't be queued in a persistent store, rather than
+	 *	refusing them. Once the store holds a publish, every later one of the
+	 *	NORMAL and BULK classes goes into it as well, so that they keep their
+	 *	order, while ALARM publishes are only stored when their queue is full.
+	 *	Stored publishes are fed back into their queues one at a time, and
+	 *	only removed from the store when they are done, so a reset never loses
+	 *	one, but may send one twice. They keep their expiry interval, counted
+	 *	from when they were published, and are dropped once it runs out. The
+	 *	time a publish spends stored over a reset isn't known, so it is only
+	 *	counted from the reset. They refer to their topic by ID, so topics must be registered in the same order on
+	 *	every start up.
+	 *	@param store - Store that has been started with FlashQueue::begin(),
+	 *	               or nullptr (default) to refuse publishes that can't
+	 *	               be queued
+	 */
+	void setStore(FlashQueue *store)
+	{
+		m_store = store;
+		m_store_pending = false;
+	}
+
+	/**
+	 *	Pool the messages of GB4MQTT::publish() are copied into while they are
+	 *	queued, each into a block of the smallest size class it fits in. A
+	 *	publish that finds no block left is refused with
+	 *	GB4MQTT::Return::PUBLISH_QUEUE_FULL, or stored. For its statistics
+	 */
+	GB4MQTTPayloadPool const &getPayloadPool()
+	{
+		return m_payloads;
+	}
+
+	/**
+	 *	Limit the data a priority class may publish with a byte and a message
+	 *	token bucket. A publish that would overdraw either is refused with
+	 *	GB4MQTT::Return::PUBLISH_BUDGET_EXHAUSTED. Bytes are counted as sent
+	 *	to the radio, including packet, TCP/IP, TLS and API frame overhead.
+	 *	Retransmissions are taken from the byte budget, but never refused.
+	 *	@param priority - Priority class to limit
+	 *	@param bytes - Burst size in bytes. 0 doesn't limit bytes
+	 *	@param bytes_per_hour - Steady byte rate
+	 *	@param messages - Burst size in messages. 0 doesn't limit messages
+	 *	@param messages_per_hour - Steady message rate
+	 */
+	void setBudget(
+		MQTTPriority priority,
+		uint32_t bytes,
+		uint32_t bytes_per_hour,
+		uint32_t messages,
+		uint32_t messages_per_hour)
+	{
+		size_t p = static_cast<size_t>(priority);
+		m_byte_budgets[p].configure(bytes, bytes_per_hour);
+		m_message_budgets[p].configure(messages, messages_per_hour);
+	}
+
+	/**
+	 *	Bytes sent to the radio since start up, over every connection,
+	 *	including overhead. See GB4MQTT::setBudget()
+	 */
+	uint32_t getBytesSent()
+	{
+		return bytes_sent;
+	}
+
+	/**
+	 *	PUBLISH packets sent since start up, including retransmissions
+	 */
+	uint32_t getPublishesSent()
+	{
+		return publishes_sent;
+	}
+
+	/**
+	 *	Number of publish requests refused by GB4MQTT::setBudget()
+	 */
+	uint32_t getBudgetRefusedCount()
+	{
+		return budget_refused_count;
+	}
+
+	/**
+	 *	Number of publish requests dropped because they expired before they
+	 *	could be sent, or before they were acknowledged
+	 */
+	uint32_t getExpiredCount()
+	{
+		return expired_count;
+	}
+
+	/**
+	 *	Number of publish requests dropped because they weren't acknowledged
+	 *	after GB4MQTT_PUBLISH_MAX_TRIES retransmissions, or because the
+	 *	broker can't take them, being larger than its maximum packet size
+	 */
+	uint32_t getFailedCount()
+	{
+		return failed_count;
+	}
+
 	void setClientID(char *id)
 	{
 		client_id = id;
+		buildConnectPacket();
 	}
 
 	void setPassword(char *pwd)
 	{
 		client_password = pwd;
+		buildConnectPacket();
 	}
 
 	void setClientName(char *name)
 	{
 		client_name = name;
+		buildConnectPacket();
 	}
 
 	void setAddress(char *addr)
@@ -186,13 +529,102 @@ class GB4MQTT {
 	{
 		port = p;
 	}
+
+	/**
+	 *	Select the MQTT protocol version for subsequent connections
+	 *	@param version - GB4MQTT_MQTT_VERSION_3_1_1 (default) or
+	 *	                 GB4MQTT_MQTT_VERSION_5
+	 */
+	void setProtocolVersion(uint8_t version)
+	{
+		protocol_version = version;
+		buildConnectPacket();
+	}
+
+	/**
+	 *	Default expiry interval in seconds of subsequent publish requests.
+	 *	A request that is still queued, or waiting to be retransmitted, when
+	 *	it expires is dropped. In MQTT 5 mode, the time it has left is sent to
+	 *	the broker as its message expiry interval. 0 never expires.
+	 */
+	void setMessageExpiry(uint32_t interval)
+	{
+		message_expiry = interval;
+	}
 	
 	void startConnect()
 	{
 		allow_connect = true;
 	}
 
+	/**
+	 *	Keep the session open for the given number of milliseconds after the
+	 *	last publish request that asked to disconnect, or after a session
+	 *	opened ahead of a scheduled publish is established. A publish
+	 *	enqueued during this period reuses the open session.
+	 *	0 disconnects as soon as the publish completes.
+	 */
+	void setLinger(int32_t interval)
+	{
+		linger_interval = interval;
+	}
+
+	/**
+	 *	Open the session the given number of milliseconds ahead of a publish
+	 *	announced with GB4MQTT::schedulePublish()
+	 */
+	void setPrewarm(int32_t interval)
+	{
+		prewarm_interval = interval;
+	}
+
+	/**
+	 *	Announce that a publish will be enqueued the given number of
+	 *	milliseconds from now, so that the connection can be pre-warmed.
+	 *	The schedule is cleared by the next publish of the priority class
+	 *	that is accepted, or once it is more than the linger interval past
+	 *	due. See GB4MQTT::setLinger()
+	 *	@param delay - Milliseconds until the publish
+	 *	@param priority - Priority class of the publish
+	 */
+	void schedulePublish(
+		int32_t delay,
+		MQTTPriority priority = MQTTPriority::NORMAL)
+	{
+		scheduled_publish_time = millis() + delay;
+		scheduled_priority = priority;
+		publish_scheduled = true;
+	}
+
 	private:
+	bool buildConnectPacket();
+	Return queuePublishRequest(
+		uint8_t topic_id,
+		uint8_t const message[],
+		size_t message_len,
+		uint8_t qos,
+		bool disconnect,
+		MQTTPriority priority,
+		uint32_t expiry,
+		bool copy);
+	MQTTRequest *findCoalescableRequest(
+		uint8_t topic_id,
+		MQTTPriority priority);
+	bool hasPublishRequests();
+	void dropExpiredRequests();
+	Return storePublishRequest(
+		uint8_t topic_id,
+		uint8_t const message[],
+		size_t message_len,
+		uint8_t qos,
+		bool disconnect,
+		MQTTPriority priority,
+		uint32_t expiry);
+	void feedStoredRequest();
+	void releaseStoredRequest(MQTTRequest &req);
+	void releasePayload(MQTTRequest &req);
+	size_t linkCost(size_t packet_len);
+	GB4XBee::Return sendPacket(uint8_t const packet[], size_t packet_len);
 	Return sendConnectRequest();
 	Return sendPingRequest();
 	Return pollIncomming(
@@ -202,12 +634,20 @@ class GB4MQTT {
 	Return dispatchIncomming();	
 	Return pollConnackStatus();
 	Return checkConnack(uint8_t message[], size_t message_len);
+	void finishPublishRequest(MQTTRequest &req);
 	bool checkPuback(uint8_t message[], size_t message_len);
 	void resetKeepAliveTimer();
 	Return pollKeepAliveTimer();
 	Return sendPublishRequest(MQTTRequest &req);
 	bool handlePublishRequests();
 	void handleInFlightRequests();
+	void retryConnect();
+	void resetConnection();
+	void disconnect();
+	bool needConnection();
+	bool hasScheduledPublish();
+	bool handleKeepAlive();
+	bool pollLinger();
 
 	enum class State {
 		RADIO_INIT_FAILED = -2,
@@ -239,6 +679,30 @@ class GB4MQTT {
 	uint16_t port;
 	char *address;
 	bool allow_connect; 
+	uint8_t connect_packet[GB4MQTT_CONNECT_PACKET_SIZE];
+	size_t connect_packet_len;
+	uint8_t protocol_version;
+	uint32_t message_expiry;
+	uint16_t send_quota;
+	uint16_t topic_alias_maximum;
+	uint8_t maximum_qos;
+	uint32_t maximum_packet_size;
+	uint8_t topic_alias_sent;
+	uint8_t coalesce_topics;
+	uint32_t coalesced_count;
+	uint32_t expired_count;
+	uint32_t failed_count;
+	uint32_t bytes_sent;
+	uint32_t publishes_sent;
+	uint32_t budget_refused_count;
+	uint8_t session_retries;
+	int32_t linger_interval;
+	int32_t linger_start_time;
+	bool linger_pending;
+	int32_t prewarm_interval;
+	int32_t scheduled_publish_time;
+	MQTTPriority scheduled_priority;
+	bool publish_scheduled;
 	
 	class PacketId {
 		public:
@@ -259,7 +723,20 @@ class GB4MQTT {
 	};
 	PacketId packet_id;	
 	
-	MQTTRequest m_publish_request;
+	MQTTTopicRegistry m_topics;
+	MQTTPublishQueues<
+		MQTTRequest,
+		GB4MQTT_PRIORITY_CLASSES,
+		GB4MQTT_MAX_QUEUE_DEPTH,
+		GB4MQTT_STARVATION_LIMIT> m_publish_queues;
+	//The request being sent, which is served until it is done
+	MQTTRequest *m_publish_request;
+	TokenBucket m_byte_budgets[GB4MQTT_PRIORITY_CLASSES];
+	TokenBucket m_message_budgets[GB4MQTT_PRIORITY_CLASSES];
+	FlashQueue *m_store;
+	//A request fed from the store is queued
+	bool m_store_pending;
+	GB4MQTTPayloadPool m_payloads;
 };
 
 
@@ -738,7 +738,9 @@ GB4XBee::Return GB4XBee::getReceivedMessage(uint8_t message[], size_t *message_l
  *		                                should be closed and a new one created 
  *		GB4XBee::Return::BUFFER_FULL - The UART buffer is full, wait for it to
  *		                               drain before attempting to send
- *		GB4XBee::Return::PACKET_ERROR - The UART buffer is not large enough to
+ *		GB4XBee::Return::PACKET_ERROR - The message is longer than
+ *		                                GB4XBEE_RECEIVED_MESSAGE_MAX_SIZE, or
+ *		                                the UART buffer is not large enough to
  *		                                fit this API frame. The message should
  *		                                be broken up into multiple packets.
  *		GB4XBee::Return::SOCKET_ERROR - There a problem sending on the socket.
@@ -750,7 +752,9 @@ GB4XBee::Return GB4XBee::getReceivedMessage(uint8_t message[], size_t *message_l
  *		                                xbee_notify.cpp. The callback is
  *		                                executed with a call to GB4XBee::poll()
  */
-GB4XBee::Return GB4XBee::sendMessage(uint8_t message[], size_t message_len)
+GB4XBee::Return GB4XBee::sendMessage(
+	uint8_t const message[],
+	size_t message_len)
 {
 	if(State::SENDING == m_state)
 	{
@@ -762,6 +766,11 @@ GB4XBee::Return GB4XBee::sendMessage(uint8_t message[], size_t message_len)
 		return Return::DISCONNECTED;
 	}
 
+	if(message_len > GB4XBEE_RECEIVED_MESSAGE_MAX_SIZE)
+	{
+		return Return::PACKET_ERROR;
+	}
+
 	Return status;
 	int send_ok = xbee_sock_send(sock, 0, message, message_len);
 	switch(send_ok)
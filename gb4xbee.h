@@ -8,7 +8,9 @@
 
 static uint32_t constexpr GB4XBEE_COMMAND_MODE_GUARD_TIME = 1200;
 static size_t constexpr GB4XBEE_ACCESS_POINT_NAME_SIZE = 32;
-static size_t constexpr GB4XBEE_RECEIVED_MESSAGE_MAX_SIZE = 1500;
+//Largest message GB4XBee::sendMessage() takes
+static size_t constexpr GB4XBEE_RECEIVED_MESSAGE_MAX_SIZE =
+	GB4BuildConfig::XBEE_MESSAGE_MAX_SIZE;
 static uint32_t constexpr GB4XBEE_DEFAULT_BAUD = 9600;
 static uint32_t constexpr GB4XBEE_DEFAULT_COMMAND_TIMEOUT = 10000;
 static uint32_t constexpr GB4XBEE_CONNECT_TIMEOUT = 20000;
@@ -17,6 +19,10 @@ static uint32_t constexpr GB4XBEE_SOCKET_COOLDOWN_INTERVAL = 2000;
 static uint32_t constexpr GB4XBEE_CONNECT_RETRY_DELAY_INTERVAL = 1000;
 static uint32_t constexpr GB4XBEE_TLS_PROFILE_TIMEOUT = 10000;
 static uint32_t constexpr GB4XBEE_SEND_TIMEOUT = 1000;
+//Socket Send API frame around a message: start delimiter (1), length (2),
+//	frame type (1), frame ID (1), socket ID (1), transmit options (1) and
+//	checksum (1)
+static size_t constexpr GB4XBEE_SEND_FRAME_OVERHEAD = 8;
 
 class GB4XBee {
 	public:
@@ -97,7 +103,7 @@ class GB4XBee {
 	bool connect(uint16_t port, char const *address);
 	Return pollConnectStatus();
 	Return getReceivedMessage(uint8_t message[], size_t *message_len);
-	Return sendMessage(uint8_t message[], size_t message_len);
+	Return sendMessage(uint8_t const message[], size_t message_len);
 
 	bool verifyAccessPointName(uint8_t const *value, size_t const len);
 
@@ -123,6 +129,11 @@ class GB4XBee {
 		return access_point_name;
 	}
 
+	bool usesTLS()
+	{
+		return XBEE_SOCK_PROTOCOL_SSL == transport_protocol;
+	}
+
 	uint64_t getSerialNumber()
 	{
 		if(m_state < State::BEGIN_API_MODE_COMMAND)
@@ -140,6 +151,15 @@ class GB4XBee {
 		return m_state;
 	}
 
+	/**
+	 *	The socket is considered healthy while the most recent socket state
+	 *	notification reported it as connected
+	 */
+	bool isConnected()
+	{
+		return (State::CONNECTED == m_state) || (State::SENDING == m_state);
+	}
+
 	uint32_t const cast_guard;
 
 	private:
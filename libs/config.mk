@@ -11,6 +11,14 @@ C_SOURCES += \
 
 CPP_SOURCES += \
 	libs/xbee_ansic_library/ports/arduino-due/xbee_platform_arduino_due.cpp \
+	libs/flash_queue/flash_queue.cpp \
+	libs/flash_queue/sam3x_flash_region.cpp \
+	libs/telemetry/cbor_report.cpp \
+	libs/telemetry/delta_report.cpp \
+	libs/telemetry/json_report.cpp \
+	libs/telemetry/lz_codec.cpp \
+	libs/telemetry/report_filter.cpp \
+	libs/telemetry/text_format.cpp \
 	libs/xbee_ansic_library/ports/arduino-due/xbee_serial_arduino_due.cpp \
 	
 HEADERS += \
@@ -18,7 +26,10 @@ HEADERS += \
 	libs/xbee_ansic_library/include \
 	libs/xbee_ansic_library/ports/arduino-due \
 	libs/paho.mqtt.embedded-c/MQTTPacket/src \
+	libs/flash_queue \
+	libs/memory_pool \
 	libs/static_queue \
+	libs/telemetry \
 
 SYMBOLS += \
 	XBEE_PLATFORM_HEADER="\"platform_config_arduino_due.h\"" \
@@ -0,0 +1,461 @@
+/**
+ * flash_queue.cpp
+ */
+
+#include "flash_queue.h"
+#include <cstring>
+
+static uint16_t getUint16(uint8_t const *ptr)
+{
+	return ptr[0] | (static_cast<uint16_t>(ptr[1]) << 8);
+}
+
+
+static uint32_t getUint32(uint8_t const *ptr)
+{
+	return getUint16(ptr) | (static_cast<uint32_t>(getUint16(&ptr[2])) << 16);
+}
+
+
+static void putUint16(uint8_t *ptr, uint16_t value)
+{
+	ptr[0] = static_cast<uint8_t>(value & 0xFF);
+	ptr[1] = static_cast<uint8_t>(value >> 8);
+}
+
+
+static void putUint32(uint8_t *ptr, uint32_t value)
+{
+	putUint16(ptr, static_cast<uint16_t>(value & 0xFFFF));
+	putUint16(&ptr[2], static_cast<uint16_t>(value >> 16));
+}
+
+
+/**
+ *	CRC-16/CCITT-FALSE
+ */
+static uint16_t crc16(uint8_t const data[], size_t len)
+{
+	uint16_t crc = 0xFFFF;
+	for(size_t i = 0; i < len; i++)
+	{
+		crc ^= static_cast<uint16_t>(data[i]) << 8;
+		for(int bit = 0; bit < 8; bit++)
+		{
+			crc = (0 != (crc & 0x8000)) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+		}
+	}
+	return crc;
+}
+
+
+FlashQueue::FlashQueue(FlashRegion &region) :
+	m_region(region)
+{
+	m_page_count = 0;
+	m_capacity = 0;
+	m_header_reads = 0;
+	m_head = 0;
+	m_tail = 0;
+	m_committed_tail = 0;
+	m_uncommitted_pops = 0;
+	memset(m_page, FlashRegion::ERASED, sizeof m_page);
+}
+
+
+/**
+ *	Recover the queue from the region
+ *	@return
+ *		FlashQueue::Return::REGION_ERROR - The region can't be used, or is
+ *		                                   smaller than two pages
+ *		FlashQueue::Return::READY
+ */
+FlashQueue::Return FlashQueue::begin()
+{
+	if(false == m_region.begin())
+	{
+		return Return::REGION_ERROR;
+	}
+	m_page_count = m_region.pageCount();
+	if(m_page_count < 2)
+	{
+		return Return::REGION_ERROR;
+	}
+	//The page after the head is never part of the queue, so that writing the
+	//	head page can't overwrite the tail
+	m_capacity = (m_page_count - 1) * PAGE_DATA_SIZE;
+	m_header_reads = 0;
+	m_uncommitted_pops = 0;
+
+	PageHeader last;
+	if(false == findLastPage(&last))
+	{
+		m_head = 0;
+		m_tail = 0;
+		m_committed_tail = 0;
+		memset(m_page, FlashRegion::ERASED, sizeof m_page);
+		return Return::READY;
+	}
+
+	uint32_t head_seq = last.head / PAGE_DATA_SIZE;
+	if((head_seq > last.seq) || ((last.seq - head_seq) >= m_page_count))
+	{
+		//The header makes no sense. Start over after the last page
+		m_head = (last.seq + 1) * PAGE_DATA_SIZE;
+		m_tail = m_head;
+		m_committed_tail = m_tail;
+		memset(m_page, FlashRegion::ERASED, sizeof m_page);
+		return Return::READY;
+	}
+	//Pages written after the head page belong to a record that was never
+	//	committed
+	if(false == discardPages(head_seq + 1, last.seq))
+	{
+		return Return::REGION_ERROR;
+	}
+	m_head = last.head;
+	m_tail = last.tail;
+	if((m_tail > m_head) || ((m_head - m_tail) > m_capacity))
+	{
+		m_tail = m_head;
+	}
+	m_committed_tail = m_tail;
+	memcpy(m_page, m_region.page(head_seq % m_page_count), sizeof m_page);
+	return Return::READY;
+}
+
+
+/**
+ *	Append a record. It is in flash when this returns.
+ *	@param tag - Value stored with the record, for the caller's use
+ *	@param data - Record contents
+ *	@param len - Length of data in bytes
+ *	@return
+ *		FlashQueue::Return::RECORD_TOO_LARGE - The record would never fit
+ *		FlashQueue::Return::QUEUE_FULL - The record doesn't fit until older
+ *		                                 records are removed
+ *		FlashQueue::Return::REGION_ERROR - Writing the region failed. The
+ *		                                   record is not added.
+ *		FlashQueue::Return::RECORD_ADDED
+ */
+FlashQueue::Return FlashQueue::push(
+	uint16_t tag,
+	uint8_t const data[],
+	size_t len)
+{
+	size_t record_len = RECORD_HEADER_SIZE + len;
+	if((len > RECORD_MAX_SIZE) || (record_len > m_capacity))
+	{
+		return Return::RECORD_TOO_LARGE;
+	}
+	if(record_len > (m_capacity - used()))
+	{
+		return Return::QUEUE_FULL;
+	}
+
+	uint8_t header[RECORD_HEADER_SIZE];
+	putUint16(&header[0], static_cast<uint16_t>(len));
+	putUint16(&header[2], tag);
+	putUint16(&header[4], crc16(data, len));
+	uint32_t old_head = m_head;
+	uint32_t pos = m_head;
+	bool ok =
+		(true == append(&pos, header, sizeof header)) &&
+		(true == append(&pos, data, len));
+	if(true == ok)
+	{
+		m_head = pos;
+		ok = commitHead();
+	}
+	if(false == ok)
+	{
+		//Don't leave pages of the record behind for FlashQueue::begin() to
+		//	mistake for the last page, and start over from the flash copy of
+		//	the head page
+		m_head = old_head;
+		discardPages((m_head / PAGE_DATA_SIZE) + 1, pos / PAGE_DATA_SIZE);
+		memcpy(
+			m_page,
+			m_region.page((m_head / PAGE_DATA_SIZE) % m_page_count),
+			sizeof m_page);
+		return Return::REGION_ERROR;
+	}
+	return Return::RECORD_ADDED;
+}
+
+
+/**
+ *	Copy out the oldest record, without removing it
+ *	@param tag - Output - Value the record was added with
+ *	@param data - Output - Record contents
+ *	@param len - Input - Size of data in bytes
+ *	             Output - Length of the record in bytes, also when data is
+ *	                      too small for it
+ *	@return
+ *		FlashQueue::Return::QUEUE_EMPTY
+ *		FlashQueue::Return::BUFFER_TOO_SMALL - The record is larger than data
+ *		FlashQueue::Return::RECORD_CORRUPT - The record is damaged. Remove it
+ *		                                     with FlashQueue::pop()
+ *		FlashQueue::Return::RECORD_READ
+ */
+FlashQueue::Return FlashQueue::peek(uint16_t *tag, uint8_t data[], size_t *len)
+{
+	if(true == isEmpty())
+	{
+		return Return::QUEUE_EMPTY;
+	}
+	uint8_t header[RECORD_HEADER_SIZE];
+	read(m_tail, header, sizeof header);
+	size_t record_len = getUint16(&header[0]);
+	if((RECORD_HEADER_SIZE + record_len) > used())
+	{
+		return Return::RECORD_CORRUPT;
+	}
+	if(record_len > *len)
+	{
+		*len = record_len;
+		return Return::BUFFER_TOO_SMALL;
+	}
+	read(m_tail + RECORD_HEADER_SIZE, data, record_len);
+	if(getUint16(&header[4]) != crc16(data, record_len))
+	{
+		return Return::RECORD_CORRUPT;
+	}
+	*tag = getUint16(&header[2]);
+	*len = record_len;
+	return Return::RECORD_READ;
+}
+
+
+/**
+ *	Remove the oldest record. The new tail is written to flash only now and
+ *	then, so the record may come back after a reboot
+ *	@return
+ *		FlashQueue::Return::QUEUE_EMPTY
+ *		FlashQueue::Return::REGION_ERROR - The new tail couldn't be written.
+ *		                                   The record is removed, but comes
+ *		                                   back after a reboot.
+ *		FlashQueue::Return::RECORD_REMOVED
+ */
+FlashQueue::Return FlashQueue::pop()
+{
+	if(true == isEmpty())
+	{
+		return Return::QUEUE_EMPTY;
+	}
+	uint8_t header[RECORD_HEADER_SIZE];
+	read(m_tail, header, sizeof header);
+	size_t record_len = RECORD_HEADER_SIZE + getUint16(&header[0]);
+	//A damaged length takes the rest of the queue with it
+	m_tail = (record_len <= used()) ? (m_tail + record_len) : m_head;
+	m_uncommitted_pops++;
+	//Once the tail leaves its page, the page can be overwritten, so the tail
+	//	in flash must not stay behind in it
+	bool commit =
+		((m_tail / PAGE_DATA_SIZE) != (m_committed_tail / PAGE_DATA_SIZE)) ||
+		(m_uncommitted_pops >= POP_COMMIT_INTERVAL) ||
+		(true == isEmpty());
+	if((true == commit) && (false == commitHead()))
+	{
+		return Return::REGION_ERROR;
+	}
+	return Return::RECORD_REMOVED;
+}
+
+
+/**
+ *	Read the header of a page
+ *	@return
+ *		true - The header is valid, and belongs to the page
+ *		false - The page is erased, or damaged
+ */
+bool FlashQueue::readHeader(size_t index, PageHeader *header)
+{
+	m_header_reads++;
+	uint8_t const *page = m_region.page(index);
+	if(
+		(PAGE_MAGIC != getUint16(&page[0])) ||
+		(getUint16(&page[2]) != crc16(&page[4], PAGE_HEADER_SIZE - 4)))
+	{
+		return false;
+	}
+	header->seq = getUint32(&page[4]);
+	header->head = getUint32(&page[8]);
+	header->tail = getUint32(&page[12]);
+	return (header->seq % m_page_count) == index;
+}
+
+
+/**
+ *	Order of a page in the stream
+ *	@return
+ *		0 - The page is erased or damaged
+ *		Otherwise, the sequence number of the page + 1
+ */
+uint32_t FlashQueue::pageKey(size_t index)
+{
+	PageHeader header;
+	if(false == readHeader(index, &header))
+	{
+		return 0;
+	}
+	return header.seq + 1;
+}
+
+
+/**
+ *	Find the last page written. Going around the ring from page 0, sequence
+ *	numbers count up by one until the last page written, and what follows
+ *	is older or erased. This is found with a binary search. Only if page 0
+ *	itself is erased or damaged are all the headers read.
+ *	@param header - Output - Header of the last page written
+ *	@return
+ *		true on success
+ *		false - No page has been written
+ */
+bool FlashQueue::findLastPage(PageHeader *header)
+{
+	size_t last = 0;
+	uint32_t first_key = pageKey(0);
+	if(0 != first_key)
+	{
+		size_t low = 1;
+		size_t high = m_page_count;
+		while(low < high)
+		{
+			size_t mid = low + ((high - low) / 2);
+			if((first_key + mid) == pageKey(mid))
+			{
+				low = mid + 1;
+			}
+			else
+			{
+				high = mid;
+			}
+		}
+		last = low - 1;
+	}
+	else
+	{
+		uint32_t last_key = 0;
+		for(size_t i = 1; i < m_page_count; i++)
+		{
+			uint32_t key = pageKey(i);
+			if(key > last_key)
+			{
+				last_key = key;
+				last = i;
+			}
+		}
+		if(0 == last_key)
+		{
+			return false;
+		}
+	}
+	return readHeader(last, header);
+}
+
+
+/**
+ *	Write the copy of the head page into its place in the ring
+ *	@param seq - Sequence number of the page
+ *	@param head - Head position to record in the page header
+ */
+bool FlashQueue::writePage(uint32_t seq, uint32_t head)
+{
+	putUint16(&m_page[0], PAGE_MAGIC);
+	putUint32(&m_page[4], seq);
+	putUint32(&m_page[8], head);
+	putUint32(&m_page[12], m_tail);
+	putUint16(&m_page[2], crc16(&m_page[4], PAGE_HEADER_SIZE - 4));
+	return m_region.writePage(seq % m_page_count, m_page);
+}
+
+
+/**
+ *	Write the copy of the head page with the current head and tail, which
+ *	commits both
+ */
+bool FlashQueue::commitHead()
+{
+	if(false == writePage(m_head / PAGE_DATA_SIZE, m_head))
+	{
+		return false;
+	}
+	m_committed_tail = m_tail;
+	m_uncommitted_pops = 0;
+	return true;
+}
+
+
+/**
+ *	Erase the pages with the given range of sequence numbers. The copy of
+ *	the head page is used as the erased page, and must be reloaded after.
+ */
+bool FlashQueue::discardPages(uint32_t first_seq, uint32_t last_seq)
+{
+	memset(m_page, FlashRegion::ERASED, sizeof m_page);
+	bool ok = true;
+	for(uint32_t seq = first_seq; seq <= last_seq; seq++)
+	{
+		ok = (true == m_region.writePage(seq % m_page_count, m_page)) && ok;
+	}
+	return ok;
+}
+
+
+/**
+ *	Copy data into the stream at a position, writing out each page that is
+ *	filled. Filled pages keep the old head in their headers, so they only
+ *	count once the record is committed.
+ *	@param pos - Input - Stream position to copy to
+ *	             Output - Stream position after data
+ */
+bool FlashQueue::append(uint32_t *pos, uint8_t const data[], size_t len)
+{
+	while(len > 0)
+	{
+		size_t offset = *pos % PAGE_DATA_SIZE;
+		size_t count = PAGE_DATA_SIZE - offset;
+		if(count > len)
+		{
+			count = len;
+		}
+		memcpy(&m_page[PAGE_HEADER_SIZE + offset], data, count);
+		*pos += count;
+		data += count;
+		len -= count;
+		if(0 == (*pos % PAGE_DATA_SIZE))
+		{
+			if(false == writePage((*pos / PAGE_DATA_SIZE) - 1, m_head))
+			{
+				return false;
+			}
+			memset(m_page, FlashRegion::ERASED, sizeof m_page);
+		}
+	}
+	return true;
+}
+
+
+/**
+ *	Copy data out of the stream, from flash
+ */
+void FlashQueue::read(uint32_t pos, uint8_t data[], size_t len)
+{
+	while(len > 0)
+	{
+		size_t offset = pos % PAGE_DATA_SIZE;
+		size_t count = PAGE_DATA_SIZE - offset;
+		if(count > len)
+		{
+			count = len;
+		}
+		uint8_t const *page =
+			m_region.page((pos / PAGE_DATA_SIZE) % m_page_count);
+		memcpy(data, &page[PAGE_HEADER_SIZE + offset], count);
+		pos += count;
+		data += count;
+		len -= count;
+	}
+}
@@ -0,0 +1,117 @@
+/**
+ * flash_queue.h
+ * Persistent FIFO of records in a FlashRegion, kept as a log. Records are
+ * appended to a byte stream laid out over the pages of the region as a ring,
+ * so every page is written about as often as every other. Each page starts
+ * with a header holding its sequence number in the stream, and the stream
+ * positions of the queue head and tail at the time it was written.
+ *
+ * The page the head is in is always the last page written. Pages of a record
+ * that spans several are written in order, with the old head in their
+ * headers, and the record is only committed by the write of its last page.
+ * On boot, the last page written is found with a binary search over the page
+ * headers, and any pages of an unfinished record after it are erased.
+ * Records are never scanned.
+ *
+ * Removing a record only moves the tail in RAM. The head page is rewritten
+ * with the new tail once the tail moves into another page, every
+ * POP_COMMIT_INTERVAL records, or when the queue empties, so draining the
+ * queue doesn't erase the head page once per record. Records removed since
+ * then come back after a reboot, so the queue delivers at least once. Adding
+ * a record writes the tail along with the head. The tail in flash is never in
+ * an older page than the tail in RAM, which is never overwritten.
+ */
+
+#ifndef FLASH_QUEUE_H
+#define FLASH_QUEUE_H
+
+#include "flash_region.h"
+
+class FlashQueue {
+	public:
+	static size_t constexpr PAGE_HEADER_SIZE = 16;
+	static size_t constexpr PAGE_DATA_SIZE =
+		FlashRegion::PAGE_SIZE - PAGE_HEADER_SIZE;
+	//Length, tag, and CRC of the record
+	static size_t constexpr RECORD_HEADER_SIZE = 6;
+	static size_t constexpr RECORD_MAX_SIZE = 0xFFFF;
+	static uint16_t constexpr PAGE_MAGIC = 0x5146;
+	//Records removed before the tail is written, if it stays in one page
+	static size_t constexpr POP_COMMIT_INTERVAL = 8;
+
+	enum class Return {
+		REGION_ERROR = -5,
+		RECORD_CORRUPT = -4,
+		BUFFER_TOO_SMALL = -3,
+		RECORD_TOO_LARGE = -2,
+		QUEUE_FULL = -1,
+		QUEUE_EMPTY = 0,
+		READY,
+		RECORD_ADDED,
+		RECORD_READ,
+		RECORD_REMOVED,
+	};
+
+	FlashQueue(FlashRegion &region);
+	Return begin();
+	Return push(uint16_t tag, uint8_t const data[], size_t len);
+	Return peek(uint16_t *tag, uint8_t data[], size_t *len);
+	Return pop();
+
+	bool isEmpty()
+	{
+		return m_head == m_tail;
+	}
+
+	/**
+	 *	Bytes taken up by the records in the queue, including their headers
+	 */
+	size_t used()
+	{
+		return m_head - m_tail;
+	}
+
+	size_t capacity()
+	{
+		return m_capacity;
+	}
+
+	/**
+	 *	Number of page headers read by FlashQueue::begin()
+	 */
+	size_t headerReads()
+	{
+		return m_header_reads;
+	}
+
+	private:
+	struct PageHeader {
+		uint32_t seq;
+		uint32_t head;
+		uint32_t tail;
+	};
+
+	bool readHeader(size_t index, PageHeader *header);
+	uint32_t pageKey(size_t index);
+	bool findLastPage(PageHeader *header);
+	bool writePage(uint32_t seq, uint32_t head);
+	bool commitHead();
+	bool discardPages(uint32_t first_seq, uint32_t last_seq);
+	bool append(uint32_t *pos, uint8_t const data[], size_t len);
+	void read(uint32_t pos, uint8_t data[], size_t len);
+
+	FlashRegion &m_region;
+	size_t m_page_count;
+	size_t m_capacity;
+	size_t m_header_reads;
+	//Stream positions of the end of the last record, and of the first
+	uint32_t m_head;
+	uint32_t m_tail;
+	//Tail in the head page in flash, and the records removed since
+	uint32_t m_committed_tail;
+	size_t m_uncommitted_pops;
+	//Copy of the page the head is in
+	uint8_t m_page[FlashRegion::PAGE_SIZE];
+};
+
+#endif //FLASH_QUEUE_H
@@ -0,0 +1,49 @@
+/**
+ * flash_region.h
+ * A range of NOR flash pages that can be read in place, and written a whole
+ * page at a time. Writing a page erases it first, as the SAM3X "Erase and
+ * Write Page" command does, so any page can be rewritten at any time.
+ */
+
+#ifndef FLASH_REGION_H
+#define FLASH_REGION_H
+
+#include <cstddef>
+#include <cstdint>
+
+class FlashRegion {
+	public:
+	//Page size of the SAM3X8E. Regions on other storage use it as well, so
+	//	that their contents are interchangeable.
+	static size_t constexpr PAGE_SIZE = 256;
+	static uint8_t constexpr ERASED = 0xFF;
+
+	virtual ~FlashRegion() {}
+
+	/**
+	 *	Make the region ready to be read and written
+	 *	@return
+	 *		true on success
+	 *		false - The region can't be used
+	 */
+	virtual bool begin() = 0;
+
+	/**
+	 *	Contents of a page, readable in place
+	 *	@param index - Page index, less than pageCount()
+	 */
+	virtual uint8_t const *page(size_t index) = 0;
+
+	/**
+	 *	Erase a page, and write PAGE_SIZE bytes into it
+	 *	@param index - Page index, less than pageCount()
+	 *	@return
+	 *		true on success
+	 *		false - The write failed. The contents of the page are unknown
+	 */
+	virtual bool writePage(size_t index, uint8_t const data[]) = 0;
+
+	virtual size_t pageCount() = 0;
+};
+
+#endif //FLASH_REGION_H
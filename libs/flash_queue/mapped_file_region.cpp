@@ -0,0 +1,103 @@
+/**
+ * mapped_file_region.cpp
+ */
+
+#include "mapped_file_region.h"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ *	@param path - File to keep the region in. Must stay valid until
+ *	              MappedFileRegion::begin() is called.
+ *	@param page_count - Size of the region in pages
+ */
+MappedFileRegion::MappedFileRegion(char const *path, size_t page_count)
+{
+	m_path = path;
+	m_page_count = page_count;
+	m_fd = -1;
+	m_data = nullptr;
+}
+
+
+MappedFileRegion::~MappedFileRegion()
+{
+	if(nullptr != m_data)
+	{
+		munmap(m_data, m_page_count * PAGE_SIZE);
+	}
+	if(m_fd >= 0)
+	{
+		close(m_fd);
+	}
+}
+
+
+/**
+ *	Open the file, creating it erased if it is new, and map it
+ *	@return
+ *		true on success
+ *		false - The file can't be opened or mapped, or already exists with
+ *		        a different size
+ */
+bool MappedFileRegion::begin()
+{
+	size_t size = m_page_count * PAGE_SIZE;
+	m_fd = open(m_path, O_RDWR | O_CREAT, 0644);
+	if(m_fd < 0)
+	{
+		return false;
+	}
+	struct stat st;
+	if(0 != fstat(m_fd, &st))
+	{
+		return false;
+	}
+	bool is_new = (0 == st.st_size);
+	if(
+		((false == is_new) && (size != static_cast<size_t>(st.st_size))) ||
+		((true == is_new) && (0 != ftruncate(m_fd, size))))
+	{
+		return false;
+	}
+	void *data = mmap(
+		nullptr,
+		size,
+		PROT_READ | PROT_WRITE,
+		MAP_SHARED,
+		m_fd,
+		0);
+	if(MAP_FAILED == data)
+	{
+		return false;
+	}
+	m_data = static_cast<uint8_t*>(data);
+	if(true == is_new)
+	{
+		memset(m_data, ERASED, size);
+	}
+	return true;
+}
+
+
+uint8_t const *MappedFileRegion::page(size_t index)
+{
+	return &m_data[index * PAGE_SIZE];
+}
+
+
+bool MappedFileRegion::writePage(size_t index, uint8_t const data[])
+{
+	memcpy(&m_data[index * PAGE_SIZE], data, PAGE_SIZE);
+	//msync() needs an address aligned to the page size of the host
+	uintptr_t start = reinterpret_cast<uintptr_t>(&m_data[index * PAGE_SIZE]);
+	uintptr_t host_page_size = sysconf(_SC_PAGESIZE);
+	uintptr_t aligned = start - (start % host_page_size);
+	return 0 == msync(
+		reinterpret_cast<void*>(aligned),
+		(start - aligned) + PAGE_SIZE,
+		MS_SYNC);
+}
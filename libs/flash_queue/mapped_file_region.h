@@ -0,0 +1,33 @@
+/**
+ * mapped_file_region.h
+ * FlashRegion in a memory-mapped file, for running and testing the code
+ * that uses flash on a host. A new file starts out erased.
+ */
+
+#ifndef MAPPED_FILE_REGION_H
+#define MAPPED_FILE_REGION_H
+
+#include "flash_region.h"
+
+class MappedFileRegion : public FlashRegion {
+	public:
+	MappedFileRegion(char const *path, size_t page_count);
+	~MappedFileRegion() override;
+
+	bool begin() override;
+	uint8_t const *page(size_t index) override;
+	bool writePage(size_t index, uint8_t const data[]) override;
+
+	size_t pageCount() override
+	{
+		return m_page_count;
+	}
+
+	private:
+	char const *m_path;
+	size_t m_page_count;
+	int m_fd;
+	uint8_t *m_data;
+};
+
+#endif //MAPPED_FILE_REGION_H
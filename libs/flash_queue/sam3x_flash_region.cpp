@@ -0,0 +1,110 @@
+/**
+ * sam3x_flash_region.cpp
+ */
+
+#include "sam3x_flash_region.h"
+#include "Arduino.h"
+#include <cstring>
+
+static uint32_t constexpr EEFC_KEY = 0x5A;
+static uint32_t constexpr EEFC_ERASE_WRITE_PAGE = 0x03;
+static uint32_t constexpr EEFC_CLEAR_LOCK_BIT = 0x09;
+
+//End of the program text, and the initial values of the data that follow it
+//	in flash. See the linker script.
+extern uint32_t _etext;
+extern uint32_t _srelocate;
+extern uint32_t _erelocate;
+
+/**
+ *	Send a command to the flash controller of the bank holding an address,
+ *	and wait for it to finish
+ *	@param address - Address within the bank
+ *	@param command - EEFC_FCR_FCMD command
+ *	@return
+ *		true on success
+ *		false - The command was refused, or the page is locked
+ */
+static bool performCommand(uint32_t address, uint32_t command)
+{
+	Efc *efc = EFC0;
+	uint32_t bank_address = IFLASH0_ADDR;
+	if(address >= IFLASH1_ADDR)
+	{
+		efc = EFC1;
+		bank_address = IFLASH1_ADDR;
+	}
+	uint32_t page = (address - bank_address) / IFLASH1_PAGE_SIZE;
+	efc->EEFC_FCR =
+		EEFC_FCR_FKEY(EEFC_KEY) |
+		EEFC_FCR_FARG(page) |
+		EEFC_FCR_FCMD(command);
+	uint32_t status;
+	do
+	{
+		status = efc->EEFC_FSR;
+	}
+	while(0 == (status & EEFC_FSR_FRDY));
+	return 0 == (status & (EEFC_FSR_FCMDE | EEFC_FSR_FLOCKE));
+}
+
+
+/**
+ *	Check that the region lies outside of the program, in the bank the
+ *	program doesn't run from, and unlock it
+ *	@return
+ *		true on success
+ *		false - The region overlaps the program, shares its bank, or
+ *		        couldn't be unlocked
+ */
+bool SAM3XFlashRegion::begin()
+{
+	uint32_t program_end =
+		reinterpret_cast<uint32_t>(&_etext) +
+		(reinterpret_cast<uint32_t>(&_erelocate) -
+		 reinterpret_cast<uint32_t>(&_srelocate));
+	uint32_t end = m_address + (m_page_count * PAGE_SIZE);
+	if(
+		(0 != (m_address % PAGE_SIZE)) ||
+		(m_address < IFLASH1_ADDR) ||
+		(program_end > IFLASH1_ADDR) ||
+		(end > (IFLASH1_ADDR + IFLASH1_SIZE)))
+	{
+		return false;
+	}
+	for(
+		uint32_t address = m_address;
+		address < end;
+		address += IFLASH1_LOCK_REGION_SIZE)
+	{
+		if(false == performCommand(address, EEFC_CLEAR_LOCK_BIT))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+uint8_t const *SAM3XFlashRegion::page(size_t index)
+{
+	return reinterpret_cast<uint8_t const *>(m_address + (index * PAGE_SIZE));
+}
+
+
+/**
+ *	Fill the latch buffer of the flash controller by writing the page in
+ *	place, 32 bits at a time, then have the controller erase and write it
+ */
+bool SAM3XFlashRegion::writePage(size_t index, uint8_t const data[])
+{
+	uint32_t address = m_address + (index * PAGE_SIZE);
+	uint32_t volatile *latch = reinterpret_cast<uint32_t volatile *>(address);
+	for(size_t i = 0; i < (PAGE_SIZE / sizeof(uint32_t)); i++)
+	{
+		uint32_t word;
+		memcpy(&word, &data[i * sizeof word], sizeof word);
+		latch[i] = word;
+	}
+	return performCommand(address, EEFC_ERASE_WRITE_PAGE);
+}
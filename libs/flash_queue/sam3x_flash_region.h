@@ -0,0 +1,43 @@
+/**
+ * sam3x_flash_region.h
+ * FlashRegion in the on-chip flash of the SAM3X8E (Arduino Due), written
+ * with the Enhanced Embedded Flash Controller. Flash can't be read while it
+ * is being written, so the region must lie in the bank the program isn't
+ * running from. The upper bank, from IFLASH1_ADDR, is unused as long as the
+ * program fits into the lower 256 KB.
+ */
+
+#ifndef SAM3X_FLASH_REGION_H
+#define SAM3X_FLASH_REGION_H
+
+#include "flash_region.h"
+
+class SAM3XFlashRegion : public FlashRegion {
+	public:
+	//The whole upper bank
+	static uint32_t constexpr DEFAULT_ADDRESS = 0xC0000;
+	static size_t constexpr DEFAULT_PAGE_COUNT = 1024;
+
+	SAM3XFlashRegion(
+		uint32_t address = DEFAULT_ADDRESS,
+		size_t page_count = DEFAULT_PAGE_COUNT)
+	{
+		m_address = address;
+		m_page_count = page_count;
+	}
+
+	bool begin() override;
+	uint8_t const *page(size_t index) override;
+	bool writePage(size_t index, uint8_t const data[]) override;
+
+	size_t pageCount() override
+	{
+		return m_page_count;
+	}
+
+	private:
+	uint32_t m_address;
+	size_t m_page_count;
+};
+
+#endif //SAM3X_FLASH_REGION_H
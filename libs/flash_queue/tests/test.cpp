@@ -0,0 +1,553 @@
+/**
+ * test.cpp
+ * Unit test for FlashQueue, on a FlashRegion in a memory-mapped file
+ */
+
+#include "flash_queue.h"
+#include "mapped_file_region.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unistd.h>
+
+static char constexpr REGION_PATH[] = "test_region.bin";
+static size_t constexpr PAGE_COUNT = 8;
+static size_t constexpr RECORD_MAX_SIZE = 900;
+
+
+/**
+ *	Region that stops writing after a number of page writes, as if the power
+ *	went out
+ */
+class FailingRegion : public MappedFileRegion {
+	public:
+	FailingRegion(char const *path, size_t page_count, size_t writes_left) :
+		MappedFileRegion(path, page_count)
+	{
+		m_writes_left = writes_left;
+	}
+
+	bool writePage(size_t index, uint8_t const data[]) override
+	{
+		if(0 == m_writes_left)
+		{
+			return false;
+		}
+		m_writes_left--;
+		return MappedFileRegion::writePage(index, data);
+	}
+
+	private:
+	size_t m_writes_left;
+};
+
+
+/**
+ *	Region that counts its page writes, each of which erases a page
+ */
+class CountingRegion : public MappedFileRegion {
+	public:
+	CountingRegion(char const *path, size_t page_count) :
+		MappedFileRegion(path, page_count)
+	{
+		m_writes = 0;
+	}
+
+	bool writePage(size_t index, uint8_t const data[]) override
+	{
+		m_writes++;
+		return MappedFileRegion::writePage(index, data);
+	}
+
+	size_t writes()
+	{
+		return m_writes;
+	}
+
+	private:
+	size_t m_writes;
+};
+
+
+class TestFlashQueue {
+	public:
+	TestFlashQueue() {}
+
+	/**
+	 * Add records that span several pages, and remove them
+	 * Verify that they come out in order, with their tags and contents
+	 */
+	bool fifo()
+	{
+		m_name.assign("fifo");
+		if(false == open(true, PAGE_COUNT))
+		{
+			return false;
+		}
+		size_t lengths[] = {1, 300, 0, 700, 17};
+		for(size_t i = 0; i < (sizeof lengths / sizeof lengths[0]); i++)
+		{
+			if(false == push(i, lengths[i]))
+			{
+				return false;
+			}
+		}
+		for(size_t i = 0; i < (sizeof lengths / sizeof lengths[0]); i++)
+		{
+			if(false == popExpected(i, lengths[i]))
+			{
+				return false;
+			}
+		}
+		return
+			(true == m_queue->isEmpty()) &&
+			(FlashQueue::Return::QUEUE_EMPTY == m_queue->pop());
+	}
+
+	/**
+	 * Add records, remove some, and reopen the region
+	 * Verify that the records that weren't removed are still there, in order
+	 */
+	bool persistence()
+	{
+		m_name.assign("persistence");
+		if(false == open(true, PAGE_COUNT))
+		{
+			return false;
+		}
+		for(size_t i = 0; i < 5; i++)
+		{
+			if(false == push(i, 100 + (50 * i)))
+			{
+				return false;
+			}
+		}
+		if(
+			(false == popExpected(0, 100)) ||
+			(false == popExpected(1, 150)) ||
+			(false == open(false, PAGE_COUNT)))
+		{
+			return false;
+		}
+		for(size_t i = 2; i < 5; i++)
+		{
+			if(false == popExpected(i, 100 + (50 * i)))
+			{
+				return false;
+			}
+		}
+		//Removing a record must stick as well
+		return (true == open(false, PAGE_COUNT)) && (true == m_queue->isEmpty());
+	}
+
+	/**
+	 * Go around the ring many times, reopening the region now and then
+	 * Verify that every record comes out intact, and in order
+	 */
+	bool wrapAround()
+	{
+		m_name.assign("wrapAround");
+		if(false == open(true, PAGE_COUNT))
+		{
+			return false;
+		}
+		size_t next_push = 0;
+		size_t next_pop = 0;
+		for(size_t round = 0; round < 40; round++)
+		{
+			for(size_t i = 0; i < 3; i++, next_push++)
+			{
+				if(false == push(next_push, length(next_push)))
+				{
+					return false;
+				}
+			}
+			if((0 == (round % 7)) && (false == open(false, PAGE_COUNT)))
+			{
+				return false;
+			}
+			for(size_t i = 0; i < 3; i++, next_pop++)
+			{
+				if(false == popExpected(next_pop, length(next_pop)))
+				{
+					return false;
+				}
+			}
+		}
+		return true == m_queue->isEmpty();
+	}
+
+	/**
+	 * Add records until the queue is full
+	 * Verify that the queue takes up to its capacity, refuses records larger
+	 * than its capacity, and takes records again once some are removed
+	 */
+	bool full()
+	{
+		m_name.assign("full");
+		if(false == open(true, PAGE_COUNT))
+		{
+			return false;
+		}
+		size_t capacity = m_queue->capacity();
+		uint8_t data[RECORD_MAX_SIZE] = {0};
+		if(
+			FlashQueue::Return::RECORD_TOO_LARGE !=
+			m_queue->push(0, data, capacity))
+		{
+			return false;
+		}
+		size_t count = 0;
+		for(; true == push(count, 200); count++);
+		m_result = m_queue->push(0, data, 200);
+		size_t record_size = FlashQueue::RECORD_HEADER_SIZE + 200;
+		return
+			(FlashQueue::Return::QUEUE_FULL == m_result) &&
+			(count == (capacity / record_size)) &&
+			(true == popExpected(0, 200)) &&
+			(true == push(count, 200));
+	}
+
+	/**
+	 * Lose power in the middle of writing a record that spans several pages,
+	 * reopen the region, and add a short record
+	 * Verify that the unfinished record is gone, and that the records before
+	 * it and the short record survive another reopen
+	 */
+	bool powerLoss()
+	{
+		m_name.assign("powerLoss");
+		if(
+			(false == open(true, PAGE_COUNT)) ||
+			(false == push(0, 100)) ||
+			(false == push(1, 100)))
+		{
+			return false;
+		}
+		m_queue.reset();
+		m_region.reset(new FailingRegion(REGION_PATH, PAGE_COUNT, 2));
+		m_queue.reset(new FlashQueue(*m_region));
+		uint8_t data[RECORD_MAX_SIZE];
+		fill(data, 2, 800);
+		if(
+			(FlashQueue::Return::READY != m_queue->begin()) ||
+			(FlashQueue::Return::REGION_ERROR != m_queue->push(2, data, 800)))
+		{
+			return false;
+		}
+		if(
+			(false == open(false, PAGE_COUNT)) ||
+			(FlashQueue::RECORD_HEADER_SIZE * 2) + 200 != m_queue->used() ||
+			(false == push(3, 10)) ||
+			(false == open(false, PAGE_COUNT)))
+		{
+			return false;
+		}
+		return
+			(true == popExpected(0, 100)) &&
+			(true == popExpected(1, 100)) &&
+			(true == popExpected(3, 10)) &&
+			(true == m_queue->isEmpty());
+	}
+
+	/**
+	 * Fill a large region part of the way around a second time, and reopen it
+	 * Verify that only about log2 of the page count headers are read
+	 */
+	bool fastRecovery()
+	{
+		m_name.assign("fastRecovery");
+		static size_t constexpr LARGE_PAGE_COUNT = 1024;
+		if(false == open(true, LARGE_PAGE_COUNT))
+		{
+			return false;
+		}
+		size_t popped = 0;
+		for(size_t i = 0; i < 400; i++)
+		{
+			if(false == push(i, RECORD_MAX_SIZE))
+			{
+				return false;
+			}
+			if((i >= 50) && (false == popExpected(popped++, RECORD_MAX_SIZE)))
+			{
+				return false;
+			}
+		}
+		if(false == open(false, LARGE_PAGE_COUNT))
+		{
+			return false;
+		}
+		m_header_reads = m_queue->headerReads();
+		size_t max_reads = 2 + static_cast<size_t>(log2(LARGE_PAGE_COUNT));
+		return
+			(m_header_reads <= max_reads) &&
+			(true == popExpected(popped, RECORD_MAX_SIZE));
+	}
+
+	/**
+	 * Damage the contents of a record in flash
+	 * Verify that it reads as corrupt, and that removing it gets to the next
+	 */
+	bool corruptRecord()
+	{
+		m_name.assign("corruptRecord");
+		if(
+			(false == open(true, PAGE_COUNT)) ||
+			(false == push(0, 50)) ||
+			(false == push(1, 50)))
+		{
+			return false;
+		}
+		m_queue.reset();
+		m_region.reset();
+		FILE *file = fopen(REGION_PATH, "r+b");
+		if(nullptr == file)
+		{
+			return false;
+		}
+		long offset = FlashQueue::PAGE_HEADER_SIZE + FlashQueue::RECORD_HEADER_SIZE;
+		fseek(file, offset, SEEK_SET);
+		fputc(0x55, file);
+		fclose(file);
+
+		uint8_t data[RECORD_MAX_SIZE];
+		size_t len = sizeof data;
+		uint16_t tag;
+		if(false == open(false, PAGE_COUNT))
+		{
+			return false;
+		}
+		m_result = m_queue->peek(&tag, data, &len);
+		return
+			(FlashQueue::Return::RECORD_CORRUPT == m_result) &&
+			(FlashQueue::Return::RECORD_REMOVED == m_queue->pop()) &&
+			(true == popExpected(1, 50));
+	}
+
+	/**
+	 * Add short records that fill several pages, and remove them all
+	 * Verify that removing them erases a page about once per
+	 * POP_COMMIT_INTERVAL records and once per page, rather than once per
+	 * record, and that records removed since the last erase come back after
+	 * a reopen
+	 */
+	bool drainWear()
+	{
+		m_name.assign("drainWear");
+		static size_t constexpr RECORD_COUNT = 64;
+		static size_t constexpr DATA_SIZE = 10;
+		m_queue.reset();
+		m_region.reset();
+		unlink(REGION_PATH);
+		CountingRegion *region = new CountingRegion(REGION_PATH, PAGE_COUNT);
+		m_region.reset(region);
+		m_queue.reset(new FlashQueue(*m_region));
+		if(FlashQueue::Return::READY != m_queue->begin())
+		{
+			return false;
+		}
+		for(size_t i = 0; i < RECORD_COUNT; i++)
+		{
+			if(false == push(i, DATA_SIZE))
+			{
+				return false;
+			}
+		}
+		size_t pages = m_queue->used() / FlashQueue::PAGE_DATA_SIZE;
+		size_t writes_before = region->writes();
+		for(size_t i = 0; i < RECORD_COUNT; i++)
+		{
+			if(false == popExpected(i, DATA_SIZE))
+			{
+				return false;
+			}
+		}
+		m_writes = region->writes() - writes_before;
+		size_t max_writes =
+			(RECORD_COUNT / FlashQueue::POP_COMMIT_INTERVAL) + pages + 1;
+		if(
+			(m_writes > max_writes) ||
+			(false == open(false, PAGE_COUNT)) ||
+			(false == m_queue->isEmpty()))
+		{
+			return false;
+		}
+
+		//Removing fewer records than the interval, in one page, is not
+		//	written until the queue empties
+		if(
+			(false == push(0, DATA_SIZE)) ||
+			(false == push(1, DATA_SIZE)) ||
+			(false == push(2, DATA_SIZE)) ||
+			(false == popExpected(0, DATA_SIZE)) ||
+			(false == popExpected(1, DATA_SIZE)) ||
+			(false == open(false, PAGE_COUNT)))
+		{
+			return false;
+		}
+		return
+			(true == popExpected(0, DATA_SIZE)) &&
+			(true == popExpected(1, DATA_SIZE)) &&
+			(true == popExpected(2, DATA_SIZE)) &&
+			(true == open(false, PAGE_COUNT)) &&
+			(true == m_queue->isEmpty());
+	}
+
+	/**
+	 * Print the result of the most recent test
+	 */
+	std::string printResult()
+	{
+		std::string result = m_name;
+		result += "\nResult:\n";
+		result += "\tlast status = ";
+		result += std::to_string(static_cast<int>(m_result)) + "\n";
+		result += "\theader reads = " + std::to_string(m_header_reads) + "\n";
+		result += "\tpage writes = " + std::to_string(m_writes) + "\n";
+		if(nullptr != m_queue)
+		{
+			result += "\tused = " + std::to_string(m_queue->used()) + "\n";
+		}
+		return result;
+	}
+
+	private:
+	/**
+	 * Open the queue, after closing it if it's open
+	 * @param erase - Start from an erased region
+	 */
+	bool open(bool erase, size_t page_count)
+	{
+		m_queue.reset();
+		m_region.reset();
+		if(true == erase)
+		{
+			unlink(REGION_PATH);
+		}
+		m_region.reset(new MappedFileRegion(REGION_PATH, page_count));
+		m_queue.reset(new FlashQueue(*m_region));
+		m_result = m_queue->begin();
+		return FlashQueue::Return::READY == m_result;
+	}
+
+	//Three of these always fit into a queue of PAGE_COUNT pages
+	static size_t length(size_t i)
+	{
+		return (i * 37) % 500;
+	}
+
+	static void fill(uint8_t data[], size_t i, size_t len)
+	{
+		for(size_t j = 0; j < len; j++)
+		{
+			data[j] = static_cast<uint8_t>((i * 31) + j);
+		}
+	}
+
+	bool push(size_t i, size_t len)
+	{
+		uint8_t data[RECORD_MAX_SIZE];
+		fill(data, i, len);
+		m_result = m_queue->push(static_cast<uint16_t>(i), data, len);
+		return FlashQueue::Return::RECORD_ADDED == m_result;
+	}
+
+	bool popExpected(size_t i, size_t len)
+	{
+		uint8_t expected[RECORD_MAX_SIZE];
+		uint8_t data[RECORD_MAX_SIZE];
+		size_t data_len = 0;
+		uint16_t tag;
+		fill(expected, i, len);
+		//A buffer too small for the record still gives its length
+		m_result = m_queue->peek(&tag, data, &data_len);
+		if(
+			(0 != len) &&
+			((FlashQueue::Return::BUFFER_TOO_SMALL != m_result) ||
+			(len != data_len)))
+		{
+			return false;
+		}
+		data_len = sizeof data;
+		m_result = m_queue->peek(&tag, data, &data_len);
+		if(
+			(FlashQueue::Return::RECORD_READ != m_result) ||
+			(static_cast<uint16_t>(i) != tag) ||
+			(len != data_len) ||
+			(0 != memcmp(expected, data, len)))
+		{
+			return false;
+		}
+		m_result = m_queue->pop();
+		return FlashQueue::Return::RECORD_REMOVED == m_result;
+	}
+
+	std::unique_ptr<FlashRegion> m_region;
+	std::unique_ptr<FlashQueue> m_queue;
+	FlashQueue::Return m_result = FlashQueue::Return::QUEUE_EMPTY;
+	size_t m_header_reads = 0;
+	size_t m_writes = 0;
+	std::string m_name;
+};
+
+
+int main()
+{
+	TestFlashQueue test;
+
+	if(false == test.fifo())
+	{
+		std::cout << test.printResult();
+		return -1;
+	}
+
+	if(false == test.persistence())
+	{
+		std::cout << test.printResult();
+		return -1;
+	}
+
+	if(false == test.wrapAround())
+	{
+		std::cout << test.printResult();
+		return -1;
+	}
+
+	if(false == test.full())
+	{
+		std::cout << test.printResult();
+		return -1;
+	}
+
+	if(false == test.powerLoss())
+	{
+		std::cout << test.printResult();
+		return -1;
+	}
+
+	if(false == test.fastRecovery())
+	{
+		std::cout << test.printResult();
+		return -1;
+	}
+
+	if(false == test.corruptRecord())
+	{
+		std::cout << test.printResult();
+		return -1;
+	}
+
+	if(false == test.drainWear())
+	{
+		std::cout << test.printResult();
+		return -1;
+	}
+
+	unlink(REGION_PATH);
+	return 0;
+}
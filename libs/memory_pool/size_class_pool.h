@@ -0,0 +1,496 @@
+/**
+ * size_class_pool.h
+ * Fixed arena of blocks in three size classes, for buffers whose length
+ * varies, such as publish payloads. A buffer takes a block of the smallest
+ * class it fits in, or of a larger class when that one is used up. Each class
+ * keeps the indices of its free blocks on a stack, like StaticQueue, and a
+ * block is found by its address when it is freed, so allocating and freeing
+ * are O(1), and the arena never breaks up into pieces too small to use.
+ * What is lost instead is the unused end of each block, which is reported as
+ * wasted bytes. A class can be given no blocks, and then takes up no RAM.
+ */
+
+#ifndef SIZE_CLASS_POOL_H
+#define SIZE_CLASS_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+/**
+ *	Fixed number of blocks of one size
+ */
+template <size_t BLOCK_SIZE, size_t N_BLOCKS>
+class BlockPool {
+	public:
+	BlockPool()
+	{
+		m_high_water = 0;
+		reset();
+	}
+
+	/**
+	 *	Take a free block
+	 *	@param len - Bytes of the block that will be used, for the statistics
+	 *	@return
+	 *		nullptr - Every block is used
+	 *		Otherwise, the block
+	 */
+	uint8_t *allocate(size_t len)
+	{
+		if(0 == m_free_count)
+		{
+			return nullptr;
+		}
+		Index idx = m_free[--m_free_count];
+		m_lengths[idx] = static_cast<Length>(len);
+		m_requested += len;
+		if(used() > m_high_water)
+		{
+			m_high_water = used();
+		}
+		return m_blocks[idx];
+	}
+
+	/**
+	 *	Give back a block taken with BlockPool::allocate()
+	 */
+	void free(uint8_t *block)
+	{
+		Index idx = index(block);
+		m_requested -= m_lengths[idx];
+		m_free[m_free_count++] = idx;
+	}
+
+	/**
+	 *	Change the number of bytes used of a block taken with
+	 *	BlockPool::allocate()
+	 *	@return
+	 *		true on success
+	 *		false - len doesn't fit in a block
+	 */
+	bool resize(uint8_t *block, size_t len)
+	{
+		if(len > BLOCK_SIZE)
+		{
+			return false;
+		}
+		Index idx = index(block);
+		m_requested = m_requested - m_lengths[idx] + len;
+		m_lengths[idx] = static_cast<Length>(len);
+		return true;
+	}
+
+	/**
+	 *	Check if a block is in this pool
+	 */
+	bool owns(uint8_t const *block) const
+	{
+		uintptr_t addr = reinterpret_cast<uintptr_t>(block);
+		uintptr_t first = reinterpret_cast<uintptr_t>(m_blocks[0]);
+		return (addr >= first) && (addr < (first + sizeof m_blocks));
+	}
+
+	/**
+	 *	Number of blocks taken
+	 */
+	size_t used() const
+	{
+		return N_BLOCKS - m_free_count;
+	}
+
+	/**
+	 *	Number of blocks free
+	 */
+	size_t available() const
+	{
+		return m_free_count;
+	}
+
+	/**
+	 *	Most blocks ever taken at once
+	 */
+	size_t highWater() const
+	{
+		return m_high_water;
+	}
+
+	/**
+	 *	Bytes used of the blocks taken
+	 */
+	size_t requested() const
+	{
+		return m_requested;
+	}
+
+	/**
+	 *	Free every block. The high-water mark is kept
+	 */
+	void reset()
+	{
+		for(size_t i = 0; i < N_BLOCKS; i++)
+		{
+			m_free[i] = static_cast<Index>(N_BLOCKS - 1 - i);
+		}
+		m_free_count = N_BLOCKS;
+		m_requested = 0;
+	}
+
+	private:
+	//The smallest types that hold an index into m_blocks, and a length
+	typedef typename std::conditional<
+		(N_BLOCKS <= 0xFF),
+		uint8_t,
+		typename std::conditional<
+			(N_BLOCKS <= 0xFFFF),
+			uint16_t,
+			uint32_t>::type>::type Index;
+	typedef typename std::conditional<
+		(BLOCK_SIZE <= 0xFFFF),
+		uint16_t,
+		uint32_t>::type Length;
+
+	Index index(uint8_t const *block) const
+	{
+		return static_cast<Index>((block - m_blocks[0]) / BLOCK_SIZE);
+	}
+
+	alignas(std::max_align_t) uint8_t m_blocks[N_BLOCKS][BLOCK_SIZE];
+	//Stack of the indices of the free blocks
+	Index m_free[N_BLOCKS];
+	size_t m_free_count;
+	//Bytes used of each block
+	Length m_lengths[N_BLOCKS];
+	size_t m_requested;
+	size_t m_high_water;
+};
+
+
+/**
+ *	Class without blocks, which never hands one out
+ */
+template <size_t BLOCK_SIZE>
+class BlockPool<BLOCK_SIZE, 0> {
+	public:
+	uint8_t *allocate(size_t)
+	{
+		return nullptr;
+	}
+
+	void free(uint8_t *)
+	{
+	}
+
+	bool resize(uint8_t *, size_t)
+	{
+		return false;
+	}
+
+	bool owns(uint8_t const *) const
+	{
+		return false;
+	}
+
+	size_t used() const
+	{
+		return 0;
+	}
+
+	size_t available() const
+	{
+		return 0;
+	}
+
+	size_t highWater() const
+	{
+		return 0;
+	}
+
+	size_t requested() const
+	{
+		return 0;
+	}
+
+	void reset()
+	{
+	}
+};
+
+
+/**
+ *	@tparam N_SMALL - Number of 64 byte blocks
+ *	@tparam N_MEDIUM - Number of 256 byte blocks
+ *	@tparam N_LARGE - Number of 1024 byte blocks
+ *	Any of them may be 0, but not all
+ */
+template <size_t N_SMALL, size_t N_MEDIUM, size_t N_LARGE>
+class SizeClassPool {
+	public:
+	static size_t constexpr SMALL_BLOCK_SIZE = 64;
+	static size_t constexpr MEDIUM_BLOCK_SIZE = 256;
+	static size_t constexpr LARGE_BLOCK_SIZE = 1024;
+	//Largest buffer the pool hands out, the block size of the largest class
+	//	that has blocks
+	static size_t constexpr MAX_SIZE =
+		(N_LARGE > 0) ? LARGE_BLOCK_SIZE :
+		(N_MEDIUM > 0) ? MEDIUM_BLOCK_SIZE :
+		(N_SMALL > 0) ? SMALL_BLOCK_SIZE : 0;
+	static size_t constexpr CLASSES = 3;
+
+	static_assert(MAX_SIZE > 0, "A pool must have blocks in at least one class");
+
+	class ClassStats {
+		public:
+		size_t block_size;
+		size_t blocks;
+		size_t used;
+		size_t high_water;
+	};
+
+	SizeClassPool()
+	{
+		m_failures = 0;
+		m_spills = 0;
+	}
+
+	/**
+	 *	Take a block for a buffer, from the smallest class it fits in that
+	 *	has a free block
+	 *	@param len - Length of the buffer in bytes
+	 *	@return
+	 *		nullptr - No class that len fits in has a free block
+	 *		Otherwise, a block of at least len bytes
+	 */
+	uint8_t *allocate(size_t len)
+	{
+		uint8_t *block = nullptr;
+		if(len <= SMALL_BLOCK_SIZE)
+		{
+			block = m_small.allocate(len);
+		}
+		if((nullptr == block) && (len <= MEDIUM_BLOCK_SIZE))
+		{
+			block = m_medium.allocate(len);
+		}
+		if((nullptr == block) && (len <= LARGE_BLOCK_SIZE))
+		{
+			block = m_large.allocate(len);
+		}
+		if(nullptr == block)
+		{
+			m_failures++;
+			return nullptr;
+		}
+		if(blockSize(block) != fittingBlockSize(len))
+		{
+			m_spills++;
+		}
+		return block;
+	}
+
+	/**
+	 *	Check if SizeClassPool::allocate() would succeed
+	 */
+	bool canAllocate(size_t len) const
+	{
+		return len <= largestAvailable();
+	}
+
+	/**
+	 *	Give back a block taken with SizeClassPool::allocate(). nullptr is
+	 *	ignored
+	 */
+	void free(uint8_t *block)
+	{
+		if(true == m_small.owns(block))
+		{
+			m_small.free(block);
+		}
+		else if(true == m_medium.owns(block))
+		{
+			m_medium.free(block);
+		}
+		else if(true == m_large.owns(block))
+		{
+			m_large.free(block);
+		}
+	}
+
+	/**
+	 *	Reuse a block for a buffer of a different length, if it fits
+	 *	@return
+	 *		true on success
+	 *		false - len doesn't fit in the block, which is left as it was
+	 */
+	bool resize(uint8_t *block, size_t len)
+	{
+		if(true == m_small.owns(block))
+		{
+			return m_small.resize(block, len);
+		}
+		if(true == m_medium.owns(block))
+		{
+			return m_medium.resize(block, len);
+		}
+		if(true == m_large.owns(block))
+		{
+			return m_large.resize(block, len);
+		}
+		return false;
+	}
+
+	/**
+	 *	Size of a block taken with SizeClassPool::allocate(), or 0 for a
+	 *	buffer that isn't from the pool
+	 */
+	size_t blockSize(uint8_t const *block) const
+	{
+		if(true == m_small.owns(block))
+		{
+			return SMALL_BLOCK_SIZE;
+		}
+		if(true == m_medium.owns(block))
+		{
+			return MEDIUM_BLOCK_SIZE;
+		}
+		if(true == m_large.owns(block))
+		{
+			return LARGE_BLOCK_SIZE;
+		}
+		return 0;
+	}
+
+	/**
+	 *	Size of the largest free block, or 0 if every block is taken. A buffer
+	 *	longer than this can't be allocated, however many bytes are free
+	 */
+	size_t largestAvailable() const
+	{
+		if(m_large.available() > 0)
+		{
+			return LARGE_BLOCK_SIZE;
+		}
+		if(m_medium.available() > 0)
+		{
+			return MEDIUM_BLOCK_SIZE;
+		}
+		if(m_small.available() > 0)
+		{
+			return SMALL_BLOCK_SIZE;
+		}
+		return 0;
+	}
+
+	/**
+	 *	Use of one size class
+	 *	@param size_class - 0 for the smallest, up to CLASSES - 1
+	 */
+	ClassStats stats(size_t size_class) const
+	{
+		ClassStats s;
+		switch(size_class)
+		{
+			case 0:
+				s = {SMALL_BLOCK_SIZE, N_SMALL, m_small.used(), m_small.highWater()};
+				break;
+			case 1:
+				s = {MEDIUM_BLOCK_SIZE, N_MEDIUM, m_medium.used(), m_medium.highWater()};
+				break;
+			default:
+				s = {LARGE_BLOCK_SIZE, N_LARGE, m_large.used(), m_large.highWater()};
+				break;
+		}
+		return s;
+	}
+
+	/**
+	 *	Bytes in the blocks taken
+	 */
+	size_t reservedBytes() const
+	{
+		return
+			(m_small.used() * SMALL_BLOCK_SIZE) +
+			(m_medium.used() * MEDIUM_BLOCK_SIZE) +
+			(m_large.used() * LARGE_BLOCK_SIZE);
+	}
+
+	/**
+	 *	Bytes asked for in the blocks taken
+	 */
+	size_t requestedBytes() const
+	{
+		return m_small.requested() + m_medium.requested() + m_large.requested();
+	}
+
+	/**
+	 *	Bytes taken but not asked for, at the ends of the blocks. This is the
+	 *	fragmentation of the pool
+	 */
+	size_t wastedBytes() const
+	{
+		return reservedBytes() - requestedBytes();
+	}
+
+	/**
+	 *	Bytes in the free blocks
+	 */
+	size_t freeBytes() const
+	{
+		return ARENA_SIZE - reservedBytes();
+	}
+
+	/**
+	 *	Number of buffers refused since the pool was created
+	 */
+	uint32_t failures() const
+	{
+		return m_failures;
+	}
+
+	/**
+	 *	Number of buffers given a block of a larger class than they fit in,
+	 *	because that class was used up, since the pool was created
+	 */
+	uint32_t spills() const
+	{
+		return m_spills;
+	}
+
+	/**
+	 *	Free every block. The statistics other than the use of the blocks are
+	 *	kept
+	 */
+	void reset()
+	{
+		m_small.reset();
+		m_medium.reset();
+		m_large.reset();
+	}
+
+	private:
+	static size_t constexpr ARENA_SIZE =
+		(N_SMALL * SMALL_BLOCK_SIZE) +
+		(N_MEDIUM * MEDIUM_BLOCK_SIZE) +
+		(N_LARGE * LARGE_BLOCK_SIZE);
+
+	static size_t fittingBlockSize(size_t len)
+	{
+		if((N_SMALL > 0) && (len <= SMALL_BLOCK_SIZE))
+		{
+			return SMALL_BLOCK_SIZE;
+		}
+		if((N_MEDIUM > 0) && (len <= MEDIUM_BLOCK_SIZE))
+		{
+			return MEDIUM_BLOCK_SIZE;
+		}
+		return LARGE_BLOCK_SIZE;
+	}
+
+	BlockPool<SMALL_BLOCK_SIZE, N_SMALL> m_small;
+	BlockPool<MEDIUM_BLOCK_SIZE, N_MEDIUM> m_medium;
+	BlockPool<LARGE_BLOCK_SIZE, N_LARGE> m_large;
+	uint32_t m_failures;
+	uint32_t m_spills;
+};
+
+#endif //SIZE_CLASS_POOL_H
@@ -0,0 +1,250 @@
+/**
+ * test.cpp
+ * Unit test for SizeClassPool
+ */
+
+#include "size_class_pool.h"
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+typedef SizeClassPool<4, 2, 1> TestPool;
+
+
+class TestSizeClassPool {
+	public:
+	TestSizeClassPool() {}
+
+	/**
+	 * Allocate buffers of each class, and one too large for any
+	 * Verify that each gets the smallest block it fits in, and that the
+	 * blocks don't overlap
+	 */
+	bool sizeClasses()
+	{
+		m_name.assign("sizeClasses");
+		TestPool pool;
+		uint8_t *small = pool.allocate(TestPool::SMALL_BLOCK_SIZE);
+		uint8_t *medium = pool.allocate(TestPool::SMALL_BLOCK_SIZE + 1);
+		uint8_t *large = pool.allocate(900);
+		uint8_t *too_large = pool.allocate(TestPool::MAX_SIZE + 1);
+		if(
+			(nullptr == small) ||
+			(nullptr == medium) ||
+			(nullptr == large) ||
+			(nullptr != too_large))
+		{
+			return false;
+		}
+		memset(small, 1, TestPool::SMALL_BLOCK_SIZE);
+		memset(medium, 2, TestPool::MEDIUM_BLOCK_SIZE);
+		memset(large, 3, TestPool::LARGE_BLOCK_SIZE);
+		return record(
+			pool,
+			(TestPool::SMALL_BLOCK_SIZE == pool.blockSize(small)) &&
+			(TestPool::MEDIUM_BLOCK_SIZE == pool.blockSize(medium)) &&
+			(TestPool::LARGE_BLOCK_SIZE == pool.blockSize(large)) &&
+			(1 == small[TestPool::SMALL_BLOCK_SIZE - 1]) &&
+			(2 == medium[TestPool::MEDIUM_BLOCK_SIZE - 1]) &&
+			(1 == pool.failures()) &&
+			(0 == pool.spills()));
+	}
+
+	/**
+	 * Use up the small blocks, then allocate small buffers until the pool
+	 * is empty
+	 * Verify that they spill over into the larger classes, that the pool
+	 * refuses a buffer once it is empty, and that a freed block is the one
+	 * handed out next
+	 */
+	bool spillOver()
+	{
+		m_name.assign("spillOver");
+		TestPool pool;
+		uint8_t *blocks[7];
+		for(size_t i = 0; i < 7; i++)
+		{
+			blocks[i] = pool.allocate(8);
+			if(nullptr == blocks[i])
+			{
+				return false;
+			}
+		}
+		if(
+			(TestPool::MEDIUM_BLOCK_SIZE != pool.blockSize(blocks[4])) ||
+			(TestPool::LARGE_BLOCK_SIZE != pool.blockSize(blocks[6])) ||
+			(3 != pool.spills()) ||
+			(0 != pool.largestAvailable()) ||
+			(nullptr != pool.allocate(1)))
+		{
+			return false;
+		}
+		pool.free(blocks[5]);
+		return record(
+			pool,
+			(TestPool::MEDIUM_BLOCK_SIZE == pool.largestAvailable()) &&
+			(false == pool.canAllocate(TestPool::MEDIUM_BLOCK_SIZE + 1)) &&
+			(blocks[5] == pool.allocate(TestPool::MEDIUM_BLOCK_SIZE)) &&
+			(1 == pool.failures()));
+	}
+
+	/**
+	 * Allocate, resize and free buffers
+	 * Verify the bytes reserved, requested and wasted, and the use and
+	 * high-water mark of each class
+	 */
+	bool statistics()
+	{
+		m_name.assign("statistics");
+		TestPool pool;
+		uint8_t *a = pool.allocate(10);
+		uint8_t *b = pool.allocate(20);
+		uint8_t *c = pool.allocate(200);
+		if(
+			(384 != pool.reservedBytes()) ||
+			(230 != pool.requestedBytes()) ||
+			(154 != pool.wastedBytes()) ||
+			(false == pool.resize(c, 256)) ||
+			(true == pool.resize(a, 65)) ||
+			(98 != pool.wastedBytes()))
+		{
+			return false;
+		}
+		pool.free(a);
+		pool.free(b);
+		pool.free(nullptr);
+		TestPool::ClassStats small = pool.stats(0);
+		TestPool::ClassStats medium = pool.stats(1);
+		TestPool::ClassStats large = pool.stats(2);
+		size_t arena = (4 * 64) + (2 * 256) + 1024;
+		return record(
+			pool,
+			(0 == small.used) &&
+			(2 == small.high_water) &&
+			(4 == small.blocks) &&
+			(1 == medium.used) &&
+			(1 == medium.high_water) &&
+			(0 == large.high_water) &&
+			(0 == pool.wastedBytes()) &&
+			((arena - 256) == pool.freeBytes()));
+	}
+
+	/**
+	 * Free every block with SizeClassPool::reset()
+	 * Verify that the pool is empty and keeps its high-water marks
+	 */
+	bool reset()
+	{
+		m_name.assign("reset");
+		TestPool pool;
+		while(nullptr != pool.allocate(1))
+		{
+		}
+		pool.reset();
+		return record(
+			pool,
+			(0 == pool.reservedBytes()) &&
+			(0 == pool.requestedBytes()) &&
+			(TestPool::LARGE_BLOCK_SIZE == pool.largestAvailable()) &&
+			(4 == pool.stats(0).high_water) &&
+			(1 == pool.stats(2).high_water));
+	}
+
+	/**
+	 * Use a pool without small or large blocks
+	 * Verify that it takes no RAM for them, that small buffers go to the
+	 * medium blocks without counting as spills, and that nothing larger than
+	 * a medium block is handed out
+	 */
+	bool emptyClasses()
+	{
+		m_name.assign("emptyClasses");
+		typedef SizeClassPool<0, 2, 0> MediumPool;
+		MediumPool pool;
+		uint8_t *a = pool.allocate(1);
+		uint8_t *b = pool.allocate(MediumPool::MEDIUM_BLOCK_SIZE);
+		return record(
+			pool,
+			(sizeof(MediumPool) < (3 * MediumPool::MEDIUM_BLOCK_SIZE)) &&
+			(MediumPool::MEDIUM_BLOCK_SIZE == MediumPool::MAX_SIZE) &&
+			(MediumPool::MEDIUM_BLOCK_SIZE == pool.blockSize(a)) &&
+			(MediumPool::MEDIUM_BLOCK_SIZE == pool.blockSize(b)) &&
+			(0 == pool.spills()) &&
+			(0 == pool.largestAvailable()) &&
+			(nullptr == pool.allocate(1)) &&
+			(0 == pool.stats(0).blocks) &&
+			(0 == pool.stats(2).high_water) &&
+			(true == pool.resize(a, MediumPool::MEDIUM_BLOCK_SIZE)) &&
+			(false == pool.resize(a, MediumPool::MEDIUM_BLOCK_SIZE + 1)));
+	}
+
+	std::string printResult()
+	{
+		std::string result = m_name;
+		result += "\nResult:\n";
+		result += "\treserved = " + std::to_string(m_reserved) + "\n";
+		result += "\trequested = " + std::to_string(m_requested) + "\n";
+		result += "\tfailures = " + std::to_string(m_failures) + "\n";
+		result += "\tspills = " + std::to_string(m_spills) + "\n";
+		return result;
+	}
+
+	private:
+	/**
+	 * Keep the statistics of the pool a test ends with, for printResult()
+	 */
+	template <class Pool>
+	bool record(Pool const &pool, bool result)
+	{
+		m_reserved = pool.reservedBytes();
+		m_requested = pool.requestedBytes();
+		m_failures = pool.failures();
+		m_spills = pool.spills();
+		return result;
+	}
+
+	size_t m_reserved = 0;
+	size_t m_requested = 0;
+	uint32_t m_failures = 0;
+	uint32_t m_spills = 0;
+	std::string m_name;
+};
+
+
+int main()
+{
+	TestSizeClassPool test;
+
+	if(false == test.sizeClasses())
+	{
+		std::cout << test.printResult();
+		return -1;
+	}
+
+	if(false == test.spillOver())
+	{
+		std::cout << test.printResult();
+		return -1;
+	}
+
+	if(false == test.statistics())
+	{
+		std::cout << test.printResult();
+		return -1;
+	}
+
+	if(false == test.reset())
+	{
+		std::cout << test.printResult();
+		return -1;
+	}
+
+	if(false == test.emptyClasses())
+	{
+		std::cout << test.printResult();
+		return -1;
+	}
+
+	return 0;
+}
@@ -8,6 +8,11 @@
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <utility>
+
+//Selects the LinkedNode constructor that passes its arguments on to the
+//	constructor of the value
+struct LinkedNodeInPlace {};
 
 template <typename T>
 class LinkedNode {
@@ -17,9 +22,19 @@ class LinkedNode {
 		m_next = nullptr;
 		m_prev = nullptr;
 	}
-	LinkedNode(T const &value)
+	LinkedNode(T const &value) : m_value(value)
+	{
+		m_next = nullptr;
+		m_prev = nullptr;
+	}
+
+	/**
+	 * Construct the value in the node from the arguments
+	 */
+	template <typename... Args>
+	LinkedNode(LinkedNodeInPlace, Args&&... args) :
+		m_value(std::forward<Args>(args)...)
 	{
-		m_value = value;
 		m_next = nullptr;
 		m_prev = nullptr;
 	}
@@ -55,6 +70,17 @@ class LinkedNode {
 		m_linked = false;
 	}
 
+	/**
+	 * Forget the links without touching the neighbours, for when the whole
+	 * list is being cleared
+	 */
+	void reset()
+	{
+		m_prev = nullptr;
+		m_next = nullptr;
+		m_linked = false;
+	}
+
 	LinkedNode<T> *prev()
 	{
 		return m_prev;
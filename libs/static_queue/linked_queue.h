@@ -24,6 +24,7 @@ class LinkedQueue {
 		m_head = head_init;
 		m_tail = tail_init;
 		m_full = false;
+		m_length = 0;
 	}
 
 	bool enqueueNode(LinkedNode<T> *elem)
@@ -34,10 +35,14 @@ class LinkedQueue {
 		}
 		if(nullptr == m_tail)
 		{
+			//The previous head may have been dequeued, so don't link to it.
+			//	A node linked to itself is a single element list.
 			m_tail = elem;
+			m_head = elem;
 		}
 		m_head->link(elem);
 		m_head = elem;
+		m_length++;
 		
 		return true;
 	}
@@ -70,6 +75,7 @@ class LinkedQueue {
 		m_tail = m_tail->next();
 		elem->unlink();
 		m_full = false;
+		m_length--;
 		return elem;
 	}
 
@@ -87,6 +93,11 @@ class LinkedQueue {
 
 	void remove(LinkedNode<T> *elem)
 	{
+		//Not in the list
+		if(false == elem->isLinked())
+		{
+			return;
+		}
 		if(m_tail == elem)
 		{
 			dequeue();
@@ -97,6 +108,7 @@ class LinkedQueue {
 			m_head = m_head->prev();
 		}
 		m_full = false;
+		m_length--;
 		elem->unlink();
 	}
 
@@ -119,12 +131,7 @@ class LinkedQueue {
 
 	size_t length()
 	{
-		size_t len = 0;
-		for(LinkedNode<T> *elem = m_tail; nullptr != elem; elem = elem->next())
-		{
-			len++;
-		}
-		return len;
+		return m_length;
 	}
 
 
@@ -132,6 +139,7 @@ class LinkedQueue {
 	LinkedNode<T> *m_head = nullptr;
 	LinkedNode<T> *m_tail = nullptr;
 	bool m_full = false;
+	size_t m_length = 0;
 };
 
 #endif //LINKED_QUEUE_H
@@ -0,0 +1,101 @@
+/**
+ * ring_queue.h
+ * FIFO queue in a fixed array used as a ring, with the insert, peak and
+ * dequeue interface of StaticQueue. It takes no space per element besides
+ * the element, and its elements are contiguous, but it can't remove an
+ * element from the middle of the queue. The size is a power of two, so that
+ * the positions wrap with a mask.
+ */
+
+#ifndef RING_QUEUE_H
+#define RING_QUEUE_H
+
+#include <cstddef>
+#include <cstdint>
+
+template <typename T, size_t N_MEMB>
+class RingQueue {
+	public:
+	static_assert(
+		(0 != N_MEMB) && (0 == (N_MEMB & (N_MEMB - 1))),
+		"N_MEMB must be a power of two");
+
+	RingQueue()
+	{
+		reset();
+	}
+
+	bool insert(T const &elem)
+	{
+		if(true == isFull())
+		{
+			return false;
+		}
+		m_array[m_head & MASK] = elem;
+		m_head++;
+		return true;
+	}
+
+	bool insert(T const *elem)
+	{
+		return insert(*elem);
+	}
+
+	/**
+	 *	The oldest element, or nullptr if the queue is empty
+	 */
+	T *peak()
+	{
+		if(true == isEmpty())
+		{
+			return nullptr;
+		}
+		return &m_array[m_tail & MASK];
+	}
+
+	/**
+	 *	Dequeue the oldest element. Its slot is free, so the element is only
+	 *	valid until N_MEMB more elements have been inserted
+	 */
+	T *dequeue()
+	{
+		T *elem = peak();
+		if(nullptr != elem)
+		{
+			m_tail++;
+		}
+		return elem;
+	}
+
+	bool isEmpty()
+	{
+		return m_head == m_tail;
+	}
+
+	bool isFull()
+	{
+		return N_MEMB == length();
+	}
+
+	size_t length()
+	{
+		return m_head - m_tail;
+	}
+
+	void reset()
+	{
+		m_head = 0;
+		m_tail = 0;
+	}
+
+	private:
+	static size_t constexpr MASK = N_MEMB - 1;
+
+	T m_array[N_MEMB];
+	//Number of elements inserted and dequeued since the last reset. They
+	//	wrap around together, so their difference is always the length
+	size_t m_head;
+	size_t m_tail;
+};
+
+#endif //RING_QUEUE_H
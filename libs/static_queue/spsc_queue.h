@@ -0,0 +1,187 @@
+/**
+ * spsc_queue.h
+ * Wait-free FIFO queue for one producer and one consumer running
+ * concurrently, such as an interrupt handler and the main loop, or two
+ * threads. It is a power-of-two ring like RingQueue. The producer only
+ * writes the head, and the consumer only writes the tail. Each side
+ * publishes its index with release ordering after it is done with the
+ * element, and reads the other side's index with acquire ordering before
+ * it touches the element.
+ *
+ * On the Cortex-M3, aligned word loads and stores are atomic, and a DMB
+ * orders the element against the index. Elsewhere, std::atomic is used, and
+ * the indices are kept on separate cache lines.
+ */
+
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__ARM_ARCH_7M__)
+#define SPSC_QUEUE_CORTEX_M
+#else
+#include <atomic>
+#endif
+
+template <typename T, size_t N_MEMB>
+class SPSCQueue {
+	public:
+	static_assert(
+		(0 != N_MEMB) && (0 == (N_MEMB & (N_MEMB - 1))),
+		"N_MEMB must be a power of two");
+
+	SPSCQueue()
+	{
+		storeRelease(m_head, 0);
+		storeRelease(m_tail, 0);
+		m_cached_head = 0;
+		m_cached_tail = 0;
+	}
+
+	/**
+	 *	Add an element. Producer only
+	 *	@return
+	 *		true on success
+	 *		false - The queue is full
+	 */
+	bool insert(T const &elem)
+	{
+		size_t head = loadRelaxed(m_head);
+		if(N_MEMB == (head - m_cached_tail))
+		{
+			m_cached_tail = loadAcquire(m_tail);
+			if(N_MEMB == (head - m_cached_tail))
+			{
+				return false;
+			}
+		}
+		m_array[head & MASK] = elem;
+		storeRelease(m_head, head + 1);
+		return true;
+	}
+
+	/**
+	 *	The oldest element, or nullptr if the queue is empty. Consumer only.
+	 *	The element stays valid until SPSCQueue::pop() is called
+	 */
+	T *peak()
+	{
+		size_t tail = loadRelaxed(m_tail);
+		if(tail == m_cached_head)
+		{
+			m_cached_head = loadAcquire(m_head);
+			if(tail == m_cached_head)
+			{
+				return nullptr;
+			}
+		}
+		return &m_array[tail & MASK];
+	}
+
+	/**
+	 *	Remove the oldest element, which must have been returned by
+	 *	SPSCQueue::peak(). Consumer only
+	 */
+	void pop()
+	{
+		storeRelease(m_tail, loadRelaxed(m_tail) + 1);
+	}
+
+	/**
+	 *	Copy the oldest element out and remove it. Consumer only
+	 *	@return
+	 *		true on success
+	 *		false - The queue is empty
+	 */
+	bool dequeue(T *elem)
+	{
+		T *oldest = peak();
+		if(nullptr == oldest)
+		{
+			return false;
+		}
+		*elem = *oldest;
+		pop();
+		return true;
+	}
+
+	/**
+	 *	Check if the queue is empty. Exact for the consumer, while the
+	 *	producer may add an element right after
+	 */
+	bool isEmpty()
+	{
+		return 0 == length();
+	}
+
+	/**
+	 *	Number of elements in the queue. Exact for neither side while the
+	 *	other is running
+	 */
+	size_t length()
+	{
+		size_t tail = loadAcquire(m_tail);
+		return loadAcquire(m_head) - tail;
+	}
+
+	private:
+	static size_t constexpr MASK = N_MEMB - 1;
+
+#ifdef SPSC_QUEUE_CORTEX_M
+	typedef size_t volatile Index;
+	static size_t constexpr INDEX_ALIGN = alignof(size_t);
+
+	static void barrier()
+	{
+		__asm__ volatile("dmb" ::: "memory");
+	}
+
+	static size_t loadRelaxed(Index &index)
+	{
+		return index;
+	}
+
+	static size_t loadAcquire(Index &index)
+	{
+		size_t value = index;
+		barrier();
+		return value;
+	}
+
+	static void storeRelease(Index &index, size_t value)
+	{
+		barrier();
+		index = value;
+	}
+#else
+	typedef std::atomic<size_t> Index;
+	static size_t constexpr INDEX_ALIGN = 64;
+
+	static size_t loadRelaxed(Index &index)
+	{
+		return index.load(std::memory_order_relaxed);
+	}
+
+	static size_t loadAcquire(Index &index)
+	{
+		return index.load(std::memory_order_acquire);
+	}
+
+	static void storeRelease(Index &index, size_t value)
+	{
+		index.store(value, std::memory_order_release);
+	}
+#endif //SPSC_QUEUE_CORTEX_M
+
+	T m_array[N_MEMB];
+	//Written by the producer, along with its copy of the tail
+	alignas(INDEX_ALIGN) Index m_head;
+	size_t m_cached_tail;
+	//Written by the consumer, along with its copy of the head
+	alignas(INDEX_ALIGN) Index m_tail;
+	size_t m_cached_head;
+};
+
+#endif //SPSC_QUEUE_H
@@ -6,101 +6,183 @@
 #define STATIC_QUEUE_H
 
 #include "linked_queue.h"
+#include <new>
+#include <type_traits>
+#include <utility>
 
+/**
+ *	LinkedQueue with its nodes in a fixed array. The indices of the free
+ *	slots are kept on a stack, so insert, dequeue and remove don't search for
+ *	a slot, and the slot freed last is the one used next.
+ *	A slot is left unconstructed until it is first used, and an element is
+ *	constructed in its slot, so queueing an element costs one construction
+ *	and no copies of the node. An element stays in its slot until the slot
+ *	is used again.
+ *	Nodes must be dequeued and removed through the StaticQueue, rather than
+ *	through a LinkedQueue, for their slots to be freed.
+ */
 template <typename T, size_t N_MEMB>
 class StaticQueue : public LinkedQueue<T> {
 	public:
-	StaticQueue() : LinkedQueue<T>(&m_array[0], nullptr)
+	StaticQueue() : LinkedQueue<T>(nullptr, nullptr)
 	{
-		m_next_available_slot = &m_array[0];
-		m_slot_index = 0;
+		m_constructed = 0;
+		resetFreeSlots();
 	}
 
-	bool insert(T const &elem)
+	~StaticQueue()
+	{
+		for(size_t i = 0; i < m_constructed; i++)
+		{
+			getNode(i)->~LinkedNode<T>();
+		}
+	}
+
+	/**
+	 *	Construct an element at the end of the queue from the arguments given
+	 *	to its constructor
+	 *	@return
+	 *		nullptr - The queue is full
+	 *		Otherwise, the element
+	 */
+	template <typename... Args>
+	T *emplace(Args&&... args)
 	{
-		if(nullptr == m_next_available_slot)
+		if(0 == m_free_count)
+		{
+			return nullptr;
+		}
+		size_t idx = m_free[--m_free_count];
+		LinkedNode<T> *slot = getNode(idx);
+		if(idx < m_constructed)
 		{
-			m_next_available_slot = findEmptySlot();
-			if(nullptr == m_next_available_slot)
-			{
-				return false;
-			}
+			slot->~LinkedNode<T>();
 		}
-		LinkedNode<T> *slot = m_next_available_slot;
-		LinkedNode<T> node(elem);	
-		memcpy(slot, &node, sizeof node);
+		else
+		{
+			//Slots are first used in order, so the ones below m_constructed
+			//	are the ones that have been used
+			m_constructed = idx + 1;
+		}
+		new (slot) LinkedNode<T>(LinkedNodeInPlace(), std::forward<Args>(args)...);
 		this->enqueueNode(slot);
-		m_next_available_slot = findEmptySlot();
-		if(nullptr == m_next_available_slot)
+		if(0 == m_free_count)
 		{
 			this->setFull(true);
 		}
-		return true;
+		return &slot->value();
+	}
+
+	bool insert(T const &elem)
+	{
+		return nullptr != emplace(elem);
+	}
+
+	bool insert(T &&elem)
+	{
+		return nullptr != emplace(std::move(elem));
 	}
 
 	bool insert(T const *elem)
 	{
-		if(nullptr == m_next_available_slot)
+		return insert(*elem);
+	}
+
+	LinkedNode<T> *dequeueNode()
+	{
+		LinkedNode<T> *elem = LinkedQueue<T>::dequeueNode();
+		if(nullptr != elem)
 		{
-			m_next_available_slot = findEmptySlot();
-			if(nullptr == m_next_available_slot)
-			{
-				return false;
-			}
+			freeSlot(elem);
 		}
-		LinkedNode<T> *slot = m_next_available_slot;
-		LinkedNode<T> node(*elem);	
-		memcpy(slot, &node, sizeof node);
-		this->enqueueNode(slot);
-		m_next_available_slot = findEmptySlot();
-		if(nullptr == m_next_available_slot)
+		return elem;
+	}
+
+	/**
+	 *	Dequeue the oldest element. Its slot is free, so the element is only
+	 *	valid until the next insert
+	 */
+	T *dequeue()
+	{
+		LinkedNode<T> *elem = dequeueNode();
+		if(nullptr == elem)
 		{
-			this->setFull(true);
+			return nullptr;
+		}
+		return &elem->value();
+	}
+
+	void remove(LinkedNode<T> *elem)
+	{
+		if(false == elem->isLinked())
+		{
+			return;
 		}
-		return true;
+		LinkedQueue<T>::remove(elem);
+		freeSlot(elem);
 	}
 
+	/**
+	 *	Element in a slot. Only valid for slots that have been used
+	 */
 	T *getElem(size_t idx)
 	{
-		return &m_array[idx].value();
+		return &getNode(idx)->value();
 	}
-	
+
+	/**
+	 *	Node in a slot. Only valid for slots that have been used
+	 */
 	LinkedNode<T> *getNode(size_t idx)
 	{
-		return &m_array[idx];
+		return reinterpret_cast<LinkedNode<T>*>(m_array[idx]);
 	}
 
 	void reset()
 	{
-		for(size_t i = 0; i <  N_MEMB; i++)
+		for(size_t i = 0; i < m_constructed; i++)
 		{
-			m_array[i].unlink();
+			getNode(i)->reset();
 		}
-		this->init(&m_array[0], nullptr);
-		m_next_available_slot = &m_array[0];
-		m_slot_index = 0;
+		this->init(nullptr, nullptr);
+		resetFreeSlots();
 	}
 
 
 	private:
-	LinkedNode<T> *findEmptySlot()
+	/**
+	 *	Free every slot, to be used in order from the first
+	 */
+	void resetFreeSlots()
 	{
-		LinkedNode<T> *slot = nullptr;
-		for(size_t i = m_slot_index + 1; i != m_slot_index; i = ((i + 1) % N_MEMB))
+		for(size_t i = 0; i < N_MEMB; i++)
 		{
-			if(false == m_array[i].isLinked())
-			{
-				slot = &m_array[i];
-				m_slot_index = i;
-				break;
-			}
+			m_free[i] = N_MEMB - 1 - i;
 		}
-		return slot;
+		m_free_count = N_MEMB;
 	}
 
-	LinkedNode<T> *m_next_available_slot;
-	size_t m_slot_index = 0;
-	LinkedNode<T> m_array[N_MEMB];
+	void freeSlot(LinkedNode<T> *elem)
+	{
+		size_t offset = reinterpret_cast<uint8_t*>(elem) - m_array[0];
+		m_free[m_free_count++] = static_cast<Index>(offset / sizeof m_array[0]);
+	}
+
+	//The smallest type that holds an index into m_array
+	typedef typename std::conditional<
+		(N_MEMB <= 0xFF),
+		uint8_t,
+		typename std::conditional<
+			(N_MEMB <= 0xFFFF),
+			uint16_t,
+			uint32_t>::type>::type Index;
+
+	alignas(LinkedNode<T>) uint8_t m_array[N_MEMB][sizeof(LinkedNode<T>)];
+	//Number of slots, from the first, that have held an element
+	size_t m_constructed;
+	//Stack of the indices of the free slots in m_array
+	Index m_free[N_MEMB];
+	size_t m_free_count;
 };
 
 #endif //STATIC_QUEUE_H
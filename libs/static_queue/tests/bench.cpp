@@ -0,0 +1,382 @@
+/**
+ * bench.cpp
+ * Benchmark for the queues in libs/static_queue. Times insert, dequeue and
+ * remove on StaticQueue, against std::deque and RingQueue as a plain ring
+ * buffer, for several element sizes and queue depths, and the throughput of
+ * SPSCQueue between two threads.
+ *
+ * Operations are timed in batches of up to BATCH_SIZE, and the latency
+ * percentiles are those of the mean time per operation of each batch, as
+ * the clock costs about as much as a single operation.
+ *
+ * A table is printed, and the results are written as CSV to the file given
+ * as the first argument, bench.csv by default, one row per measurement:
+ * queue,element_size,depth,operation,ops_per_second,p50_ns,p90_ns,p99_ns,max_ns
+ * The SPSCQueue rows only have the throughput, with the latencies left at 0.
+ */
+
+#include "ring_queue.h"
+#include "spsc_queue.h"
+#include "static_queue.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <thread>
+#include <vector>
+
+//sizeof(MQTTRequest) on the Arduino Due when it held its message, before
+//	messages were moved to the payload pool
+static size_t constexpr MQTT_REQUEST_SIZE = 940;
+static size_t constexpr OPERATIONS = 400000;
+static size_t constexpr BATCH_SIZE = 16;
+static uint32_t constexpr SPSC_TRANSFERS = 2000000;
+
+//Keeps the compiler from optimising away the values read from the queues
+static volatile uint8_t g_sink;
+static FILE *g_csv;
+
+
+template <size_t SIZE>
+struct Element {
+	uint8_t data[SIZE];
+};
+
+
+class Result {
+	public:
+	double ops_per_second = 0;
+	double p50 = 0;
+	double p90 = 0;
+	double p99 = 0;
+	double max = 0;
+};
+
+
+template <typename T, size_t DEPTH>
+class StaticQueueUnderTest {
+	public:
+	static bool constexpr CAN_REMOVE = true;
+
+	static char const *name()
+	{
+		return "StaticQueue";
+	}
+
+	void clear()
+	{
+		m_queue.reset();
+	}
+
+	void insert(T const &elem)
+	{
+		m_queue.insert(elem);
+	}
+
+	void dequeue()
+	{
+		g_sink = m_queue.dequeue()->data[0];
+	}
+
+	void removeSecond()
+	{
+		m_queue.remove(m_queue.peakNode()->next());
+	}
+
+	private:
+	StaticQueue<T, DEPTH> m_queue;
+};
+
+
+template <typename T, size_t DEPTH>
+class DequeUnderTest {
+	public:
+	static bool constexpr CAN_REMOVE = true;
+
+	static char const *name()
+	{
+		return "std::deque";
+	}
+
+	void clear()
+	{
+		m_queue.clear();
+	}
+
+	void insert(T const &elem)
+	{
+		m_queue.push_back(elem);
+	}
+
+	void dequeue()
+	{
+		g_sink = m_queue.front().data[0];
+		m_queue.pop_front();
+	}
+
+	void removeSecond()
+	{
+		m_queue.erase(m_queue.begin() + 1);
+	}
+
+	private:
+	std::deque<T> m_queue;
+};
+
+
+template <typename T, size_t DEPTH>
+class RingQueueUnderTest {
+	public:
+	//A ring buffer can't remove from the middle
+	static bool constexpr CAN_REMOVE = false;
+
+	static char const *name()
+	{
+		return "RingQueue";
+	}
+
+	void clear()
+	{
+		m_queue.reset();
+	}
+
+	void insert(T const &elem)
+	{
+		m_queue.insert(elem);
+	}
+
+	void dequeue()
+	{
+		g_sink = m_queue.dequeue()->data[0];
+	}
+
+	void removeSecond()
+	{
+	}
+
+	private:
+	RingQueue<T, DEPTH> m_queue;
+};
+
+
+/**
+ *	Time an operation over rounds until OPERATIONS of them have been timed.
+ *	Each round sets the queue up without being timed, and then times its
+ *	operations in batches.
+ *	@param ops_per_round - Number of operations timed per round
+ *	@param prepare - Sets the queue up for a round
+ *	@param operation - The operation to time
+ */
+template <typename Prepare, typename Operation>
+static Result measure(size_t ops_per_round, Prepare prepare, Operation operation)
+{
+	std::vector<double> samples;
+	double total_ns = 0;
+	size_t total = 0;
+	while(total < OPERATIONS)
+	{
+		prepare();
+		for(size_t done = 0; done < ops_per_round;)
+		{
+			size_t batch = std::min(BATCH_SIZE, ops_per_round - done);
+			auto start = std::chrono::steady_clock::now();
+			for(size_t i = 0; i < batch; i++)
+			{
+				operation();
+			}
+			std::chrono::duration<double, std::nano> elapsed =
+				std::chrono::steady_clock::now() - start;
+			samples.push_back(elapsed.count() / batch);
+			total_ns += elapsed.count();
+			done += batch;
+		}
+		total += ops_per_round;
+	}
+	std::sort(samples.begin(), samples.end());
+	Result result;
+	result.ops_per_second = total / (total_ns * 1e-9);
+	result.p50 = samples[samples.size() / 2];
+	result.p90 = samples[(samples.size() * 90) / 100];
+	result.p99 = samples[(samples.size() * 99) / 100];
+	result.max = samples.back();
+	return result;
+}
+
+
+static void report(
+	char const *queue,
+	size_t element_size,
+	size_t depth,
+	char const *operation,
+	Result const &result)
+{
+	printf(
+		"%-12s %6zu %6zu %-9s %12.0f %8.1f %8.1f %8.1f %10.1f\n",
+		queue,
+		element_size,
+		depth,
+		operation,
+		result.ops_per_second,
+		result.p50,
+		result.p90,
+		result.p99,
+		result.max);
+	fprintf(
+		g_csv,
+		"%s,%zu,%zu,%s,%.0f,%.1f,%.1f,%.1f,%.1f\n",
+		queue,
+		element_size,
+		depth,
+		operation,
+		result.ops_per_second,
+		result.p50,
+		result.p90,
+		result.p99,
+		result.max);
+}
+
+
+template <template <typename, size_t> class Queue, size_t SIZE, size_t DEPTH>
+static void benchmark()
+{
+	typedef Element<SIZE> T;
+	static Queue<T, DEPTH> queue;
+	static T elem;
+	auto empty = []()
+	{
+		queue.clear();
+	};
+	auto fill = []()
+	{
+		queue.clear();
+		for(size_t i = 0; i < DEPTH; i++)
+		{
+			queue.insert(elem);
+		}
+	};
+
+	report(
+		Queue<T, DEPTH>::name(),
+		SIZE,
+		DEPTH,
+		"insert",
+		measure(DEPTH, empty, []() { queue.insert(elem); }));
+	report(
+		Queue<T, DEPTH>::name(),
+		SIZE,
+		DEPTH,
+		"dequeue",
+		measure(DEPTH, fill, []() { queue.dequeue(); }));
+	if(true == Queue<T, DEPTH>::CAN_REMOVE)
+	{
+		report(
+			Queue<T, DEPTH>::name(),
+			SIZE,
+			DEPTH,
+			"remove",
+			measure(DEPTH - 1, fill, []() { queue.removeSecond(); }));
+	}
+}
+
+
+template <size_t SIZE, size_t DEPTH>
+static void benchmarkDepth()
+{
+	benchmark<StaticQueueUnderTest, SIZE, DEPTH>();
+	benchmark<DequeUnderTest, SIZE, DEPTH>();
+	benchmark<RingQueueUnderTest, SIZE, DEPTH>();
+}
+
+
+template <size_t SIZE>
+static void benchmarkSize()
+{
+	benchmarkDepth<SIZE, 2>();
+	benchmarkDepth<SIZE, 16>();
+	benchmarkDepth<SIZE, 128>();
+	benchmarkDepth<SIZE, 1024>();
+}
+
+
+/**
+ *	Pass numbers from a producer thread to a consumer thread. Each side
+ *	yields when it can't go on, so the benchmark also runs on a single core.
+ *	Only the throughput is measured
+ */
+template <size_t DEPTH>
+static void benchmarkSPSC()
+{
+	static SPSCQueue<uint32_t, DEPTH> queue;
+	auto start = std::chrono::steady_clock::now();
+	std::thread producer([]()
+	{
+		for(uint32_t i = 0; i < SPSC_TRANSFERS;)
+		{
+			if(true == queue.insert(i))
+			{
+				i++;
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+	});
+	for(uint32_t received = 0; received < SPSC_TRANSFERS;)
+	{
+		uint32_t value;
+		if(true == queue.dequeue(&value))
+		{
+			g_sink = static_cast<uint8_t>(value);
+			received++;
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+	producer.join();
+	std::chrono::duration<double> elapsed =
+		std::chrono::steady_clock::now() - start;
+	Result result;
+	result.ops_per_second = SPSC_TRANSFERS / elapsed.count();
+	report("SPSCQueue", sizeof(uint32_t), DEPTH, "transfer", result);
+}
+
+
+int main(int argc, char *argv[])
+{
+	char const *csv_path = (argc > 1) ? argv[1] : "bench.csv";
+	g_csv = fopen(csv_path, "w");
+	if(nullptr == g_csv)
+	{
+		fprintf(stderr, "Can't open %s\n", csv_path);
+		return -1;
+	}
+	fprintf(
+		g_csv,
+		"queue,element_size,depth,operation,"
+		"ops_per_second,p50_ns,p90_ns,p99_ns,max_ns\n");
+	printf(
+		"%-12s %6s %6s %-9s %12s %8s %8s %8s %10s\n",
+		"queue",
+		"size",
+		"depth",
+		"operation",
+		"ops/s",
+		"p50 ns",
+		"p90 ns",
+		"p99 ns",
+		"max ns");
+
+	benchmarkSize<4>();
+	benchmarkSize<64>();
+	benchmarkSize<MQTT_REQUEST_SIZE>();
+	benchmarkSPSC<8>();
+	benchmarkSPSC<64>();
+	benchmarkSPSC<1024>();
+
+	fclose(g_csv);
+	return 0;
+}
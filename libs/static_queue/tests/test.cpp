@@ -3,11 +3,14 @@
  * Unit test for StaticQueue class
  */
 
+#include "ring_queue.h"
+#include "spsc_queue.h"
 #include "static_queue.h"
 #include <cstdint>
 #include <iostream>
 #include <cstdlib>
 #include <cmath>
+#include <thread>
 
 static size_t constexpr QUEUE_SIZE = 10;
 static uint32_t constexpr TEST_VALUES[QUEUE_SIZE] = { 
@@ -264,6 +267,56 @@ class TestStaticQueue {
 			(true == m_queue.isFull());
 	}
 
+	/**
+	 * Insert and dequeue one object at a time, more times than there are
+	 * slots, then fill the list
+	 * Verify that the list stays empty in between, and every slot is reused
+	 */
+	bool drainAndRefill()
+	{
+		m_queue.reset();
+		m_name.assign("drainAndRefill");
+		for(size_t i = 0; i < (3 * QUEUE_SIZE); i++)
+		{
+			if(
+				(false == m_queue.insert(TEST_VALUES[i % QUEUE_SIZE])) ||
+				(TEST_VALUES[i % QUEUE_SIZE] != *m_queue.dequeue()) ||
+				(false == m_queue.isEmpty()) ||
+				(true == m_queue.isFull()))
+			{
+				return false;
+			}
+		}
+		for(size_t i = 0; i < QUEUE_SIZE; i++)
+		{
+			if(false == m_queue.insert(TEST_VALUES[i]))
+			{
+				return false;
+			}
+		}
+		return
+			(true == mTraversal(QUEUE_SIZE, TEST_VALUES)) &&
+			(QUEUE_SIZE == m_queue.length()) &&
+			(true == m_queue.isFull());
+	}
+
+	/**
+	 * Remove objects out of order, reset the list, and fill it
+	 * Verify that reset frees every slot
+	 */
+	bool resetAfterRemoval()
+	{
+		fillList();
+		evenRemovalTraversal();
+		m_name.assign("resetAfterRemoval");
+		m_queue.reset();
+		if((false == m_queue.isEmpty()) || (0 != m_queue.length()))
+		{
+			return false;
+		}
+		return true == fillList();
+	}
+
 	/**
 	 * Print the result of the most recent test
 	 */
@@ -477,9 +530,371 @@ class TestComplexStaticQueue : public TestStaticQueue {
 };
 
 
+/**
+ *	Counts how it is constructed, copied, moved and destroyed
+ */
+class CountedType {
+	public:
+	CountedType()
+	{
+		constructed++;
+	}
+
+	CountedType(uint32_t id, uint32_t weight)
+	{
+		m_id = id + weight;
+		constructed++;
+	}
+
+	CountedType(CountedType const &other)
+	{
+		m_id = other.m_id;
+		copied++;
+	}
+
+	CountedType(CountedType &&other)
+	{
+		m_id = other.m_id;
+		moved++;
+	}
+
+	~CountedType()
+	{
+		destroyed++;
+	}
+
+	CountedType &operator=(CountedType const &other) = default;
+
+	static void resetCounts()
+	{
+		constructed = 0;
+		copied = 0;
+		moved = 0;
+		destroyed = 0;
+	}
+
+	uint32_t m_id = 0;
+	static size_t constructed;
+	static size_t copied;
+	static size_t moved;
+	static size_t destroyed;
+};
+
+size_t CountedType::constructed = 0;
+size_t CountedType::copied = 0;
+size_t CountedType::moved = 0;
+size_t CountedType::destroyed = 0;
+
+
+class TestStaticQueueConstruction {
+	public:
+	TestStaticQueueConstruction() {}
+
+	/**
+	 * Create a queue
+	 * Verify that none of its elements are constructed until used
+	 */
+	bool lazy()
+	{
+		m_name.assign("construction_lazy");
+		CountedType::resetCounts();
+		{
+			StaticQueue<CountedType, 16> queue;
+			if(0 != CountedType::constructed)
+			{
+				return false;
+			}
+			queue.emplace();
+			queue.emplace();
+			if(2 != CountedType::constructed)
+			{
+				return false;
+			}
+		}
+		return 2 == CountedType::destroyed;
+	}
+
+	/**
+	 * Emplace, copy-insert and move-insert elements, and cycle them through
+	 * the queue
+	 * Verify that emplacing constructs once without copies, and that
+	 * inserting copies or moves once. A slot's element is destroyed when the
+	 * slot is used again
+	 */
+	bool emplaceAndMove()
+	{
+		m_name.assign("construction_emplaceAndMove");
+		StaticQueue<CountedType, 4> queue;
+		CountedType::resetCounts();
+		CountedType *elem = queue.emplace(1000, 7);
+		if(
+			(nullptr == elem) ||
+			(1007 != elem->m_id) ||
+			(1 != CountedType::constructed) ||
+			(0 != CountedType::copied) ||
+			(0 != CountedType::moved))
+		{
+			return false;
+		}
+		CountedType value(2000, 0);
+		queue.insert(value);
+		queue.insert(CountedType(3000, 0));
+		if((1 != CountedType::copied) || (1 != CountedType::moved))
+		{
+			return false;
+		}
+		if(
+			(1007 != queue.dequeue()->m_id) ||
+			(2000 != queue.dequeue()->m_id) ||
+			(3000 != queue.dequeue()->m_id))
+		{
+			return false;
+		}
+		//The three slots are reused, so each old element is destroyed.
+		//	The temporary moved from was destroyed as well
+		size_t destroyed = CountedType::destroyed;
+		for(uint32_t i = 0; i < 4; i++)
+		{
+			queue.emplace(i, 0);
+		}
+		return
+			((destroyed + 3) == CountedType::destroyed) &&
+			(true == queue.isFull()) &&
+			(nullptr == queue.emplace(0, 0)) &&
+			(0 == queue.peak()->m_id);
+	}
+
+	/**
+	 * Print the result of the most recent test
+	 */
+	std::string printResult()
+	{
+		std::string result = m_name;
+		result += "\nResult:\n";
+		result += "\tconstructed = " + std::to_string(CountedType::constructed) + "\n";
+		result += "\tcopied = " + std::to_string(CountedType::copied) + "\n";
+		result += "\tmoved = " + std::to_string(CountedType::moved) + "\n";
+		result += "\tdestroyed = " + std::to_string(CountedType::destroyed) + "\n";
+		return result;
+	}
+
+	private:
+	std::string m_name;
+};
+
+
+class TestRingQueue {
+	public:
+	TestRingQueue() {}
+
+	/**
+	 * Fill the queue, and insert another object
+	 * Verify that the extra object is refused, and that the objects come out
+	 * in order until the queue is empty
+	 */
+	bool fillAndDrain()
+	{
+		m_queue.reset();
+		m_name.assign("ring_fillAndDrain");
+		for(size_t i = 0; i < RING_SIZE; i++)
+		{
+			if(false == m_queue.insert(TEST_VALUES[i]))
+			{
+				return false;
+			}
+		}
+		if(
+			(true == m_queue.insert(TEST_VALUES[0])) ||
+			(false == m_queue.isFull()) ||
+			(RING_SIZE != m_queue.length()))
+		{
+			return false;
+		}
+		for(size_t i = 0; i < RING_SIZE; i++)
+		{
+			if(
+				(TEST_VALUES[i] != *m_queue.peak()) ||
+				(TEST_VALUES[i] != *m_queue.dequeue()))
+			{
+				return false;
+			}
+		}
+		return
+			(true == m_queue.isEmpty()) &&
+			(0 == m_queue.length()) &&
+			(nullptr == m_queue.peak()) &&
+			(nullptr == m_queue.dequeue());
+	}
+
+	/**
+	 * Keep the queue part full while going around the ring many times
+	 * Verify that the objects come out in order, and the length stays right
+	 */
+	bool wrapAround()
+	{
+		m_queue.reset();
+		m_name.assign("ring_wrapAround");
+		uint32_t next_in = 0;
+		uint32_t next_out = 0;
+		for(size_t round = 0; round < (10 * RING_SIZE); round++)
+		{
+			for(size_t i = 0; i < 3; i++)
+			{
+				if(false == m_queue.insert(next_in++))
+				{
+					return false;
+				}
+			}
+			for(size_t i = 0; i < 2; i++)
+			{
+				if(next_out++ != *m_queue.dequeue())
+				{
+					return false;
+				}
+			}
+			//Make room for the next round
+			if(m_queue.length() > (RING_SIZE - 3))
+			{
+				while(false == m_queue.isEmpty())
+				{
+					if(next_out++ != *m_queue.dequeue())
+					{
+						return false;
+					}
+				}
+			}
+			if((next_in - next_out) != m_queue.length())
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Print the result of the most recent test
+	 */
+	std::string printResult()
+	{
+		std::string result = m_name;
+		result += "\nResult:\n";
+		result += "\tlength = " + std::to_string(m_queue.length()) + "\n";
+		return result;
+	}
+
+	private:
+	static size_t constexpr RING_SIZE = 8;
+
+	RingQueue<uint32_t, RING_SIZE> m_queue;
+	std::string m_name;
+};
+
+
+class TestSPSCQueue {
+	public:
+	TestSPSCQueue() {}
+
+	/**
+	 * Fill the queue from one thread, and empty it
+	 * Verify that it refuses an object when full, and gives them back in
+	 * order
+	 */
+	bool fillAndDrain()
+	{
+		m_name.assign("spsc_fillAndDrain");
+		static SPSCQueue<uint32_t, SPSC_SIZE> queue;
+		for(size_t i = 0; i < SPSC_SIZE; i++)
+		{
+			if(false == queue.insert(TEST_VALUES[i]))
+			{
+				return false;
+			}
+		}
+		if((true == queue.insert(TEST_VALUES[0])) || (SPSC_SIZE != queue.length()))
+		{
+			return false;
+		}
+		for(size_t i = 0; i < SPSC_SIZE; i++)
+		{
+			uint32_t value;
+			if((false == queue.dequeue(&value)) || (TEST_VALUES[i] != value))
+			{
+				return false;
+			}
+		}
+		return (true == queue.isEmpty()) && (nullptr == queue.peak());
+	}
+
+	/**
+	 * Pass a long run of numbers from a producer thread to a consumer
+	 * thread through a small queue
+	 * Verify that every number arrives once, in order
+	 */
+	bool stress()
+	{
+		m_name.assign("spsc_stress");
+		static SPSCQueue<uint32_t, SPSC_SIZE> queue;
+		std::thread producer([]()
+		{
+			for(uint32_t i = 0; i < STRESS_COUNT;)
+			{
+				if(true == queue.insert(i))
+				{
+					i++;
+				}
+				else
+				{
+					//Let the consumer run on a single core
+					std::this_thread::yield();
+				}
+			}
+		});
+		m_received = 0;
+		bool in_order = true;
+		while(m_received < STRESS_COUNT)
+		{
+			uint32_t value;
+			if(false == queue.dequeue(&value))
+			{
+				std::this_thread::yield();
+				continue;
+			}
+			if(m_received != value)
+			{
+				in_order = false;
+			}
+			m_received++;
+		}
+		producer.join();
+		return (true == in_order) && (true == queue.isEmpty());
+	}
+
+	/**
+	 * Print the result of the most recent test
+	 */
+	std::string printResult()
+	{
+		std::string result = m_name;
+		result += "\nResult:\n";
+		result += "\treceived = " + std::to_string(m_received) + "\n";
+		return result;
+	}
+
+	private:
+	static size_t constexpr SPSC_SIZE = 8;
+	static uint32_t constexpr STRESS_COUNT = 1000000;
+
+	uint32_t m_received = 0;
+	std::string m_name;
+};
+
+
 int main()
 {
 	TestStaticQueue test;
+	TestRingQueue ring_test;
+	TestStaticQueueConstruction construction_test;
+	TestSPSCQueue spsc_test;
 
 	if(false == test.singleObjectInsert())
 	{
@@ -541,10 +956,59 @@ int main()
 		return -1;
 	}
 
-	TestComplexStaticQueue<TestType, 76564> complex_test;
+	if(false == test.drainAndRefill())
+	{
+		std::cout << test.printResult();
+		return -1;
+	}
+
+	if(false == test.resetAfterRemoval())
+	{
+		std::cout << test.printResult();
+		return -1;
+	}
+
+	//Too large for the stack
+	static TestComplexStaticQueue<TestType, 76564> complex_test;
 	if(false == complex_test.insertAfterRemovalTraversal())
 	{
 		std::cout << complex_test.printResult();
 		return -1;
 	}
+
+	if(false == ring_test.fillAndDrain())
+	{
+		std::cout << ring_test.printResult();
+		return -1;
+	}
+
+	if(false == ring_test.wrapAround())
+	{
+		std::cout << ring_test.printResult();
+		return -1;
+	}
+
+	if(false == construction_test.lazy())
+	{
+		std::cout << construction_test.printResult();
+		return -1;
+	}
+
+	if(false == construction_test.emplaceAndMove())
+	{
+		std::cout << construction_test.printResult();
+		return -1;
+	}
+
+	if(false == spsc_test.fillAndDrain())
+	{
+		std::cout << spsc_test.printResult();
+		return -1;
+	}
+
+	if(false == spsc_test.stress())
+	{
+		std::cout << spsc_test.printResult();
+		return -1;
+	}
 }
@@ -0,0 +1,339 @@
+/**
+ * cbor_report.cpp
+ */
+
+#include "cbor_report.h"
+
+static uint8_t constexpr CBOR_UNSIGNED = 0;
+static uint8_t constexpr CBOR_TEXT = 3;
+static uint8_t constexpr CBOR_ARRAY = 4;
+static uint8_t constexpr CBOR_FLOAT32 = 0xFA;
+static uint8_t constexpr CBOR_INDEFINITE_ARRAY = 0x9F;
+static uint8_t constexpr CBOR_BREAK = 0xFF;
+static size_t constexpr REPORT_FIELD_COUNT = 5;
+
+/**
+ *	Write the initial byte and argument of a CBOR data item
+ *	@param out - Output - At least 5 bytes
+ *	@param major - CBOR major type
+ *	@param value - Argument (unsigned value, or length)
+ *	@return Number of bytes written
+ */
+static size_t cborHead(uint8_t out[], uint8_t major, uint32_t value)
+{
+	major <<= 5;
+	if(value < 24)
+	{
+		out[0] = major | value;
+		return 1;
+	}
+	if(value <= 0xFF)
+	{
+		out[0] = major | 24;
+		out[1] = value;
+		return 2;
+	}
+	if(value <= 0xFFFF)
+	{
+		out[0] = major | 25;
+		out[1] = value >> 8;
+		out[2] = value & 0xFF;
+		return 3;
+	}
+	out[0] = major | 26;
+	out[1] = value >> 24;
+	out[2] = (value >> 16) & 0xFF;
+	out[3] = (value >> 8) & 0xFF;
+	out[4] = value & 0xFF;
+	return 5;
+}
+
+
+static size_t cborFloat32(uint8_t out[], float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof bits);
+	out[0] = CBOR_FLOAT32;
+	out[1] = bits >> 24;
+	out[2] = (bits >> 16) & 0xFF;
+	out[3] = (bits >> 8) & 0xFF;
+	out[4] = bits & 0xFF;
+	return 5;
+}
+
+
+SentinelCBOREncoder::SentinelCBOREncoder()
+{
+	m_buffer = nullptr;
+	m_size = 0;
+	m_len = 0;
+	m_count = 0;
+}
+
+
+/**
+ *	Start a new batch in the given buffer
+ *	@param buffer - Output - The batch is encoded directly into this buffer,
+ *	                typically the message buffer handed to GB4MQTT::publish()
+ *	@param size - Size of buffer in bytes
+ *	@param device_id - Null terminated device ID sent once for the batch
+ *	@return
+ *		false - The buffer is too small for the batch header
+ *		true - Reports can now be added
+ */
+bool SentinelCBOREncoder::begin(
+	uint8_t buffer[],
+	size_t size,
+	char const *device_id)
+{
+	m_buffer = buffer;
+	m_size = size;
+	m_len = 0;
+	m_count = 0;
+
+	size_t id_len = strlen(device_id);
+	//Batch array (1) + device ID + report array (1) + break (1)
+	if((1 + 5 + id_len + 1 + 1) > size)
+	{
+		m_size = 0;
+		return false;
+	}
+	m_len += cborHead(&m_buffer[m_len], CBOR_ARRAY, 2);
+	m_len += cborHead(&m_buffer[m_len], CBOR_TEXT, id_len);
+	memcpy(&m_buffer[m_len], device_id, id_len);
+	m_len += id_len;
+	m_buffer[m_len++] = CBOR_INDEFINITE_ARRAY;
+	return true;
+}
+
+
+/**
+ *	Append a report to the batch
+ *	@param report - The report to encode
+ *	@return
+ *		false - The report does not fit into the buffer. The batch is left
+ *		        unchanged, and can still be finished
+ *		true - The report was appended
+ */
+bool SentinelCBOREncoder::add(SentinelReport const &report)
+{
+	//Always leave room for the break that ends the report array
+	if((m_len + REPORT_MAX_SIZE + 1) > m_size)
+	{
+		return false;
+	}
+	uint8_t *ptr = &m_buffer[m_len];
+	ptr += cborHead(ptr, CBOR_ARRAY, REPORT_FIELD_COUNT);
+	ptr += cborFloat32(ptr, report.latitude);
+	ptr += cborFloat32(ptr, report.longitude);
+	ptr += cborHead(
+		ptr,
+		CBOR_UNSIGNED,
+		static_cast<uint8_t>(report.robot_state));
+	ptr += cborHead(ptr, CBOR_UNSIGNED, report.timestamp);
+	ptr += cborHead(ptr, CBOR_UNSIGNED, report.cnt);
+	m_len = ptr - m_buffer;
+	m_count++;
+	return true;
+}
+
+
+/**
+ *	End the batch
+ *	@return
+ *		0 - SentinelCBOREncoder::begin() did not succeed
+ *		Otherwise, the length of the encoded batch in bytes
+ */
+size_t SentinelCBOREncoder::finish()
+{
+	if(0 == m_size)
+	{
+		return 0;
+	}
+	m_buffer[m_len++] = CBOR_BREAK;
+	m_size = 0;
+	return m_len;
+}
+
+
+/**
+ *	Read the initial byte and argument of a CBOR data item
+ *	@param buffer - Input - Encoded data
+ *	@param len - Length of buffer in bytes
+ *	@param pos - Input - Position of the data item
+ *	             Output - Position following the head
+ *	@param major - Output - CBOR major type
+ *	@param value - Output - Argument
+ *	@return
+ *		false - The head is truncated or uses an unsupported argument size
+ *		true - Success
+ */
+static bool cborReadHead(
+	uint8_t const buffer[],
+	size_t len,
+	size_t *pos,
+	uint8_t *major,
+	uint32_t *value)
+{
+	if(*pos >= len)
+	{
+		return false;
+	}
+	uint8_t initial = buffer[(*pos)++];
+	*major = initial >> 5;
+	uint8_t info = initial & 0x1F;
+	size_t arg_len;
+	if(info < 24)
+	{
+		*value = info;
+		return true;
+	}
+	switch(info)
+	{
+		case 24: arg_len = 1; break;
+		case 25: arg_len = 2; break;
+		case 26: arg_len = 4; break;
+		default: return false;
+	}
+	if((*pos + arg_len) > len)
+	{
+		return false;
+	}
+	*value = 0;
+	for(size_t i = 0; i < arg_len; i++)
+	{
+		*value = (*value << 8) | buffer[(*pos)++];
+	}
+	return true;
+}
+
+
+static bool cborReadFloat32(
+	uint8_t const buffer[],
+	size_t len,
+	size_t *pos,
+	float *value)
+{
+	uint8_t major;
+	uint32_t bits;
+	if(
+		(*pos >= len) ||
+		(CBOR_FLOAT32 != buffer[*pos]) ||
+		(false == cborReadHead(buffer, len, pos, &major, &bits)))
+	{
+		return false;
+	}
+	memcpy(value, &bits, sizeof *value);
+	return true;
+}
+
+
+static bool cborReadUnsigned(
+	uint8_t const buffer[],
+	size_t len,
+	size_t *pos,
+	uint32_t *value)
+{
+	uint8_t major;
+	return
+		(true == cborReadHead(buffer, len, pos, &major, value)) &&
+		(CBOR_UNSIGNED == major);
+}
+
+
+/**
+ *	Check the batch header, and prepare to read reports with
+ *	SentinelCBORDecoder::next(). Check SentinelCBORDecoder::isValid() for
+ *	a malformed header.
+ *	@param buffer - Input - Batch encoded by SentinelCBOREncoder
+ *	@param len - Length of buffer in bytes
+ */
+SentinelCBORDecoder::SentinelCBORDecoder(uint8_t const buffer[], size_t len)
+{
+	m_buffer = buffer;
+	m_len = len;
+	m_pos = 0;
+	m_device_id = nullptr;
+	m_device_id_len = 0;
+	m_valid = false;
+
+	uint8_t major;
+	uint32_t value;
+	if(
+		(false == cborReadHead(m_buffer, m_len, &m_pos, &major, &value)) ||
+		(CBOR_ARRAY != major) ||
+		(2 != value))
+	{
+		return;
+	}
+	if(
+		(false == cborReadHead(m_buffer, m_len, &m_pos, &major, &value)) ||
+		(CBOR_TEXT != major) ||
+		((m_pos + value) > m_len))
+	{
+		return;
+	}
+	m_device_id = &m_buffer[m_pos];
+	m_device_id_len = value;
+	m_pos += value;
+	if((m_pos >= m_len) || (CBOR_INDEFINITE_ARRAY != m_buffer[m_pos]))
+	{
+		return;
+	}
+	m_pos++;
+	m_valid = true;
+}
+
+
+/**
+ *	Copy the device ID of the batch as a null terminated string
+ *	@param id - Output - Device ID
+ *	@param size - Size of id in bytes
+ *	@return
+ *		false - The batch is malformed, or id is too small
+ *		true - Success
+ */
+bool SentinelCBORDecoder::deviceID(char id[], size_t size)
+{
+	if((false == m_valid) || (m_device_id_len >= size))
+	{
+		return false;
+	}
+	memcpy(id, m_device_id, m_device_id_len);
+	id[m_device_id_len] = '\0';
+	return true;
+}
+
+
+/**
+ *	Decode the next report in the batch
+ *	@param report - Output - Decoded report
+ *	@return
+ *		false - There are no more reports, or the batch is malformed
+ *		true - Success
+ */
+bool SentinelCBORDecoder::next(SentinelReport *report)
+{
+	if((false == m_valid) || (m_pos >= m_len) || (CBOR_BREAK == m_buffer[m_pos]))
+	{
+		return false;
+	}
+	uint8_t major;
+	uint32_t value;
+	uint32_t state;
+	if(
+		(false == cborReadHead(m_buffer, m_len, &m_pos, &major, &value)) ||
+		(CBOR_ARRAY != major) ||
+		(REPORT_FIELD_COUNT != value) ||
+		(false == cborReadFloat32(m_buffer, m_len, &m_pos, &report->latitude)) ||
+		(false == cborReadFloat32(m_buffer, m_len, &m_pos, &report->longitude)) ||
+		(false == cborReadUnsigned(m_buffer, m_len, &m_pos, &state)) ||
+		(false == cborReadUnsigned(m_buffer, m_len, &m_pos, &report->timestamp)) ||
+		(false == cborReadUnsigned(m_buffer, m_len, &m_pos, &report->cnt)))
+	{
+		m_valid = false;
+		return false;
+	}
+	report->robot_state = static_cast<SentinelReport::RobotState>(state);
+	return true;
+}
@@ -0,0 +1,71 @@
+/**
+ * cbor_report.h
+ * Compact CBOR (RFC 8949) encoding of a batch of Sentinel reports.
+ *
+ * Keys are not sent; the position of each field is fixed by this schema:
+ *	batch  = [device_id, [_ report, report, ...]]
+ *	report = [latitude, longitude, robot_state, timestamp, cnt]
+ *	device_id   - text string
+ *	latitude    - float32
+ *	longitude   - float32
+ *	robot_state - unsigned index into SENTINEL_ROBOT_STATE_NAMES
+ *	timestamp   - unsigned seconds since the Unix epoch
+ *	cnt         - unsigned
+ * The report array has indefinite length, so reports can be appended without
+ * knowing the size of the batch ahead of time.
+ */
+
+#ifndef CBOR_REPORT_H
+#define CBOR_REPORT_H
+
+#include "sentinel_report.h"
+
+class SentinelCBOREncoder {
+	public:
+	//Array header (1) + 2 float32 (10) + 3 unsigned (up to 15)
+	static size_t constexpr REPORT_MAX_SIZE = 26;
+
+	SentinelCBOREncoder();
+	bool begin(uint8_t buffer[], size_t size, char const *device_id);
+	bool add(SentinelReport const &report);
+	size_t finish();
+
+	size_t length()
+	{
+		return m_len;
+	}
+
+	size_t count()
+	{
+		return m_count;
+	}
+
+	private:
+	uint8_t *m_buffer;
+	size_t m_size;
+	size_t m_len;
+	size_t m_count;
+};
+
+
+class SentinelCBORDecoder {
+	public:
+	SentinelCBORDecoder(uint8_t const buffer[], size_t len);
+	bool deviceID(char id[], size_t size);
+	bool next(SentinelReport *report);
+
+	bool isValid()
+	{
+		return m_valid;
+	}
+
+	private:
+	uint8_t const *m_buffer;
+	size_t m_len;
+	size_t m_pos;
+	uint8_t const *m_device_id;
+	size_t m_device_id_len;
+	bool m_valid;
+};
+
+#endif //CBOR_REPORT_H
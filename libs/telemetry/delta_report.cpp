@@ -0,0 +1,275 @@
+/**
+ * delta_report.cpp
+ */
+
+#include "delta_report.h"
+#include <cmath>
+
+static double constexpr FIXED_POINT_SCALE = 1000000.0;
+
+static uint32_t zigzag(uint32_t value)
+{
+	int32_t n = static_cast<int32_t>(value);
+	return (static_cast<uint32_t>(n) << 1) ^ static_cast<uint32_t>(n >> 31);
+}
+
+
+static uint32_t unzigzag(uint32_t value)
+{
+	return (value >> 1) ^ (0 - (value & 1));
+}
+
+
+static size_t writeVarint(uint8_t out[], uint32_t value)
+{
+	size_t len = 0;
+	for(; value >= 0x80; value >>= 7)
+	{
+		out[len++] = static_cast<uint8_t>(value | 0x80);
+	}
+	out[len++] = static_cast<uint8_t>(value);
+	return len;
+}
+
+
+/**
+ *	Read an LEB128 varint
+ *	@return
+ *		false - The varint is truncated or longer than 32 bits
+ *		true - Success
+ */
+static bool readVarint(
+	uint8_t const buffer[],
+	size_t len,
+	size_t *pos,
+	uint32_t *value)
+{
+	*value = 0;
+	for(uint8_t shift = 0; shift < 35; shift += 7)
+	{
+		if(*pos >= len)
+		{
+			return false;
+		}
+		uint8_t byte = buffer[(*pos)++];
+		*value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+		if(0 == (byte & 0x80))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+
+/**
+ *	Convert a report into the fields that are delta encoded
+ *	Arithmetic on the fields is done modulo 2^32, so that the decoder undoes
+ *	it exactly, even if a counter wraps
+ */
+void SentinelDeltaState::toFields(
+	SentinelReport const &report,
+	uint32_t fields[])
+{
+	fields[LATITUDE] = static_cast<uint32_t>(static_cast<int32_t>(
+		lround(report.latitude * FIXED_POINT_SCALE)));
+	fields[LONGITUDE] = static_cast<uint32_t>(static_cast<int32_t>(
+		lround(report.longitude * FIXED_POINT_SCALE)));
+	fields[TIMESTAMP] = report.timestamp;
+	fields[CNT] = report.cnt;
+}
+
+
+void SentinelDeltaState::fromFields(
+	uint32_t const fields[],
+	SentinelReport *report)
+{
+	report->latitude = static_cast<int32_t>(fields[LATITUDE]) / FIXED_POINT_SCALE;
+	report->longitude = static_cast<int32_t>(fields[LONGITUDE]) / FIXED_POINT_SCALE;
+	report->timestamp = fields[TIMESTAMP];
+	report->cnt = fields[CNT];
+}
+
+
+SentinelDeltaEncoder::SentinelDeltaEncoder()
+{
+	m_buffer = nullptr;
+	m_size = 0;
+	m_len = 0;
+	m_count = 0;
+	m_state.reset();
+}
+
+
+/**
+ *	Start a new batch in the given buffer
+ *	@param buffer - Output - The batch is encoded directly into this buffer,
+ *	                typically the message buffer handed to GB4MQTT::publish()
+ *	@param size - Size of buffer in bytes
+ *	@param device_id - Null terminated device ID sent once for the batch
+ *	@return
+ *		false - The buffer is too small for the batch header
+ *		true - Reports can now be added
+ */
+bool SentinelDeltaEncoder::begin(
+	uint8_t buffer[],
+	size_t size,
+	char const *device_id)
+{
+	m_buffer = buffer;
+	m_size = size;
+	m_len = 0;
+	m_count = 0;
+	m_state.reset();
+
+	size_t id_len = strlen(device_id);
+	if((5 + id_len) > size)
+	{
+		m_size = 0;
+		return false;
+	}
+	m_len += writeVarint(&m_buffer[m_len], id_len);
+	memcpy(&m_buffer[m_len], device_id, id_len);
+	m_len += id_len;
+	return true;
+}
+
+
+/**
+ *	Append a report to the batch
+ *	@param report - The report to encode
+ *	@return
+ *		false - The report does not fit into the buffer. The batch is left
+ *		        unchanged, and can still be finished
+ *		true - The report was appended
+ */
+bool SentinelDeltaEncoder::add(SentinelReport const &report)
+{
+	if((m_len + REPORT_MAX_SIZE) > m_size)
+	{
+		return false;
+	}
+	uint32_t fields[SentinelDeltaState::FIELD_COUNT];
+	SentinelDeltaState::toFields(report, fields);
+	uint8_t *ptr = &m_buffer[m_len];
+	for(size_t i = 0; i < SentinelDeltaState::FIELD_COUNT; i++)
+	{
+		uint32_t delta = fields[i] - m_state.value[i];
+		ptr += writeVarint(ptr, zigzag(delta - m_state.delta[i]));
+		m_state.value[i] = fields[i];
+		m_state.delta[i] = (0 == m_count) ? 0 : delta;
+	}
+	ptr += writeVarint(ptr, static_cast<uint8_t>(report.robot_state));
+	m_len = ptr - m_buffer;
+	m_count++;
+	return true;
+}
+
+
+/**
+ *	End the batch
+ *	@return
+ *		0 - SentinelDeltaEncoder::begin() did not succeed
+ *		Otherwise, the length of the encoded batch in bytes
+ */
+size_t SentinelDeltaEncoder::finish()
+{
+	if(0 == m_size)
+	{
+		return 0;
+	}
+	m_size = 0;
+	return m_len;
+}
+
+
+/**
+ *	Read the batch header, and prepare to read reports with
+ *	SentinelDeltaDecoder::next(). Check SentinelDeltaDecoder::isValid() for
+ *	a malformed header.
+ *	@param buffer - Input - Batch encoded by SentinelDeltaEncoder
+ *	@param len - Length of buffer in bytes
+ */
+SentinelDeltaDecoder::SentinelDeltaDecoder(uint8_t const buffer[], size_t len)
+{
+	m_buffer = buffer;
+	m_len = len;
+	m_pos = 0;
+	m_device_id = nullptr;
+	m_device_id_len = 0;
+	m_count = 0;
+	m_valid = false;
+	m_state.reset();
+
+	uint32_t id_len;
+	if(
+		(false == readVarint(m_buffer, m_len, &m_pos, &id_len)) ||
+		((m_pos + id_len) > m_len))
+	{
+		return;
+	}
+	m_device_id = &m_buffer[m_pos];
+	m_device_id_len = id_len;
+	m_pos += id_len;
+	m_valid = true;
+}
+
+
+/**
+ *	Copy the device ID of the batch as a null terminated string
+ *	@param id - Output - Device ID
+ *	@param size - Size of id in bytes
+ *	@return
+ *		false - The batch is malformed, or id is too small
+ *		true - Success
+ */
+bool SentinelDeltaDecoder::deviceID(char id[], size_t size)
+{
+	if((false == m_valid) || (m_device_id_len >= size))
+	{
+		return false;
+	}
+	memcpy(id, m_device_id, m_device_id_len);
+	id[m_device_id_len] = '\0';
+	return true;
+}
+
+
+/**
+ *	Decode the next report in the batch
+ *	@param report - Output - Decoded report
+ *	@return
+ *		false - There are no more reports, or the batch is malformed
+ *		true - Success
+ */
+bool SentinelDeltaDecoder::next(SentinelReport *report)
+{
+	if((false == m_valid) || (m_pos >= m_len))
+	{
+		return false;
+	}
+	uint32_t fields[SentinelDeltaState::FIELD_COUNT];
+	for(size_t i = 0; i < SentinelDeltaState::FIELD_COUNT; i++)
+	{
+		uint32_t value;
+		if(false == readVarint(m_buffer, m_len, &m_pos, &value))
+		{
+			m_valid = false;
+			return false;
+		}
+		uint32_t delta = unzigzag(value) + m_state.delta[i];
+		fields[i] = m_state.value[i] + delta;
+		m_state.value[i] = fields[i];
+		m_state.delta[i] = (0 == m_count) ? 0 : delta;
+	}
+	uint32_t state;
+	if(false == readVarint(m_buffer, m_len, &m_pos, &state))
+	{
+		m_valid = false;
+		return false;
+	}
+	SentinelDeltaState::fromFields(fields, report);
+	report->robot_state = static_cast<SentinelReport::RobotState>(state);
+	m_count++;
+	return true;
+}
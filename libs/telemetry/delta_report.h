@@ -0,0 +1,95 @@
+/**
+ * delta_report.h
+ * Delta encoding of a batch of Sentinel reports taken at a steady interval.
+ *
+ * Latitude and longitude are converted to fixed point millionths of a
+ * degree. The first report is sent in full, and each following report as
+ * the change in the change of every field since the previous report
+ * (delta-of-delta), so a robot moving at a steady speed and reporting at a
+ * steady interval costs one byte per field. Every value is a zig-zag LEB128
+ * varint:
+ *	batch  = device_id_len, device_id, report...
+ *	report = latitude, longitude, timestamp, cnt, robot_state
+ */
+
+#ifndef DELTA_REPORT_H
+#define DELTA_REPORT_H
+
+#include "sentinel_report.h"
+
+class SentinelDeltaState {
+	public:
+	enum Field {
+		LATITUDE = 0,
+		LONGITUDE,
+		TIMESTAMP,
+		CNT,
+		FIELD_COUNT
+	};
+
+	void reset()
+	{
+		memset(value, 0, sizeof value);
+		memset(delta, 0, sizeof delta);
+	}
+
+	static void toFields(SentinelReport const &report, uint32_t fields[]);
+	static void fromFields(uint32_t const fields[], SentinelReport *report);
+
+	uint32_t value[FIELD_COUNT];
+	uint32_t delta[FIELD_COUNT];
+};
+
+
+class SentinelDeltaEncoder {
+	public:
+	//4 fields and the robot state, each up to 5 bytes
+	static size_t constexpr REPORT_MAX_SIZE = 25;
+
+	SentinelDeltaEncoder();
+	bool begin(uint8_t buffer[], size_t size, char const *device_id);
+	bool add(SentinelReport const &report);
+	size_t finish();
+
+	size_t length()
+	{
+		return m_len;
+	}
+
+	size_t count()
+	{
+		return m_count;
+	}
+
+	private:
+	uint8_t *m_buffer;
+	size_t m_size;
+	size_t m_len;
+	size_t m_count;
+	SentinelDeltaState m_state;
+};
+
+
+class SentinelDeltaDecoder {
+	public:
+	SentinelDeltaDecoder(uint8_t const buffer[], size_t len);
+	bool deviceID(char id[], size_t size);
+	bool next(SentinelReport *report);
+
+	bool isValid()
+	{
+		return m_valid;
+	}
+
+	private:
+	uint8_t const *m_buffer;
+	size_t m_len;
+	size_t m_pos;
+	uint8_t const *m_device_id;
+	size_t m_device_id_len;
+	size_t m_count;
+	bool m_valid;
+	SentinelDeltaState m_state;
+};
+
+#endif //DELTA_REPORT_H
@@ -0,0 +1,115 @@
+/**
+ * json_report.cpp
+ */
+
+#include "json_report.h"
+
+SentinelJSONEncoder::SentinelJSONEncoder()
+{
+	m_buffer = nullptr;
+	m_size = 0;
+	m_len = 0;
+	m_count = 0;
+	m_device_id = nullptr;
+	m_device_id_len = 0;
+}
+
+
+/**
+ *	Start a new batch in the given buffer
+ *	@param buffer - Output - The batch is encoded directly into this buffer,
+ *	                typically the message buffer handed to GB4MQTT::publish()
+ *	@param size - Size of buffer in bytes
+ *	@param device_id - Null terminated device ID repeated in every report.
+ *	                   Must stay valid until the batch is finished.
+ *	@return
+ *		false - The buffer is too small for an empty batch
+ *		true - Reports can now be added
+ */
+bool SentinelJSONEncoder::begin(
+	uint8_t buffer[],
+	size_t size,
+	char const *device_id)
+{
+	m_buffer = buffer;
+	m_size = size;
+	m_len = 0;
+	m_count = 0;
+	m_device_id = device_id;
+	m_device_id_len = strlen(device_id);
+
+	//[ and ]
+	if(size < 2)
+	{
+		m_size = 0;
+		return false;
+	}
+	m_buffer[m_len++] = '[';
+	return true;
+}
+
+
+/**
+ *	Append a report to the batch
+ *	@param report - The report to encode
+ *	@return
+ *		false - The report does not fit into the buffer. The batch is left
+ *		        unchanged, and can still be finished
+ *		true - The report was appended
+ */
+bool SentinelJSONEncoder::add(SentinelReport const &report)
+{
+	if(0 == m_size)
+	{
+		return false;
+	}
+	char const *state = report.robotStateName();
+	m_timestamp.set(report.timestamp);
+
+	//Keep the last byte for the closing ]
+	TextAppender text(
+		reinterpret_cast<char*>(&m_buffer[m_len]),
+		m_size - m_len - 1);
+	if(0 != m_count)
+	{
+		text.append(',');
+	}
+	text.append("{\"device_id\":\"");
+	text.append(m_device_id, m_device_id_len);
+	text.append("\",\"latitude\":");
+	text.appendFixed(report.latitude, COORDINATE_DECIMALS);
+	text.append(",\"longitude\":");
+	text.appendFixed(report.longitude, COORDINATE_DECIMALS);
+	text.append(",\"robotState\":\"");
+	text.append((nullptr != state) ? state : "Unknown");
+	text.append("\",\"timestamp\":\"");
+	text.append(m_timestamp.str(), ISO8601Timestamp::LENGTH);
+	text.append("\",\"cnt\":");
+	text.appendUint(report.cnt);
+	text.append('}');
+	if(false == text.ok())
+	{
+		return false;
+	}
+	m_len += text.length();
+	m_count++;
+	return true;
+}
+
+
+/**
+ *	End the batch
+ *	@return
+ *		0 - SentinelJSONEncoder::begin() did not succeed
+ *		Otherwise, the length of the encoded batch in bytes
+ */
+size_t SentinelJSONEncoder::finish()
+{
+	if(0 == m_size)
+	{
+		return 0;
+	}
+	m_buffer[m_len++] = ']';
+	m_size = 0;
+	return m_len;
+}
@@ -0,0 +1,46 @@
+/**
+ * json_report.h
+ * JSON encoding of a batch of Sentinel reports, in the format the Sentinel
+ * backend stores in log.json:
+ *	[{"device_id":"...","latitude":1.000000,"longitude":2.000000,
+ *	"robotState":"Error","timestamp":"2021-02-23T10:28:08Z","cnt":0},...]
+ * Formatting uses TextAppender and ISO8601Timestamp, so it needs neither
+ * printf float support nor gmtime.
+ */
+
+#ifndef JSON_REPORT_H
+#define JSON_REPORT_H
+
+#include "sentinel_report.h"
+#include "text_format.h"
+
+class SentinelJSONEncoder {
+	public:
+	static uint8_t constexpr COORDINATE_DECIMALS = 6;
+
+	SentinelJSONEncoder();
+	bool begin(uint8_t buffer[], size_t size, char const *device_id);
+	bool add(SentinelReport const &report);
+	size_t finish();
+
+	size_t length()
+	{
+		return m_len;
+	}
+
+	size_t count()
+	{
+		return m_count;
+	}
+
+	private:
+	uint8_t *m_buffer;
+	size_t m_size;
+	size_t m_len;
+	size_t m_count;
+	char const *m_device_id;
+	size_t m_device_id_len;
+	ISO8601Timestamp m_timestamp;
+};
+
+#endif //JSON_REPORT_H
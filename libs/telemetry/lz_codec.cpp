@@ -0,0 +1,301 @@
+/**
+ * lz_codec.cpp
+ */
+
+#include "lz_codec.h"
+
+/**
+ *	Write a length that did not fit into its token nibble
+ *	@return
+ *		false - out is full
+ *		true - Success
+ */
+static bool writeLength(
+	uint8_t out[],
+	size_t out_size,
+	size_t *pos,
+	size_t len)
+{
+	for(; len >= 255; len -= 255)
+	{
+		if(*pos >= out_size)
+		{
+			return false;
+		}
+		out[(*pos)++] = 255;
+	}
+	if(*pos >= out_size)
+	{
+		return false;
+	}
+	out[(*pos)++] = static_cast<uint8_t>(len);
+	return true;
+}
+
+
+static bool readLength(
+	uint8_t const in[],
+	size_t in_len,
+	size_t *pos,
+	size_t *len)
+{
+	uint8_t byte;
+	do
+	{
+		if(*pos >= in_len)
+		{
+			return false;
+		}
+		byte = in[(*pos)++];
+		*len += byte;
+	}
+	while(255 == byte);
+	return true;
+}
+
+
+/**
+ *	Write a sequence of literals, followed by a match unless match_len is 0
+ *	@return
+ *		false - out is full
+ *		true - Success
+ */
+static bool writeSequence(
+	uint8_t out[],
+	size_t out_size,
+	size_t *pos,
+	uint8_t const literals[],
+	size_t literal_len,
+	size_t offset,
+	size_t match_len)
+{
+	if(*pos >= out_size)
+	{
+		return false;
+	}
+	size_t match_code = (0 != match_len) ? (match_len - LZCodec::MIN_MATCH) : 0;
+	out[(*pos)++] = static_cast<uint8_t>(
+		(((literal_len < 15) ? literal_len : 15) << 4) |
+		((match_code < 15) ? match_code : 15));
+	if(
+		(literal_len >= 15) &&
+		(false == writeLength(out, out_size, pos, literal_len - 15)))
+	{
+		return false;
+	}
+	if(literal_len > (out_size - *pos))
+	{
+		return false;
+	}
+	memcpy(&out[*pos], literals, literal_len);
+	*pos += literal_len;
+	if(0 == match_len)
+	{
+		return true;
+	}
+
+	if(2 > (out_size - *pos))
+	{
+		return false;
+	}
+	out[(*pos)++] = static_cast<uint8_t>(offset & 0xFF);
+	out[(*pos)++] = static_cast<uint8_t>(offset >> 8);
+	return
+		(match_code < 15) ||
+		(true == writeLength(out, out_size, pos, match_code - 15));
+}
+
+
+/**
+ *	@param dictionary - Preset dictionary. Must stay valid for the lifetime
+ *	                    of the codec, and be the same for the compressor and
+ *	                    the decompressor. May be nullptr if dictionary_len
+ *	                    is 0.
+ *	@param dictionary_len - Length of dictionary in bytes
+ */
+LZCodec::LZCodec(uint8_t const dictionary[], size_t dictionary_len)
+{
+	m_dictionary = dictionary;
+	m_dictionary_len = dictionary_len;
+	memset(m_table, 0, sizeof m_table);
+}
+
+
+uint32_t LZCodec::hash(size_t pos, uint8_t const in[])
+{
+	uint32_t value =
+		static_cast<uint32_t>(at(pos, in)) |
+		(static_cast<uint32_t>(at(pos + 1, in)) << 8) |
+		(static_cast<uint32_t>(at(pos + 2, in)) << 16) |
+		(static_cast<uint32_t>(at(pos + 3, in)) << 24);
+	return (value * 2654435761U) >> (32 - HASH_BITS);
+}
+
+
+/**
+ *	Compress a message
+ *	Matches are found with a single entry hash table of the last position of
+ *	every 4 bytes, so compression takes one pass over the dictionary and the
+ *	message, and no memory beyond the codec
+ *	@param in - Input - Message to compress
+ *	@param in_len - Length of in in bytes. With the dictionary, at most
+ *	                LZCodec::MAX_OFFSET
+ *	@param out - Output - Compressed message
+ *	@param out_size - Size of out in bytes. Compression always succeeds if
+ *	                  this is at least LZCodec::maxCompressedLength(in_len)
+ *	@return
+ *		0 - The compressed message does not fit into out, or the message is
+ *		    too long
+ *		Otherwise, the length of the compressed message in bytes
+ */
+size_t LZCodec::compress(
+	uint8_t const in[],
+	size_t in_len,
+	uint8_t out[],
+	size_t out_size)
+{
+	size_t total = m_dictionary_len + in_len;
+	if(total > MAX_OFFSET)
+	{
+		return 0;
+	}
+	memset(m_table, 0, sizeof m_table);
+	for(size_t p = 0; (p + MIN_MATCH) <= m_dictionary_len; p++)
+	{
+		m_table[hash(p, in)] = static_cast<uint16_t>(p + 1);
+	}
+
+	size_t out_pos = 0;
+	size_t anchor = m_dictionary_len;
+	size_t p = m_dictionary_len;
+	while((p + MIN_MATCH) <= total)
+	{
+		uint32_t h = hash(p, in);
+		size_t candidate = m_table[h];
+		m_table[h] = static_cast<uint16_t>(p + 1);
+		if(0 == candidate)
+		{
+			p++;
+			continue;
+		}
+		candidate--;
+		size_t len = 0;
+		while(((p + len) < total) && (at(candidate + len, in) == at(p + len, in)))
+		{
+			len++;
+		}
+		if(len < MIN_MATCH)
+		{
+			p++;
+			continue;
+		}
+
+		if(false == writeSequence(
+			out, out_size, &out_pos,
+			&in[anchor - m_dictionary_len], p - anchor,
+			p - candidate, len))
+		{
+			return 0;
+		}
+		//Index the positions inside the match, so later reports can refer
+		//	to this one
+		size_t end = p + len;
+		for(p++; (p < end) && ((p + MIN_MATCH) <= total); p++)
+		{
+			m_table[hash(p, in)] = static_cast<uint16_t>(p + 1);
+		}
+		p = end;
+		anchor = p;
+	}
+
+	if(false == writeSequence(
+		out, out_size, &out_pos,
+		&in[anchor - m_dictionary_len], total - anchor,
+		0, 0))
+	{
+		return 0;
+	}
+	return out_pos;
+}
+
+
+/**
+ *	Decompress a message compressed with the same dictionary
+ *	@param in - Input - Compressed message
+ *	@param in_len - Length of in in bytes
+ *	@param out - Output - Decompressed message
+ *	@param out_len - Input - Size of out in bytes
+ *	                 Output - Length of the decompressed message in bytes
+ *	@return
+ *		false - The message is malformed, or does not fit into out
+ *		true - Success
+ */
+bool LZCodec::decompress(
+	uint8_t const in[],
+	size_t in_len,
+	uint8_t out[],
+	size_t *out_len)
+{
+	size_t out_size = *out_len;
+	size_t in_pos = 0;
+	size_t out_pos = 0;
+	*out_len = 0;
+	while(in_pos < in_len)
+	{
+		uint8_t token = in[in_pos++];
+		size_t literal_len = token >> 4;
+		if(
+			(15 == literal_len) &&
+			(false == readLength(in, in_len, &in_pos, &literal_len)))
+		{
+			return false;
+		}
+		if(
+			(literal_len > (in_len - in_pos)) ||
+			(literal_len > (out_size - out_pos)))
+		{
+			return false;
+		}
+		memcpy(&out[out_pos], &in[in_pos], literal_len);
+		in_pos += literal_len;
+		out_pos += literal_len;
+		if(in_pos == in_len)
+		{
+			break;
+		}
+
+		if(2 > (in_len - in_pos))
+		{
+			return false;
+		}
+		size_t offset = in[in_pos] | (static_cast<size_t>(in[in_pos + 1]) << 8);
+		in_pos += 2;
+		size_t match_len = token & 0x0F;
+		if(
+			(15 == match_len) &&
+			(false == readLength(in, in_len, &in_pos, &match_len)))
+		{
+			return false;
+		}
+		match_len += MIN_MATCH;
+		if(
+			(0 == offset) ||
+			(offset > (m_dictionary_len + out_pos)) ||
+			(match_len > (out_size - out_pos)))
+		{
+			return false;
+		}
+
+		//The match may start in the dictionary, and may overlap the bytes
+		//	it produces, so copy a byte at a time
+		size_t source = m_dictionary_len + out_pos - offset;
+		for(size_t i = 0; i < match_len; i++, source++)
+		{
+			out[out_pos++] = (source < m_dictionary_len) ?
+				m_dictionary[source] :
+				out[source - m_dictionary_len];
+		}
+	}
+	*out_len = out_pos;
+	return true;
+}
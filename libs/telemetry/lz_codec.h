@@ -0,0 +1,76 @@
+/**
+ * lz_codec.h
+ * Small LZ77 codec for report batches, with a preset dictionary.
+ *
+ * The dictionary is treated as data that precedes every message, so even the
+ * first report of a batch is encoded as matches into it. The stream is a
+ * series of sequences, in the same layout as an LZ4 block:
+ *	token      - literal length (high nibble), match length - 4 (low nibble)
+ *	           - A nibble of 15 is followed by bytes adding to it, up to
+ *	             and including the first byte below 255
+ *	literals
+ *	offset     - 2 bytes little endian, distance back from the current
+ *	             position, reaching into the dictionary
+ * The last sequence ends after its literals, with no offset or match.
+ */
+
+#ifndef LZ_CODEC_H
+#define LZ_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+class LZCodec {
+	public:
+	static size_t constexpr MIN_MATCH = 4;
+	static size_t constexpr MAX_OFFSET = 0xFFFF;
+	static uint8_t constexpr HASH_BITS = 10;
+
+	LZCodec(uint8_t const dictionary[], size_t dictionary_len);
+	size_t compress(
+		uint8_t const in[],
+		size_t in_len,
+		uint8_t out[],
+		size_t out_size);
+	bool decompress(
+		uint8_t const in[],
+		size_t in_len,
+		uint8_t out[],
+		size_t *out_len);
+
+	/**
+	 *	Largest compressed length of a message, when none of it matches
+	 */
+	static size_t constexpr maxCompressedLength(size_t len)
+	{
+		return 1 + len + (len / 255) + 1;
+	}
+
+	/**
+	 *	Largest message that is sure to compress into the given size
+	 */
+	static size_t constexpr maxInputLength(size_t compressed_len)
+	{
+		return (compressed_len > 2) ?
+			((compressed_len - 2) * 255) / 256 :
+			0;
+	}
+
+	private:
+	uint8_t at(size_t pos, uint8_t const in[])
+	{
+		return (pos < m_dictionary_len) ?
+			m_dictionary[pos] :
+			in[pos - m_dictionary_len];
+	}
+
+	uint32_t hash(size_t pos, uint8_t const in[]);
+
+	uint8_t const *m_dictionary;
+	size_t m_dictionary_len;
+	//Position + 1 of the last occurence of each hashed 4 bytes. 0 is empty.
+	uint16_t m_table[1 << HASH_BITS];
+};
+
+#endif //LZ_CODEC_H
@@ -0,0 +1,28 @@
+/**
+ * lz_dictionary.h
+ * Preset dictionary for LZCodec, generated from log.json by
+ * tools/lz_train. Do not edit.
+ * Changing the dictionary changes the compressed format; the
+ * decompressor must use the same dictionary as the firmware.
+ */
+
+#ifndef LZ_DICTIONARY_H
+#define LZ_DICTIONARY_H
+
+#include <cstdint>
+
+static uint8_t const SENTINEL_LZ_DICTIONARY[] = {
+	0x32, 0x39, 0x33, 0x7D, 0x5D, 0x5B, 0x7B, 0x22, 0x64, 0x65, 0x76, 0x69,
+	0x63, 0x65, 0x5F, 0x69, 0x64, 0x22, 0x3A, 0x22, 0x74, 0x6F, 0x6E, 0x69,
+	0x74, 0x72, 0x75, 0x73, 0x22, 0x2C, 0x22, 0x6C, 0x61, 0x74, 0x69, 0x74,
+	0x75, 0x64, 0x65, 0x22, 0x3A, 0x34, 0x34, 0x2E, 0x33, 0x39, 0x39, 0x38,
+	0x37, 0x36, 0x2C, 0x22, 0x6C, 0x6F, 0x6E, 0x67, 0x69, 0x74, 0x75, 0x64,
+	0x65, 0x22, 0x3A, 0x31, 0x39, 0x2C, 0x22, 0x72, 0x6F, 0x62, 0x6F, 0x74,
+	0x53, 0x74, 0x61, 0x74, 0x65, 0x22, 0x3A, 0x22, 0x45, 0x72, 0x72, 0x6F,
+	0x72, 0x22, 0x2C, 0x22, 0x74, 0x69, 0x6D, 0x65, 0x73, 0x74, 0x61, 0x6D,
+	0x70, 0x22, 0x3A, 0x22, 0x32, 0x30, 0x32, 0x31, 0x2D, 0x30, 0x32, 0x2D,
+	0x32, 0x33, 0x54, 0x31, 0x31, 0x3A, 0x32, 0x30, 0x3A, 0x30, 0x38, 0x5A,
+	0x22, 0x2C, 0x22, 0x63, 0x6E, 0x74, 0x22, 0x3A,
+};
+
+#endif //LZ_DICTIONARY_H
@@ -0,0 +1,78 @@
+/**
+ * report_filter.cpp
+ */
+
+#include "report_filter.h"
+#include <cmath>
+
+//Mean radius of the earth, in metres per degree of latitude
+static float constexpr METRES_PER_DEGREE = 111195.0f;
+static float constexpr RADIANS_PER_DEGREE = 0.01745329252f;
+
+/**
+ *	@param min_distance - Distance in metres the robot must move from the
+ *	                      last report sent for a report to be sent
+ *	@param heartbeat_interval - Seconds after the last report sent that a
+ *	                            report is sent even if nothing changed
+ */
+SentinelReportFilter::SentinelReportFilter(
+	float min_distance,
+	uint32_t heartbeat_interval)
+{
+	m_min_distance_squared = min_distance * min_distance;
+	m_heartbeat_interval = heartbeat_interval;
+	m_has_reference = false;
+	m_longitude_scale = METRES_PER_DEGREE;
+	m_suppressed = 0;
+	m_suppressed_since_accepted = 0;
+	m_suppressed_before_last = 0;
+}
+
+
+/**
+ *	Decide whether to send a report. An accepted report becomes the
+ *	reference later reports are compared against.
+ *	Distances are measured on an equirectangular projection around the
+ *	reference, which is accurate to well under a percent over the distances
+ *	a robot covers between reports, and needs no trigonometry per report.
+ *	@param report - The new report
+ *	@return
+ *		false - Suppress the report
+ *		true - Send the report
+ */
+bool SentinelReportFilter::accept(SentinelReport const &report)
+{
+	bool send = (false == m_has_reference) ||
+		(report.robot_state != m_reference.robot_state) ||
+		((report.timestamp - m_reference.timestamp) >= m_heartbeat_interval);
+	if(false == send)
+	{
+		float north = (report.latitude - m_reference.latitude) * METRES_PER_DEGREE;
+		float east = report.longitude - m_reference.longitude;
+		//Take the short way around the antimeridian
+		if(east > 180.0f)
+		{
+			east -= 360.0f;
+		}
+		else if(east < -180.0f)
+		{
+			east += 360.0f;
+		}
+		east *= m_longitude_scale;
+		send = ((north * north) + (east * east)) > m_min_distance_squared;
+	}
+
+	if(false == send)
+	{
+		m_suppressed++;
+		m_suppressed_since_accepted++;
+		return false;
+	}
+	m_suppressed_before_last = m_suppressed_since_accepted;
+	m_suppressed_since_accepted = 0;
+	m_reference = report;
+	m_longitude_scale =
+		METRES_PER_DEGREE * cosf(report.latitude * RADIANS_PER_DEGREE);
+	m_has_reference = true;
+	return true;
+}
@@ -0,0 +1,55 @@
+/**
+ * report_filter.h
+ * Significant change filter for Sentinel reports. A report is only sent if
+ * the robot moved further than a minimum distance from the last report sent,
+ * its state changed, or the heartbeat interval passed since the last report
+ * sent.
+ * Reports keep counting cnt when they are suppressed, so the backend sees
+ * the number of suppressed reports as the gap in cnt between two reports,
+ * and knows the robot stayed within the minimum distance meanwhile.
+ */
+
+#ifndef REPORT_FILTER_H
+#define REPORT_FILTER_H
+
+#include "sentinel_report.h"
+
+class SentinelReportFilter {
+	public:
+	SentinelReportFilter(float min_distance, uint32_t heartbeat_interval);
+	bool accept(SentinelReport const &report);
+
+	void reset()
+	{
+		m_has_reference = false;
+	}
+
+	/**
+	 *	Number of reports suppressed since the filter was created
+	 */
+	uint32_t suppressed()
+	{
+		return m_suppressed;
+	}
+
+	/**
+	 *	Number of reports suppressed between the last two accepted reports
+	 */
+	uint32_t suppressedBeforeLast()
+	{
+		return m_suppressed_before_last;
+	}
+
+	private:
+	float m_min_distance_squared;
+	uint32_t m_heartbeat_interval;
+	bool m_has_reference;
+	SentinelReport m_reference;
+	//Metres per degree of longitude at the reference latitude
+	float m_longitude_scale;
+	uint32_t m_suppressed;
+	uint32_t m_suppressed_since_accepted;
+	uint32_t m_suppressed_before_last;
+};
+
+#endif //REPORT_FILTER_H
@@ -0,0 +1,152 @@
+/**
+ * report_history.h
+ * Fixed size history of Sentinel reports, kept in RAM while they can't be
+ * published. When the history is full, the older half is thinned out by
+ * dropping every other report in it, so a long outage keeps the shape of
+ * the whole track at a resolution that falls off with age, rather than only
+ * its start or its end. The newest reports are always kept at full
+ * resolution.
+ * As the reports keep their cnt, the backend sees how many were thinned out
+ * as the gap in cnt between two reports.
+ */
+
+#ifndef REPORT_HISTORY_H
+#define REPORT_HISTORY_H
+
+#include "sentinel_report.h"
+
+/**
+ *	@tparam CAPACITY - Number of reports kept. The history takes up
+ *	                   CAPACITY * sizeof(SentinelReport) bytes
+ */
+template<size_t CAPACITY>
+class SentinelReportHistory {
+	public:
+	static_assert(CAPACITY >= 4, "The history must hold at least 4 reports");
+
+	SentinelReportHistory()
+	{
+		m_first = 0;
+		m_count = 0;
+		m_thinned = 0;
+	}
+
+	/**
+	 *	Add a report after the newest one, thinning out the older half of the
+	 *	history first if it is full
+	 */
+	void add(SentinelReport const &report)
+	{
+		if(CAPACITY == m_count)
+		{
+			thin();
+		}
+		m_reports[(m_first + m_count) % CAPACITY] = report;
+		m_count++;
+	}
+
+	/**
+	 *	The oldest report, or nullptr if the history is empty
+	 */
+	SentinelReport const *peek()
+	{
+		if(0 == m_count)
+		{
+			return nullptr;
+		}
+		return &m_reports[m_first];
+	}
+
+	/**
+	 *	Remove the oldest report
+	 */
+	void pop()
+	{
+		if(0 == m_count)
+		{
+			return;
+		}
+		m_first = (m_first + 1) % CAPACITY;
+		m_count--;
+	}
+
+	/**
+	 *	Hand the reports to a TelemetryBatcher, oldest first, until the
+	 *	history is empty or the batcher stops taking them. A report the
+	 *	batcher doesn't take stays in the history.
+	 *	@param batcher - TelemetryBatcher, or anything with add() returning
+	 *	                 ADDED or FLUSHED when it takes a report
+	 *	@return Number of reports handed over
+	 */
+	template<class Batcher>
+	size_t drain(Batcher &batcher)
+	{
+		size_t drained = 0;
+		for(SentinelReport const *report = peek(); nullptr != report; report = peek())
+		{
+			typename Batcher::Return status = batcher.add(*report);
+			if(
+				(Batcher::Return::ADDED != status) &&
+				(Batcher::Return::FLUSHED != status))
+			{
+				break;
+			}
+			pop();
+			drained++;
+		}
+		return drained;
+	}
+
+	bool isEmpty()
+	{
+		return 0 == m_count;
+	}
+
+	size_t count()
+	{
+		return m_count;
+	}
+
+	/**
+	 *	Number of reports dropped to make room since the history was created
+	 */
+	uint32_t thinned()
+	{
+		return m_thinned;
+	}
+
+	private:
+	/**
+	 *	Keep every other report of the older half, starting with the oldest,
+	 *	and move the newer half down behind them
+	 */
+	void thin()
+	{
+		size_t half = m_count / 2;
+		size_t kept = (half + 1) / 2;
+		//Reports only ever move towards the oldest, so none is overwritten
+		//	before it is moved
+		for(size_t i = 1; i < kept; i++)
+		{
+			at(i) = at(2 * i);
+		}
+		for(size_t i = half; i < m_count; i++)
+		{
+			at(kept + (i - half)) = at(i);
+		}
+		m_thinned += half - kept;
+		m_count -= half - kept;
+	}
+
+	SentinelReport &at(size_t i)
+	{
+		return m_reports[(m_first + i) % CAPACITY];
+	}
+
+	SentinelReport m_reports[CAPACITY];
+	size_t m_first;
+	size_t m_count;
+	uint32_t m_thinned;
+};
+
+#endif //REPORT_HISTORY_H
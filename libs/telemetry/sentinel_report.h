@@ -0,0 +1,62 @@
+/**
+ * sentinel_report.h
+ * A single position report sent to the Sentinel backend. The device ID is
+ * the same for every report, so it is kept by the encoders rather than in
+ * each report.
+ */
+
+#ifndef SENTINEL_REPORT_H
+#define SENTINEL_REPORT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+ *	Names of the robot states, as they appear in the robotState field of the
+ *	JSON reports. Encoders send the index into this table.
+ *	Only append to this table; the index is part of the wire format.
+ */
+static char const *const SENTINEL_ROBOT_STATE_NAMES[] = {
+	"Error",
+};
+static uint8_t constexpr SENTINEL_ROBOT_STATE_COUNT =
+	sizeof SENTINEL_ROBOT_STATE_NAMES / sizeof SENTINEL_ROBOT_STATE_NAMES[0];
+
+class SentinelReport {
+	public:
+	enum class RobotState : uint8_t {
+		ERROR = 0,
+	};
+
+	SentinelReport()
+	{
+		latitude = 0;
+		longitude = 0;
+		robot_state = RobotState::ERROR;
+		timestamp = 0;
+		cnt = 0;
+	}
+
+	/**
+	 *	Name of the robot state, or nullptr if it's not in
+	 *	SENTINEL_ROBOT_STATE_NAMES
+	 */
+	char const *robotStateName() const
+	{
+		uint8_t idx = static_cast<uint8_t>(robot_state);
+		if(idx >= SENTINEL_ROBOT_STATE_COUNT)
+		{
+			return nullptr;
+		}
+		return SENTINEL_ROBOT_STATE_NAMES[idx];
+	}
+
+	float latitude;
+	float longitude;
+	RobotState robot_state;
+	uint32_t timestamp; //Seconds since the Unix epoch
+	uint32_t cnt;
+};
+
+#endif //SENTINEL_REPORT_H
@@ -0,0 +1,1050 @@
+/**
+ * test.cpp
+ * Unit test for the Sentinel report encoders
+ */
+
+#include "cbor_report.h"
+#include "delta_report.h"
+#include "json_report.h"
+#include "lz_codec.h"
+#include "lz_dictionary.h"
+#include "report_filter.h"
+#include "report_history.h"
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+#include <random>
+#include <string>
+
+static char constexpr DEVICE_ID[] = "tonitrus";
+static size_t constexpr BATCH_SIZE = 6;
+static size_t constexpr JSON_BATCH_SIZE = 804;
+
+//The first batch in log.json
+static SentinelReport const *testReports()
+{
+	static SentinelReport reports[BATCH_SIZE];
+	static float constexpr values[BATCH_SIZE][2] = {
+		{37.799976, 18.600174},
+		{37.899975, 18.550175},
+		{37.999973, 18.500175},
+		{38.099972, 18.450176},
+		{38.199970, 18.400177},
+		{38.299969, 18.350178},
+	};
+	for(size_t i = 0; i < BATCH_SIZE; i++)
+	{
+		reports[i].latitude = values[i][0];
+		reports[i].longitude = values[i][1];
+		reports[i].robot_state = SentinelReport::RobotState::ERROR;
+		reports[i].timestamp = 1614076088 + (10 * i);
+		reports[i].cnt = 228 + i;
+	}
+	return reports;
+}
+
+
+static bool sameReport(SentinelReport const &a, SentinelReport const &b)
+{
+	return
+		(a.latitude == b.latitude) &&
+		(a.longitude == b.longitude) &&
+		(a.robot_state == b.robot_state) &&
+		(a.timestamp == b.timestamp) &&
+		(a.cnt == b.cnt);
+}
+
+
+class TestCBORReport {
+	public:
+	TestCBORReport() {}
+
+	/**
+	 * Encode a full batch, and decode it
+	 * Verify that every report and the device ID survive the round trip
+	 */
+	bool roundTrip()
+	{
+		m_name.assign("cbor_roundTrip");
+		if(false == encode(sizeof m_buffer, BATCH_SIZE))
+		{
+			return false;
+		}
+
+		SentinelCBORDecoder decoder(m_buffer, m_len);
+		char device_id[16];
+		if(
+			(false == decoder.deviceID(device_id, sizeof device_id)) ||
+			(std::string(DEVICE_ID) != device_id))
+		{
+			return false;
+		}
+		SentinelReport const *reports = testReports();
+		SentinelReport report;
+		size_t cnt = 0;
+		for(; true == decoder.next(&report); cnt++)
+		{
+			if((cnt >= BATCH_SIZE) || (false == sameReport(reports[cnt], report)))
+			{
+				return false;
+			}
+		}
+		return (BATCH_SIZE == cnt) && (true == decoder.isValid());
+	}
+
+	/**
+	 * Encode a full batch
+	 * Verify that it is at least 5 times smaller than the JSON batch
+	 */
+	bool batchSize()
+	{
+		m_name.assign("cbor_batchSize");
+		return
+			(true == encode(sizeof m_buffer, BATCH_SIZE)) &&
+			((m_len * 5) <= JSON_BATCH_SIZE);
+	}
+
+	/**
+	 * Encode a batch into a buffer too small for all the reports
+	 * Verify that the reports that don't fit are refused, and the reports
+	 * that do fit still decode
+	 */
+	bool overflow()
+	{
+		m_name.assign("cbor_overflow");
+		size_t size = 12 + (2 * SentinelCBOREncoder::REPORT_MAX_SIZE);
+		if(true == encode(size, BATCH_SIZE))
+		{
+			return false;
+		}
+		if((m_count >= BATCH_SIZE) || (m_len > size))
+		{
+			return false;
+		}
+		SentinelCBORDecoder decoder(m_buffer, m_len);
+		SentinelReport report;
+		size_t cnt = 0;
+		for(; true == decoder.next(&report); cnt++);
+		return (m_count == cnt) && (true == decoder.isValid());
+	}
+
+	/**
+	 * Decode a truncated batch
+	 * Verify that the decoder stops and reports the batch as invalid
+	 */
+	bool truncated()
+	{
+		m_name.assign("cbor_truncated");
+		if(false == encode(sizeof m_buffer, BATCH_SIZE))
+		{
+			return false;
+		}
+		SentinelCBORDecoder decoder(m_buffer, m_len - 4);
+		SentinelReport report;
+		size_t cnt = 0;
+		for(; true == decoder.next(&report); cnt++);
+		return (cnt < BATCH_SIZE) && (false == decoder.isValid());
+	}
+
+	/**
+	 * Print the result of the most recent test
+	 */
+	std::string printResult()
+	{
+		std::string result = m_name;
+		result += "\nResult:\n";
+		result += "\tlength = " + std::to_string(m_len) + "\n";
+		result += "\tcount = " + std::to_string(m_count) + "\n";
+		return result;
+	}
+
+	private:
+	bool encode(size_t size, size_t count)
+	{
+		SentinelCBOREncoder encoder;
+		m_len = 0;
+		m_count = 0;
+		if(false == encoder.begin(m_buffer, size, DEVICE_ID))
+		{
+			return false;
+		}
+		SentinelReport const *reports = testReports();
+		bool all_added = true;
+		for(size_t i = 0; i < count; i++)
+		{
+			if(false == encoder.add(reports[i]))
+			{
+				all_added = false;
+				break;
+			}
+		}
+		m_count = encoder.count();
+		m_len = encoder.finish();
+		return all_added && (0 != m_len);
+	}
+
+	uint8_t m_buffer[512];
+	size_t m_len = 0;
+	size_t m_count = 0;
+	std::string m_name;
+};
+
+
+class TestDeltaReport {
+	public:
+	TestDeltaReport() {}
+
+	/**
+	 * Encode a full batch, and decode it
+	 * Verify that every report and the device ID survive the round trip
+	 */
+	bool roundTrip()
+	{
+		m_name.assign("delta_roundTrip");
+		SentinelReport const *reports = testReports();
+		if(false == encode(reports, BATCH_SIZE, sizeof m_buffer))
+		{
+			return false;
+		}
+		SentinelDeltaDecoder decoder(m_buffer, m_len);
+		char device_id[16];
+		if(
+			(false == decoder.deviceID(device_id, sizeof device_id)) ||
+			(std::string(DEVICE_ID) != device_id))
+		{
+			return false;
+		}
+		return decode(reports, BATCH_SIZE);
+	}
+
+	/**
+	 * Encode a full batch of a robot moving at a steady speed
+	 * Verify that the reports after the first one cost a byte per field
+	 */
+	bool batchSize()
+	{
+		m_name.assign("delta_batchSize");
+		size_t max_len = 32 + ((BATCH_SIZE - 1) * 5);
+		return
+			(true == encode(testReports(), BATCH_SIZE, sizeof m_buffer)) &&
+			(m_len <= max_len);
+	}
+
+	/**
+	 * Encode reports with negative coordinates, jumps in time, and a
+	 * counter that wraps
+	 * Verify that they survive the round trip
+	 */
+	bool extremes()
+	{
+		m_name.assign("delta_extremes");
+		SentinelReport reports[4];
+		float constexpr values[4][2] = {
+			{-89.999999, 179.999999},
+			{89.999999, -179.999999},
+			{0.000001, -0.000001},
+			{-45.5, 90.25},
+		};
+		uint32_t constexpr timestamps[4] = {0xFFFFFFFF, 0, 1614076088, 12};
+		for(size_t i = 0; i < 4; i++)
+		{
+			reports[i].latitude = values[i][0];
+			reports[i].longitude = values[i][1];
+			reports[i].robot_state = SentinelReport::RobotState::ERROR;
+			reports[i].timestamp = timestamps[i];
+			reports[i].cnt = 0xFFFFFFFE + i;
+		}
+		return
+			(true == encode(reports, 4, sizeof m_buffer)) &&
+			(true == decode(reports, 4));
+	}
+
+	/**
+	 * Decode a truncated batch
+	 * Verify that the decoder stops and reports the batch as invalid
+	 */
+	bool truncated()
+	{
+		m_name.assign("delta_truncated");
+		SentinelReport const *reports = testReports();
+		if(false == encode(reports, BATCH_SIZE, sizeof m_buffer))
+		{
+			return false;
+		}
+		//Cut the batch in the middle of the first report
+		m_len = 1 + sizeof DEVICE_ID;
+		SentinelDeltaDecoder decoder(m_buffer, m_len);
+		SentinelReport report;
+		return
+			(false == decoder.next(&report)) &&
+			(false == decoder.isValid());
+	}
+
+	/**
+	 * Print the result of the most recent test
+	 */
+	std::string printResult()
+	{
+		std::string result = m_name;
+		result += "\nResult:\n";
+		result += "\tlength = " + std::to_string(m_len) + "\n";
+		result += "\tcount = " + std::to_string(m_count) + "\n";
+		return result;
+	}
+
+	private:
+	bool encode(SentinelReport const reports[], size_t count, size_t size)
+	{
+		SentinelDeltaEncoder encoder;
+		m_len = 0;
+		m_count = 0;
+		if(false == encoder.begin(m_buffer, size, DEVICE_ID))
+		{
+			return false;
+		}
+		bool all_added = true;
+		for(size_t i = 0; i < count; i++)
+		{
+			if(false == encoder.add(reports[i]))
+			{
+				all_added = false;
+				break;
+			}
+		}
+		m_count = encoder.count();
+		m_len = encoder.finish();
+		return all_added && (0 != m_len);
+	}
+
+	bool decode(SentinelReport const reports[], size_t count)
+	{
+		SentinelDeltaDecoder decoder(m_buffer, m_len);
+		SentinelReport report;
+		size_t cnt = 0;
+		for(; true == decoder.next(&report); cnt++)
+		{
+			if((cnt >= count) || (false == sameReport(reports[cnt], report)))
+			{
+				return false;
+			}
+		}
+		return (count == cnt) && (true == decoder.isValid());
+	}
+
+	uint8_t m_buffer[512];
+	size_t m_len = 0;
+	size_t m_count = 0;
+	std::string m_name;
+};
+
+
+class TestJSONReport {
+	public:
+	TestJSONReport() {}
+
+	/**
+	 * Format floats across the whole range, and the values that round half
+	 * way, with every number of decimals
+	 * Verify that the text is the same as printf's
+	 */
+	bool fixed()
+	{
+		m_name.assign("json_fixed");
+		std::mt19937 rng(228);
+		std::uniform_real_distribution<float> coordinate(-180, 180);
+		float constexpr edges[] = {
+			0.0f, -0.0f, 0.5f, 1.5f, 2.5f, -2.5f, 0.125f, 0.0625f,
+			1e-10f, -1e-7f, 5e-7f, 180.0f, -90.0f, 37.799976f, 8388607.5f,
+			1e9f, 4e9f,
+		};
+		for(uint8_t decimals = 0; decimals <= TextAppender::MAX_DECIMALS; decimals++)
+		{
+			for(float value : edges)
+			{
+				if(false == sameAsPrintf(value, decimals))
+				{
+					return false;
+				}
+			}
+			for(size_t i = 0; i < 10000; i++)
+			{
+				if(false == sameAsPrintf(coordinate(rng), decimals))
+				{
+					return false;
+				}
+			}
+		}
+		//10^30 does not fit in 64 bits
+		char text[64];
+		TextAppender appender(text, sizeof text);
+		return false == appender.appendFixed(1e21f, TextAppender::MAX_DECIMALS);
+	}
+
+	/**
+	 * Step a timestamp through leap days, month, year and century ends, and
+	 * set it to random times
+	 * Verify that it matches strftime after every step
+	 */
+	bool timestamp()
+	{
+		m_name.assign("json_timestamp");
+		ISO8601Timestamp iso;
+		uint32_t constexpr starts[] = {
+			0, 951696000, 1582848000, 1614076088, 4107456000,
+		};
+		for(uint32_t start : starts)
+		{
+			for(uint32_t t = start; t < (start + (3 * 86400)); t += 7)
+			{
+				if(false == sameAsStrftime(&iso, t))
+				{
+					return false;
+				}
+			}
+		}
+		std::mt19937 rng(228);
+		for(size_t i = 0; i < 100000; i++)
+		{
+			if(false == sameAsStrftime(&iso, rng()))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Encode a full batch
+	 * Verify that it is the same as the reports formatted by snprintf
+	 */
+	bool batch()
+	{
+		m_name.assign("json_batch");
+		SentinelReport const *reports = testReports();
+		if(false == encode(sizeof m_buffer, BATCH_SIZE))
+		{
+			return false;
+		}
+		std::string expected = "[";
+		for(size_t i = 0; i < BATCH_SIZE; i++)
+		{
+			char t_buf[32];
+			time_t t = reports[i].timestamp;
+			struct tm tm;
+			gmtime_r(&t, &tm);
+			strftime(t_buf, sizeof t_buf, "%Y-%m-%dT%H:%M:%SZ", &tm);
+			char record[160];
+			snprintf(record, sizeof record,
+				"{"
+					"\"device_id\":\"%s\","
+					"\"latitude\":%f,"
+					"\"longitude\":%f,"
+					"\"robotState\":\"Error\","
+					"\"timestamp\":\"%s\","
+					"\"cnt\":%u"
+				"}%c",
+				DEVICE_ID,
+				reports[i].latitude,
+				reports[i].longitude,
+				t_buf,
+				reports[i].cnt,
+				(i + 1) < BATCH_SIZE ? ',' : ']');
+			expected += record;
+		}
+		m_result.assign(reinterpret_cast<char*>(m_buffer), m_len);
+		return expected == m_result;
+	}
+
+	/**
+	 * Encode a batch into a buffer too small for all the reports
+	 * Verify that the reports that don't fit are refused, and the batch is
+	 * still closed
+	 */
+	bool overflow()
+	{
+		m_name.assign("json_overflow");
+		size_t size = (2 * JSON_BATCH_SIZE) / BATCH_SIZE;
+		if(true == encode(size, BATCH_SIZE))
+		{
+			return false;
+		}
+		m_result.assign(reinterpret_cast<char*>(m_buffer), m_len);
+		return
+			(1 == m_count) &&
+			(m_len <= size) &&
+			('[' == m_result.front()) &&
+			('}' == m_result[m_len - 2]) &&
+			(']' == m_result.back());
+	}
+
+	/**
+	 * Print the result of the most recent test
+	 */
+	std::string printResult()
+	{
+		std::string result = m_name;
+		result += "\nResult:\n";
+		result += "\tlength = " + std::to_string(m_len) + "\n";
+		result += "\tcount = " + std::to_string(m_count) + "\n";
+		result += "\ttext = " + m_result + "\n";
+		return result;
+	}
+
+	private:
+	bool sameAsPrintf(float value, uint8_t decimals)
+	{
+		char expected[64];
+		snprintf(expected, sizeof expected, "%.*f", decimals, value);
+		char text[64];
+		TextAppender appender(text, sizeof text);
+		appender.appendFixed(value, decimals);
+		m_result.assign(text, appender.length());
+		m_result += " (expected ";
+		m_result += expected;
+		m_result += ")";
+		return
+			(true == appender.ok()) &&
+			(std::string(expected) == std::string(text, appender.length()));
+	}
+
+	bool sameAsStrftime(ISO8601Timestamp *iso, uint32_t epoch)
+	{
+		char expected[32];
+		time_t t = epoch;
+		struct tm tm;
+		gmtime_r(&t, &tm);
+		strftime(expected, sizeof expected, "%Y-%m-%dT%H:%M:%SZ", &tm);
+		iso->set(epoch);
+		m_result.assign(iso->str());
+		return std::string(expected) == m_result;
+	}
+
+	bool encode(size_t size, size_t count)
+	{
+		SentinelJSONEncoder encoder;
+		m_len = 0;
+		m_count = 0;
+		if(false == encoder.begin(m_buffer, size, DEVICE_ID))
+		{
+			return false;
+		}
+		SentinelReport const *reports = testReports();
+		bool all_added = true;
+		for(size_t i = 0; i < count; i++)
+		{
+			if(false == encoder.add(reports[i]))
+			{
+				all_added = false;
+				break;
+			}
+		}
+		m_count = encoder.count();
+		m_len = encoder.finish();
+		return all_added && (0 != m_len);
+	}
+
+	uint8_t m_buffer[1024];
+	size_t m_len = 0;
+	size_t m_count = 0;
+	std::string m_result;
+	std::string m_name;
+};
+
+
+class TestLZCodec {
+	public:
+	TestLZCodec() :
+		m_codec(SENTINEL_LZ_DICTIONARY, sizeof SENTINEL_LZ_DICTIONARY)
+	{}
+
+	/**
+	 * Compress a full JSON batch, and decompress it
+	 * Verify that it survives the round trip, and is at least 4 times
+	 * smaller
+	 */
+	bool roundTrip()
+	{
+		m_name.assign("lz_roundTrip");
+		SentinelJSONEncoder encoder;
+		encoder.begin(m_input, sizeof m_input, DEVICE_ID);
+		SentinelReport const *reports = testReports();
+		for(size_t i = 0; i < BATCH_SIZE; i++)
+		{
+			encoder.add(reports[i]);
+		}
+		m_input_len = encoder.finish();
+		return
+			(true == compareRoundTrip(sizeof m_compressed)) &&
+			((m_len * 4) <= m_input_len);
+	}
+
+	/**
+	 * Compress random bytes
+	 * Verify that they survive the round trip, within the bounds given by
+	 * LZCodec::maxCompressedLength() and LZCodec::maxInputLength()
+	 */
+	bool incompressible()
+	{
+		m_name.assign("lz_incompressible");
+		std::mt19937 rng(228);
+		m_input_len = LZCodec::maxInputLength(MQTT_MESSAGE_SIZE);
+		for(size_t i = 0; i < m_input_len; i++)
+		{
+			m_input[i] = static_cast<uint8_t>(rng());
+		}
+		return
+			(true == compareRoundTrip(MQTT_MESSAGE_SIZE)) &&
+			(m_len <= LZCodec::maxCompressedLength(m_input_len));
+	}
+
+	/**
+	 * Decompress a stream that refers to data before the dictionary, and a
+	 * batch into a buffer that is too small
+	 * Verify that both are refused
+	 */
+	bool malformed()
+	{
+		m_name.assign("lz_malformed");
+		uint8_t constexpr bad_offset[] = {0x10, 'a', 0xFF, 0xFF};
+		size_t out_len = sizeof m_output;
+		if(true == m_codec.decompress(bad_offset, sizeof bad_offset, m_output, &out_len))
+		{
+			return false;
+		}
+		if(false == roundTrip())
+		{
+			return false;
+		}
+		out_len = m_input_len - 1;
+		return false == m_codec.decompress(m_compressed, m_len, m_output, &out_len);
+	}
+
+	/**
+	 * Print the result of the most recent test
+	 */
+	std::string printResult()
+	{
+		std::string result = m_name;
+		result += "\nResult:\n";
+		result += "\tinput length = " + std::to_string(m_input_len) + "\n";
+		result += "\tcompressed length = " + std::to_string(m_len) + "\n";
+		return result;
+	}
+
+	private:
+	static size_t constexpr MQTT_MESSAGE_SIZE = 900;
+
+	bool compareRoundTrip(size_t compressed_size)
+	{
+		m_len = m_codec.compress(m_input, m_input_len, m_compressed, compressed_size);
+		size_t out_len = sizeof m_output;
+		return
+			(0 != m_len) &&
+			(true == m_codec.decompress(m_compressed, m_len, m_output, &out_len)) &&
+			(m_input_len == out_len) &&
+			(0 == memcmp(m_input, m_output, out_len));
+	}
+
+	LZCodec m_codec;
+	uint8_t m_input[1024];
+	uint8_t m_compressed[1024];
+	uint8_t m_output[1024];
+	size_t m_input_len = 0;
+	size_t m_len = 0;
+	std::string m_name;
+};
+
+
+class TestReportFilter {
+	public:
+	TestReportFilter() {}
+
+	/**
+	 * Feed a stationary robot reporting every 10 s for an hour, with GPS
+	 * jitter below the minimum distance
+	 * Verify that only the heartbeats are sent, and the rest are counted
+	 */
+	bool stationary()
+	{
+		m_name.assign("filter_stationary");
+		SentinelReportFilter filter(MIN_DISTANCE, HEARTBEAT_INTERVAL);
+		std::mt19937 rng(228);
+		std::uniform_real_distribution<float> jitter(-0.00005, 0.00005);
+		m_sent = 0;
+		for(uint32_t i = 0; i < 360; i++)
+		{
+			SentinelReport report = sample(i);
+			report.latitude += jitter(rng);
+			report.longitude += jitter(rng);
+			if(true == filter.accept(report))
+			{
+				m_sent++;
+			}
+		}
+		m_suppressed = filter.suppressed();
+		return
+			(12 == m_sent) &&
+			(348 == m_suppressed) &&
+			(29 == filter.suppressedBeforeLast());
+	}
+
+	/**
+	 * Move the robot by less, and then by more than the minimum distance,
+	 * north and east, at a high latitude
+	 * Verify that only the moves beyond the minimum distance are sent
+	 */
+	bool moving()
+	{
+		m_name.assign("filter_moving");
+		SentinelReportFilter filter(MIN_DISTANCE, HEARTBEAT_INTERVAL);
+		SentinelReport report = sample(0);
+		report.latitude = 60.0;
+		if(false == filter.accept(report))
+		{
+			return false;
+		}
+		//At 60 degrees, a degree of longitude is half a degree of latitude
+		float constexpr metre = 1.0f / 111195.0f;
+		float constexpr moves[][3] = {
+			{0, 80 * metre, 0},
+			{0, 120 * metre, 1},
+			{40 * metre, 0, 0},
+			{60 * metre, 0, 1},
+			{30 * metre, 90 * metre, 1},
+		};
+		for(size_t i = 0; i < (sizeof moves / sizeof moves[0]); i++)
+		{
+			SentinelReport moved = report;
+			moved.timestamp += 10 * (i + 1);
+			moved.latitude += moves[i][0];
+			moved.longitude += moves[i][1];
+			if((0 != moves[i][2]) != filter.accept(moved))
+			{
+				return false;
+			}
+			if(0 != moves[i][2])
+			{
+				report = moved;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Change the robot state, and cross the antimeridian
+	 * Verify that the state change is sent, and the short way across the
+	 * antimeridian is suppressed
+	 */
+	bool stateAndWrap()
+	{
+		m_name.assign("filter_stateAndWrap");
+		SentinelReportFilter filter(MIN_DISTANCE, HEARTBEAT_INTERVAL);
+		SentinelReport report = sample(0);
+		report.latitude = 0;
+		report.longitude = 179.9999f;
+		filter.accept(report);
+		report.timestamp += 10;
+		report.longitude = -179.9999f;
+		if(true == filter.accept(report))
+		{
+			return false;
+		}
+		report.timestamp += 10;
+		report.robot_state = static_cast<SentinelReport::RobotState>(1);
+		return true == filter.accept(report);
+	}
+
+	/**
+	 * Print the result of the most recent test
+	 */
+	std::string printResult()
+	{
+		std::string result = m_name;
+		result += "\nResult:\n";
+		result += "\tsent = " + std::to_string(m_sent) + "\n";
+		result += "\tsuppressed = " + std::to_string(m_suppressed) + "\n";
+		return result;
+	}
+
+	private:
+	static float constexpr MIN_DISTANCE = 50;
+	static uint32_t constexpr HEARTBEAT_INTERVAL = 300;
+
+	SentinelReport sample(uint32_t i)
+	{
+		SentinelReport report;
+		report.latitude = 37.799976;
+		report.longitude = 18.600174;
+		report.timestamp = 1614076088 + (10 * i);
+		report.cnt = i;
+		return report;
+	}
+
+	size_t m_sent = 0;
+	size_t m_suppressed = 0;
+	std::string m_name;
+};
+
+
+/**
+ *	Stands in for TelemetryBatcher, taking a number of reports and then
+ *	refusing them as if both its buffers were waiting to be published
+ */
+class FakeBatcher {
+	public:
+	enum class Return {
+		BUFFER_BUSY = -2,
+		ADDED = 1,
+		FLUSHED,
+	};
+
+	Return add(SentinelReport const &report)
+	{
+		if(0 == room)
+		{
+			return Return::BUFFER_BUSY;
+		}
+		room--;
+		last_cnt = report.cnt;
+		return Return::ADDED;
+	}
+
+	size_t room = 0;
+	uint32_t last_cnt = 0;
+};
+
+
+class TestReportHistory {
+	public:
+	TestReportHistory() {}
+
+	/**
+	 * Add many times more reports than the history holds
+	 * Verify that the oldest and the newest half are kept, and that the
+	 * reports in between get sparser with age
+	 */
+	bool thinning()
+	{
+		m_name.assign("history_thinning");
+		SentinelReportHistory<CAPACITY> history;
+		for(uint32_t i = 0; i < 1000; i++)
+		{
+			SentinelReport report;
+			report.cnt = i;
+			history.add(report);
+		}
+		m_count = history.count();
+		uint32_t cnts[CAPACITY];
+		for(size_t i = 0; i < m_count; i++)
+		{
+			cnts[i] = history.peek()->cnt;
+			history.pop();
+		}
+		if(
+			(m_count > CAPACITY) ||
+			(m_count < (CAPACITY / 2)) ||
+			((1000 - m_count) != history.thinned()) ||
+			(0 != cnts[0]) ||
+			(999 != cnts[m_count - 1]) ||
+			(false == history.isEmpty()))
+		{
+			return false;
+		}
+		for(size_t i = 2; i < m_count; i++)
+		{
+			uint32_t gap = cnts[i] - cnts[i - 1];
+			uint32_t older_gap = cnts[i - 1] - cnts[i - 2];
+			if((0 == gap) || (gap > older_gap))
+			{
+				return false;
+			}
+			if((i >= (m_count - (CAPACITY / 2))) && (1 != gap))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Drain the history into a batcher that stops taking reports part way
+	 * Verify that the reports are handed over oldest first, and that the
+	 * rest stay in the history
+	 */
+	bool drain()
+	{
+		m_name.assign("history_drain");
+		SentinelReportHistory<CAPACITY> history;
+		for(uint32_t i = 0; i < 10; i++)
+		{
+			SentinelReport report;
+			report.cnt = i;
+			history.add(report);
+		}
+		FakeBatcher batcher;
+		batcher.room = 4;
+		if(
+			(4 != history.drain(batcher)) ||
+			(3 != batcher.last_cnt) ||
+			(4 != history.peek()->cnt))
+		{
+			return false;
+		}
+		batcher.room = 100;
+		m_count = history.drain(batcher);
+		return
+			(6 == m_count) &&
+			(9 == batcher.last_cnt) &&
+			(true == history.isEmpty()) &&
+			(0 == history.drain(batcher));
+	}
+
+	/**
+	 * Print the result of the most recent test
+	 */
+	std::string printResult()
+	{
+		std::string result = m_name;
+		result += "\nResult:\n";
+		result += "\tcount = " + std::to_string(m_count) + "\n";
+		return result;
+	}
+
+	private:
+	static size_t constexpr CAPACITY = 64;
+
+	size_t m_count = 0;
+	std::string m_name;
+};
+
+
+int main()
+{
+	TestCBORReport cbor;
+	TestDeltaReport delta;
+	TestJSONReport json;
+	TestLZCodec lz;
+	TestReportFilter filter;
+	TestReportHistory history;
+
+	if(false == cbor.roundTrip())
+	{
+		std::cout << cbor.printResult();
+		return -1;
+	}
+
+	if(false == cbor.batchSize())
+	{
+		std::cout << cbor.printResult();
+		return -1;
+	}
+
+	if(false == cbor.overflow())
+	{
+		std::cout << cbor.printResult();
+		return -1;
+	}
+
+	if(false == cbor.truncated())
+	{
+		std::cout << cbor.printResult();
+		return -1;
+	}
+
+	if(false == delta.roundTrip())
+	{
+		std::cout << delta.printResult();
+		return -1;
+	}
+
+	if(false == delta.batchSize())
+	{
+		std::cout << delta.printResult();
+		return -1;
+	}
+
+	if(false == delta.extremes())
+	{
+		std::cout << delta.printResult();
+		return -1;
+	}
+
+	if(false == delta.truncated())
+	{
+		std::cout << delta.printResult();
+		return -1;
+	}
+
+	if(false == json.fixed())
+	{
+		std::cout << json.printResult();
+		return -1;
+	}
+
+	if(false == json.timestamp())
+	{
+		std::cout << json.printResult();
+		return -1;
+	}
+
+	if(false == json.batch())
+	{
+		std::cout << json.printResult();
+		return -1;
+	}
+
+	if(false == json.overflow())
+	{
+		std::cout << json.printResult();
+		return -1;
+	}
+
+	if(false == lz.roundTrip())
+	{
+		std::cout << lz.printResult();
+		return -1;
+	}
+
+	if(false == lz.incompressible())
+	{
+		std::cout << lz.printResult();
+		return -1;
+	}
+
+	if(false == lz.malformed())
+	{
+		std::cout << lz.printResult();
+		return -1;
+	}
+
+	if(false == filter.stationary())
+	{
+		std::cout << filter.printResult();
+		return -1;
+	}
+
+	if(false == filter.moving())
+	{
+		std::cout << filter.printResult();
+		return -1;
+	}
+
+	if(false == filter.stateAndWrap())
+	{
+		std::cout << filter.printResult();
+		return -1;
+	}
+
+	if(false == history.thinning())
+	{
+		std::cout << history.printResult();
+		return -1;
+	}
+
+	if(false == history.drain())
+	{
+		std::cout << history.printResult();
+		return -1;
+	}
+}
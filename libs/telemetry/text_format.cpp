@@ -0,0 +1,244 @@
+/**
+ * text_format.cpp
+ */
+
+#include "text_format.h"
+
+static uint32_t constexpr POW10[TextAppender::MAX_DECIMALS + 1] = {
+	1,
+	10,
+	100,
+	1000,
+	10000,
+	100000,
+	1000000,
+	10000000,
+	100000000,
+	1000000000,
+};
+static uint32_t constexpr SECONDS_PER_DAY = 86400;
+static uint32_t constexpr NO_DAY = 0xFFFFFFFF;
+
+/**
+ *	Render an unsigned value in decimal
+ *	@param out - Output - At least 20 bytes
+ *	@return Number of digits written
+ */
+static size_t renderUint(char out[], uint64_t value)
+{
+	char digits[20];
+	size_t len = 0;
+	//64 bit division is a library call on the Cortex-M3, so only use it for
+	//	the digits that don't fit in 32 bits
+	for(; value > 0xFFFFFFFF; value /= 10)
+	{
+		digits[len++] = '0' + (value % 10);
+	}
+	uint32_t value32 = static_cast<uint32_t>(value);
+	do
+	{
+		digits[len++] = '0' + (value32 % 10);
+		value32 /= 10;
+	}
+	while(0 != value32);
+
+	for(size_t i = 0; i < len; i++)
+	{
+		out[i] = digits[len - 1 - i];
+	}
+	return len;
+}
+
+
+static void render2(char out[], uint32_t value)
+{
+	out[0] = '0' + (value / 10);
+	out[1] = '0' + (value % 10);
+}
+
+
+bool TextAppender::appendUint(uint32_t value)
+{
+	char digits[20];
+	return append(digits, renderUint(digits, value));
+}
+
+
+/**
+ *	Append a float with a fixed number of decimals, giving the same text as
+ *	printf("%.*f", decimals, value). The float is scaled exactly with integer
+ *	arithmetic, and rounded half to even, so no floating point code is used.
+ *	NaN and infinity are appended as null, as JSON has no representation
+ *	for them.
+ *	@param value - Value to append
+ *	@param decimals - Number of digits after the decimal point, up to
+ *	                  TextAppender::MAX_DECIMALS
+ *	@return
+ *		false - The text does not fit, decimals is too large, or value is
+ *		        too large to scale by 10^decimals in 64 bits
+ *		true - Success
+ */
+bool TextAppender::appendFixed(float value, uint8_t decimals)
+{
+	if(decimals > MAX_DECIMALS)
+	{
+		m_ok = false;
+		return false;
+	}
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof bits);
+	bool negative = 0 != (bits >> 31);
+	uint32_t exponent = (bits >> 23) & 0xFF;
+	uint64_t mantissa = bits & 0x7FFFFF;
+	if(0xFF == exponent)
+	{
+		return append("null", 4);
+	}
+
+	//value = mantissa * 2^shift
+	int32_t shift;
+	if(0 == exponent)
+	{
+		shift = -149;
+	}
+	else
+	{
+		mantissa |= 0x800000;
+		shift = static_cast<int32_t>(exponent) - 150;
+	}
+
+	//Below 2^54, as the mantissa has 24 bits and 10^9 is below 2^30
+	uint64_t scaled = mantissa * POW10[decimals];
+	if(shift >= 0)
+	{
+		if((shift > 63) || (0 != (scaled >> (63 - shift))))
+		{
+			m_ok = false;
+			return false;
+		}
+		scaled <<= shift;
+	}
+	else if(shift < -54)
+	{
+		scaled = 0;
+	}
+	else
+	{
+		uint64_t remainder = scaled & ((1ULL << -shift) - 1);
+		uint64_t half = 1ULL << (-shift - 1);
+		scaled >>= -shift;
+		if((remainder > half) || ((remainder == half) && (0 != (scaled & 1))))
+		{
+			scaled++;
+		}
+	}
+
+	//Sign, integer part, point, and fraction
+	char text[1 + 20 + 1 + MAX_DECIMALS];
+	size_t len = 0;
+	if(true == negative)
+	{
+		text[len++] = '-';
+	}
+	uint64_t integer;
+	uint32_t fraction;
+	if(scaled <= 0xFFFFFFFF)
+	{
+		integer = static_cast<uint32_t>(scaled) / POW10[decimals];
+		fraction = static_cast<uint32_t>(scaled) % POW10[decimals];
+	}
+	else
+	{
+		integer = scaled / POW10[decimals];
+		fraction = static_cast<uint32_t>(scaled % POW10[decimals]);
+	}
+	len += renderUint(&text[len], integer);
+	if(0 != decimals)
+	{
+		text[len++] = '.';
+		for(uint8_t i = decimals; i > 0; i--)
+		{
+			text[len + i - 1] = '0' + (fraction % 10);
+			fraction /= 10;
+		}
+		len += decimals;
+	}
+	return append(text, len);
+}
+
+
+ISO8601Timestamp::ISO8601Timestamp()
+{
+	memcpy(m_text, "1970-01-01T00:00:00Z", sizeof m_text);
+	m_day = NO_DAY;
+	m_hour = 0;
+	m_minute = 0;
+	m_second = 0;
+}
+
+
+/**
+ *	Set the time, re-rendering only the fields that changed
+ *	@param epoch_seconds - Seconds since the Unix epoch
+ */
+void ISO8601Timestamp::set(uint32_t epoch_seconds)
+{
+	uint32_t day = epoch_seconds / SECONDS_PER_DAY;
+	uint32_t time_of_day = epoch_seconds % SECONDS_PER_DAY;
+	uint8_t hour = time_of_day / 3600;
+	uint8_t minute = (time_of_day / 60) % 60;
+	uint8_t second = time_of_day % 60;
+
+	bool new_day = day != m_day;
+	if(true == new_day)
+	{
+		renderDate(day);
+		m_day = day;
+	}
+	if((true == new_day) || (hour != m_hour))
+	{
+		render2(&m_text[11], hour);
+		m_hour = hour;
+	}
+	if((true == new_day) || (minute != m_minute))
+	{
+		render2(&m_text[14], minute);
+		m_minute = minute;
+	}
+	if((true == new_day) || (second != m_second))
+	{
+		render2(&m_text[17], second);
+		m_second = second;
+	}
+}
+
+
+/**
+ *	Render the date from the number of days since the epoch, using the
+ *	proleptic Gregorian calendar in 400 year eras
+ */
+void ISO8601Timestamp::renderDate(uint32_t days)
+{
+	uint32_t z = days + 719468;
+	uint32_t era = z / 146097;
+	uint32_t day_of_era = z - (era * 146097);
+	uint32_t year_of_era = (
+		day_of_era -
+		(day_of_era / 1460) +
+		(day_of_era / 36524) -
+		(day_of_era / 146096)) / 365;
+	uint32_t day_of_year = day_of_era - (
+		(365 * year_of_era) +
+		(year_of_era / 4) -
+		(year_of_era / 100));
+	//Months counted from March, so the leap day is the last day of the year
+	uint32_t mp = ((5 * day_of_year) + 2) / 153;
+	uint32_t day = day_of_year - (((153 * mp) + 2) / 5) + 1;
+	uint32_t month = (mp < 10) ? (mp + 3) : (mp - 9);
+	uint32_t year = year_of_era + (era * 400) + ((month <= 2) ? 1 : 0);
+
+	render2(&m_text[0], year / 100);
+	render2(&m_text[2], year % 100);
+	render2(&m_text[5], month);
+	render2(&m_text[8], day);
+}
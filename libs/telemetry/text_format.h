@@ -0,0 +1,104 @@
+/**
+ * text_format.h
+ * Allocation free text formatting for the JSON reports, without printf.
+ * newlib's printf needs _printf_float linked in to format floats, which is
+ * large and takes thousands of cycles per call on the Cortex-M3.
+ */
+
+#ifndef TEXT_FORMAT_H
+#define TEXT_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+ *	Bounds checked append to a caller owned character buffer. Once an append
+ *	does not fit, every later append fails too, so a sequence of appends can
+ *	be checked once at the end with TextAppender::ok(). The buffer is not
+ *	null terminated.
+ */
+class TextAppender {
+	public:
+	static uint8_t constexpr MAX_DECIMALS = 9;
+
+	TextAppender(char buffer[], size_t size)
+	{
+		m_buffer = buffer;
+		m_size = size;
+		m_len = 0;
+		m_ok = true;
+	}
+
+	bool append(char const str[], size_t len)
+	{
+		if((false == m_ok) || (len > (m_size - m_len)))
+		{
+			m_ok = false;
+			return false;
+		}
+		memcpy(&m_buffer[m_len], str, len);
+		m_len += len;
+		return true;
+	}
+
+	bool append(char const *str)
+	{
+		return append(str, strlen(str));
+	}
+
+	bool append(char c)
+	{
+		return append(&c, 1);
+	}
+
+	bool appendUint(uint32_t value);
+	bool appendFixed(float value, uint8_t decimals);
+
+	size_t length()
+	{
+		return m_len;
+	}
+
+	bool ok()
+	{
+		return m_ok;
+	}
+
+	private:
+	char *m_buffer;
+	size_t m_size;
+	size_t m_len;
+	bool m_ok;
+};
+
+
+/**
+ *	ISO-8601 UTC timestamp, rendered as YYYY-MM-DDTHH:MM:SSZ.
+ *	Reports are taken seconds apart, so setting a time on the same day as the
+ *	previous one only re-renders the time of day fields that changed, and the
+ *	date is only converted from days since the epoch when the day changes.
+ */
+class ISO8601Timestamp {
+	public:
+	static size_t constexpr LENGTH = 20;
+
+	ISO8601Timestamp();
+	void set(uint32_t epoch_seconds);
+
+	char const *str()
+	{
+		return m_text;
+	}
+
+	private:
+	void renderDate(uint32_t days);
+
+	char m_text[LENGTH + 1];
+	uint32_t m_day;
+	uint8_t m_hour;
+	uint8_t m_minute;
+	uint8_t m_second;
+};
+
+#endif //TEXT_FORMAT_H
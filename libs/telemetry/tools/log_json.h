@@ -0,0 +1,185 @@
+/**
+ * log_json.h
+ * Load the report batches stored by the Sentinel backend in log.json, for
+ * the host tools. Only the shape of log.json is understood: an array of
+ * batches, each an array of flat report objects.
+ */
+
+#ifndef LOG_JSON_H
+#define LOG_JSON_H
+
+#include "json_report.h"
+#include "sentinel_report.h"
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <vector>
+
+typedef std::vector<SentinelReport> SentinelBatch;
+
+/**
+ *	Find the value of a key in a single report object
+ *	@return nullptr if the key is missing
+ */
+inline char const *logJSONValue(std::string const &record, char const *key)
+{
+	std::string quoted = std::string("\"") + key + "\"";
+	size_t pos = record.find(quoted);
+	if(std::string::npos == pos)
+	{
+		return nullptr;
+	}
+	pos = record.find(':', pos + quoted.size());
+	if(std::string::npos == pos)
+	{
+		return nullptr;
+	}
+	pos = record.find_first_not_of(" \t\r\n\"", pos + 1);
+	return (std::string::npos == pos) ? nullptr : &record[pos];
+}
+
+
+inline bool parseLogJSONRecord(std::string const &record, SentinelReport *report)
+{
+	char const *latitude = logJSONValue(record, "latitude");
+	char const *longitude = logJSONValue(record, "longitude");
+	char const *state = logJSONValue(record, "robotState");
+	char const *timestamp = logJSONValue(record, "timestamp");
+	char const *cnt = logJSONValue(record, "cnt");
+	if(
+		(nullptr == latitude) || (nullptr == longitude) ||
+		(nullptr == state) || (nullptr == timestamp) || (nullptr == cnt))
+	{
+		return false;
+	}
+	report->latitude = strtof(latitude, nullptr);
+	report->longitude = strtof(longitude, nullptr);
+	report->cnt = strtoul(cnt, nullptr, 10);
+
+	report->robot_state = SentinelReport::RobotState::ERROR;
+	for(uint8_t i = 0; i < SENTINEL_ROBOT_STATE_COUNT; i++)
+	{
+		size_t len = strlen(SENTINEL_ROBOT_STATE_NAMES[i]);
+		if(
+			(0 == strncmp(state, SENTINEL_ROBOT_STATE_NAMES[i], len)) &&
+			('"' == state[len]))
+		{
+			report->robot_state = static_cast<SentinelReport::RobotState>(i);
+		}
+	}
+
+	struct tm tm = {};
+	if(6 != sscanf(timestamp, "%d-%d-%dT%d:%d:%d",
+		&tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+		&tm.tm_hour, &tm.tm_min, &tm.tm_sec))
+	{
+		return false;
+	}
+	tm.tm_year -= 1900;
+	tm.tm_mon -= 1;
+	report->timestamp = timegm(&tm);
+	return true;
+}
+
+
+/**
+ *	Load every batch in a log.json file
+ *	@param device_id - Output - Device ID of the first report
+ *	@return
+ *		false - The file can't be read, or a report is malformed
+ *		true - Success
+ */
+inline bool loadLogJSON(
+	char const *path,
+	std::vector<SentinelBatch> *batches,
+	std::string *device_id)
+{
+	FILE *file = fopen(path, "rb");
+	if(nullptr == file)
+	{
+		return false;
+	}
+	std::string text;
+	char buf[4096];
+	size_t n;
+	while(0 != (n = fread(buf, 1, sizeof buf, file)))
+	{
+		text.append(buf, n);
+	}
+	fclose(file);
+
+	int depth = 0;
+	for(size_t i = 0; i < text.size(); i++)
+	{
+		switch(text[i])
+		{
+			case '[':
+			depth++;
+			if(2 == depth)
+			{
+				batches->push_back(SentinelBatch());
+			}
+			break;
+
+			case ']':
+			depth--;
+			break;
+
+			case '{':
+			{
+				size_t end = text.find('}', i);
+				if((2 != depth) || (std::string::npos == end))
+				{
+					return false;
+				}
+				std::string record = text.substr(i, end - i + 1);
+				SentinelReport report;
+				if(false == parseLogJSONRecord(record, &report))
+				{
+					return false;
+				}
+				if(device_id->empty())
+				{
+					char const *id = logJSONValue(record, "device_id");
+					if(nullptr != id)
+					{
+						*device_id = std::string(id, strcspn(id, "\""));
+					}
+				}
+				batches->back().push_back(report);
+				i = end;
+				break;
+			}
+
+			default:
+			break;
+		}
+	}
+	return true;
+}
+
+
+/**
+ *	Encode a batch in the JSON format sent by the firmware
+ *	@return Empty if the batch does not fit into a publish
+ */
+inline std::string encodeLogJSONBatch(
+	SentinelBatch const &batch,
+	std::string const &device_id)
+{
+	uint8_t buffer[4096];
+	SentinelJSONEncoder encoder;
+	encoder.begin(buffer, sizeof buffer, device_id.c_str());
+	for(SentinelReport const &report : batch)
+	{
+		if(false == encoder.add(report))
+		{
+			return std::string();
+		}
+	}
+	size_t len = encoder.finish();
+	return std::string(reinterpret_cast<char*>(buffer), len);
+}
+
+#endif //LOG_JSON_H
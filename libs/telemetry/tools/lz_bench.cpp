@@ -0,0 +1,136 @@
+/**
+ * lz_bench.cpp
+ * Host benchmark of LZCodec on the batches of log.json, encoded as the
+ * firmware sends them.
+ * Usage: lz_bench log.json
+ * Prints the compression ratio with and without the preset dictionary, and
+ * the time taken to compress a batch. Cycles are read from the time stamp
+ * counter on x86, so they are host cycles; expect the Cortex-M3 to take
+ * several times as many.
+ */
+
+#include "log_json.h"
+#include "lz_codec.h"
+#include "lz_dictionary.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+static uint64_t cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+
+/**
+ *	Compress every batch, check that it decompresses, and print the results
+ *	@return
+ *		false - A batch did not survive the round trip
+ *		true - Success
+ */
+static bool bench(
+	char const *name,
+	LZCodec *codec,
+	std::vector<std::string> const &batches)
+{
+	static size_t constexpr REPEAT = 16;
+	size_t raw_len = 0;
+	size_t compressed_len = 0;
+	size_t smallest = SIZE_MAX;
+	size_t largest = 0;
+	std::vector<uint64_t> batch_cycles;
+	for(std::string const &batch : batches)
+	{
+		uint8_t const *in = reinterpret_cast<uint8_t const*>(batch.data());
+		uint8_t compressed[2048];
+		size_t len = 0;
+		uint64_t best = UINT64_MAX;
+		for(size_t i = 0; i < REPEAT; i++)
+		{
+			uint64_t start = cycles();
+			len = codec->compress(in, batch.size(), compressed, sizeof compressed);
+			best = std::min(best, cycles() - start);
+		}
+		batch_cycles.push_back(best);
+
+		uint8_t out[2048];
+		size_t out_len = sizeof out;
+		if(
+			(0 == len) ||
+			(false == codec->decompress(compressed, len, out, &out_len)) ||
+			(std::string(reinterpret_cast<char*>(out), out_len) != batch))
+		{
+			fprintf(stderr, "%s: round trip failed\n", name);
+			return false;
+		}
+		raw_len += batch.size();
+		compressed_len += len;
+		smallest = std::min(smallest, len);
+		largest = std::max(largest, len);
+	}
+
+	std::sort(batch_cycles.begin(), batch_cycles.end());
+	uint64_t total_cycles = 0;
+	for(uint64_t c : batch_cycles)
+	{
+		total_cycles += c;
+	}
+	printf(
+		"%s: batches=%zu raw_bytes=%zu compressed_bytes=%zu ratio=%.2f "
+		"batch_bytes_min=%zu batch_bytes_max=%zu "
+		"cycles_per_batch_mean=%llu cycles_per_batch_median=%llu "
+		"cycles_per_byte=%.1f\n",
+		name,
+		batches.size(),
+		raw_len,
+		compressed_len,
+		static_cast<double>(raw_len) / compressed_len,
+		smallest,
+		largest,
+		static_cast<unsigned long long>(total_cycles / batch_cycles.size()),
+		static_cast<unsigned long long>(batch_cycles[batch_cycles.size() / 2]),
+		static_cast<double>(total_cycles) / raw_len);
+	return true;
+}
+
+
+int main(int argc, char *argv[])
+{
+	if(2 != argc)
+	{
+		fprintf(stderr, "Usage: %s log.json\n", argv[0]);
+		return -1;
+	}
+	std::vector<SentinelBatch> log;
+	std::string device_id;
+	if(false == loadLogJSON(argv[1], &log, &device_id))
+	{
+		fprintf(stderr, "%s: can't load\n", argv[1]);
+		return -1;
+	}
+	std::vector<std::string> batches;
+	for(SentinelBatch const &batch : log)
+	{
+		batches.push_back(encodeLogJSONBatch(batch, device_id));
+	}
+
+	LZCodec plain(nullptr, 0);
+	LZCodec dictionary(SENTINEL_LZ_DICTIONARY, sizeof SENTINEL_LZ_DICTIONARY);
+	if(
+		(false == bench("no_dictionary", &plain, batches)) ||
+		(false == bench("dictionary", &dictionary, batches)))
+	{
+		return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,159 @@
+/**
+ * lz_train.cpp
+ * Host tool to train the preset dictionary of LZCodec on log.json.
+ * Usage: lz_train [-s dictionary_size] log.json > ../lz_dictionary.h
+ *
+ * The batches are encoded as the firmware sends them, and the dictionary is
+ * built from the segments of the encoded batches that cover the most
+ * frequent k-mers. A k-mer is counted once per batch, so text repeated in
+ * every batch, like the keys and the device ID, wins over text repeated
+ * within a single batch, which LZCodec finds without help.
+ */
+
+#include "log_json.h"
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+static size_t constexpr KMER_LEN = 6;
+static size_t constexpr SEGMENT_LEN = 64;
+static size_t constexpr DEFAULT_DICTIONARY_SIZE = 128;
+
+static uint64_t kmerAt(std::string const &text, size_t pos)
+{
+	uint64_t kmer = 0;
+	memcpy(&kmer, &text[pos], KMER_LEN);
+	return kmer;
+}
+
+
+int main(int argc, char *argv[])
+{
+	size_t dictionary_size = DEFAULT_DICTIONARY_SIZE;
+	int first = 1;
+	if((argc > 2) && (std::string("-s") == argv[1]))
+	{
+		dictionary_size = strtoul(argv[2], nullptr, 10);
+		first = 3;
+	}
+	if((first + 1) != argc)
+	{
+		fprintf(stderr, "Usage: %s [-s dictionary_size] log.json\n", argv[0]);
+		return -1;
+	}
+
+	std::vector<SentinelBatch> batches;
+	std::string device_id;
+	if(false == loadLogJSON(argv[first], &batches, &device_id))
+	{
+		fprintf(stderr, "%s: can't load\n", argv[first]);
+		return -1;
+	}
+
+	//Document frequency of every k-mer, and the k-mer at every position of
+	//	the corpus
+	std::string corpus;
+	std::vector<size_t> batch_ends;
+	for(SentinelBatch const &batch : batches)
+	{
+		corpus += encodeLogJSONBatch(batch, device_id);
+		batch_ends.push_back(corpus.size());
+	}
+	std::unordered_map<uint64_t, uint32_t> kmer_ids;
+	std::vector<uint32_t> frequency;
+	std::vector<uint32_t> ids(corpus.size(), 0);
+	size_t batch_start = 0;
+	for(size_t end : batch_ends)
+	{
+		std::unordered_set<uint32_t> seen;
+		for(size_t pos = batch_start; (pos + KMER_LEN) <= end; pos++)
+		{
+			auto inserted = kmer_ids.emplace(kmerAt(corpus, pos), frequency.size());
+			if(true == inserted.second)
+			{
+				frequency.push_back(0);
+			}
+			ids[pos] = inserted.first->second;
+			if(true == seen.insert(ids[pos]).second)
+			{
+				frequency[ids[pos]]++;
+			}
+		}
+		batch_start = end;
+	}
+
+	//Greedily take the segment covering the most frequent k-mers not already
+	//	in the dictionary
+	std::vector<std::string> segments;
+	size_t len = 0;
+	size_t window = SEGMENT_LEN - KMER_LEN + 1;
+	while(((len + SEGMENT_LEN) <= dictionary_size) && (corpus.size() > SEGMENT_LEN))
+	{
+		uint64_t score = 0;
+		for(size_t i = 0; i < window; i++)
+		{
+			score += frequency[ids[i]];
+		}
+		uint64_t best_score = score;
+		size_t best = 0;
+		for(size_t pos = 1; (pos + SEGMENT_LEN) <= corpus.size(); pos++)
+		{
+			score -= frequency[ids[pos - 1]];
+			score += frequency[ids[pos + window - 1]];
+			if(score > best_score)
+			{
+				best_score = score;
+				best = pos;
+			}
+		}
+		if(0 == best_score)
+		{
+			break;
+		}
+		for(size_t i = 0; i < window; i++)
+		{
+			frequency[ids[best + i]] = 0;
+		}
+		segments.push_back(corpus.substr(best, SEGMENT_LEN));
+		len += SEGMENT_LEN;
+	}
+
+	//The most valuable segments go last, closest to the message
+	std::string dictionary;
+	for(auto segment = segments.rbegin(); segment != segments.rend(); segment++)
+	{
+		dictionary += *segment;
+	}
+
+	printf(
+		"/**\n"
+		" * lz_dictionary.h\n"
+		" * Preset dictionary for LZCodec, generated from log.json by\n"
+		" * tools/lz_train. Do not edit.\n"
+		" * Changing the dictionary changes the compressed format; the\n"
+		" * decompressor must use the same dictionary as the firmware.\n"
+		" */\n"
+		"\n"
+		"#ifndef LZ_DICTIONARY_H\n"
+		"#define LZ_DICTIONARY_H\n"
+		"\n"
+		"#include <cstdint>\n"
+		"\n"
+		"static uint8_t const SENTINEL_LZ_DICTIONARY[] = {");
+	for(size_t i = 0; i < dictionary.size(); i++)
+	{
+		printf(
+			"%s0x%02X,",
+			(0 == (i % 12)) ? "\n\t" : " ",
+			static_cast<uint8_t>(dictionary[i]));
+	}
+	printf(
+		"\n"
+		"};\n"
+		"\n"
+		"#endif //LZ_DICTIONARY_H\n");
+	return 0;
+}
@@ -0,0 +1,213 @@
+/**
+ * telemetry_decode.cpp
+ * Host tool to turn encoded Sentinel report batches back into JSON, in the
+ * same shape as the records in log.json.
+ * Usage: telemetry_decode [-z] [-f cbor|delta|json] batch_file...
+ * -z decompresses each batch with LZCodec and the preset dictionary first.
+ * Each batch file holds the payload of one publish. The output is an array
+ * with one array of records per batch.
+ */
+
+#include "cbor_report.h"
+#include "delta_report.h"
+#include "log_json.h"
+#include "lz_codec.h"
+#include "lz_dictionary.h"
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <vector>
+
+static bool readFile(char const *path, std::vector<uint8_t> *data)
+{
+	FILE *file = fopen(path, "rb");
+	if(nullptr == file)
+	{
+		return false;
+	}
+	uint8_t buf[512];
+	size_t n;
+	while(0 != (n = fread(buf, 1, sizeof buf, file)))
+	{
+		data->insert(data->end(), buf, buf + n);
+	}
+	fclose(file);
+	return true;
+}
+
+
+static void printRecord(
+	char const *device_id,
+	SentinelReport const &report,
+	bool last)
+{
+	char timestamp[32];
+	time_t t = report.timestamp;
+	struct tm tm;
+	gmtime_r(&t, &tm);
+	strftime(timestamp, sizeof timestamp, "%Y-%m-%dT%H:%M:%SZ", &tm);
+	char const *state = report.robotStateName();
+	printf(
+		"    {\n"
+		"      \"device_id\": \"%s\",\n"
+		"      \"latitude\": %f,\n"
+		"      \"longitude\": %f,\n"
+		"      \"robotState\": \"%s\",\n"
+		"      \"timestamp\": \"%s\",\n"
+		"      \"cnt\": %u\n"
+		"    }%s\n",
+		device_id,
+		report.latitude,
+		report.longitude,
+		(nullptr != state) ? state : "Unknown",
+		timestamp,
+		report.cnt,
+		last ? "" : ",");
+}
+
+
+template<class Decoder>
+static bool decodeBatch(std::vector<uint8_t> const &data)
+{
+	Decoder decoder(data.data(), data.size());
+	char device_id[64];
+	if(false == decoder.deviceID(device_id, sizeof device_id))
+	{
+		return false;
+	}
+	std::vector<SentinelReport> reports;
+	SentinelReport report;
+	while(true == decoder.next(&report))
+	{
+		reports.push_back(report);
+	}
+	if(false == decoder.isValid())
+	{
+		return false;
+	}
+	for(size_t i = 0; i < reports.size(); i++)
+	{
+		printRecord(device_id, reports[i], (i + 1) == reports.size());
+	}
+	return true;
+}
+
+
+static bool decodeJSON(std::vector<uint8_t> const &data)
+{
+	std::string text(data.begin(), data.end());
+	std::vector<std::string> records;
+	for(size_t pos = text.find('{'); std::string::npos != pos; pos = text.find('{', pos))
+	{
+		size_t end = text.find('}', pos);
+		if(std::string::npos == end)
+		{
+			return false;
+		}
+		records.push_back(text.substr(pos, end - pos + 1));
+		pos = end;
+	}
+	for(size_t i = 0; i < records.size(); i++)
+	{
+		SentinelReport report;
+		char const *id = logJSONValue(records[i], "device_id");
+		if((nullptr == id) || (false == parseLogJSONRecord(records[i], &report)))
+		{
+			return false;
+		}
+		std::string device_id(id, strcspn(id, "\""));
+		printRecord(device_id.c_str(), report, (i + 1) == records.size());
+	}
+	return true;
+}
+
+
+static bool decompress(std::vector<uint8_t> *data)
+{
+	static LZCodec codec(SENTINEL_LZ_DICTIONARY, sizeof SENTINEL_LZ_DICTIONARY);
+	std::vector<uint8_t> out(LZCodec::MAX_OFFSET);
+	size_t out_len = out.size();
+	if(false == codec.decompress(data->data(), data->size(), out.data(), &out_len))
+	{
+		return false;
+	}
+	out.resize(out_len);
+	data->swap(out);
+	return true;
+}
+
+
+int main(int argc, char *argv[])
+{
+	std::string format = "cbor";
+	bool compressed = false;
+	int first = 1;
+	while(first < argc)
+	{
+		if(std::string("-z") == argv[first])
+		{
+			compressed = true;
+			first++;
+		}
+		else if(((first + 1) < argc) && (std::string("-f") == argv[first]))
+		{
+			format = argv[first + 1];
+			first += 2;
+		}
+		else
+		{
+			break;
+		}
+	}
+	if(first >= argc)
+	{
+		fprintf(
+			stderr,
+			"Usage: %s [-z] [-f cbor|delta|json] batch_file...\n",
+			argv[0]);
+		return -1;
+	}
+
+	printf("[\n");
+	for(int i = first; i < argc; i++)
+	{
+		std::vector<uint8_t> data;
+		if(false == readFile(argv[i], &data))
+		{
+			fprintf(stderr, "%s: can't read\n", argv[i]);
+			return -1;
+		}
+		if((true == compressed) && (false == decompress(&data)))
+		{
+			fprintf(stderr, "%s: malformed compressed batch\n", argv[i]);
+			return -1;
+		}
+		printf("  [\n");
+		bool ok = false;
+		if("cbor" == format)
+		{
+			ok = decodeBatch<SentinelCBORDecoder>(data);
+		}
+		else if("delta" == format)
+		{
+			ok = decodeBatch<SentinelDeltaDecoder>(data);
+		}
+		else if("json" == format)
+		{
+			ok = decodeJSON(data);
+		}
+		else
+		{
+			fprintf(stderr, "Unknown format %s\n", format.c_str());
+			return -1;
+		}
+		if(false == ok)
+		{
+			fprintf(stderr, "%s: malformed %s batch\n", argv[i], format.c_str());
+			return -1;
+		}
+		printf("  ]%s\n", ((i + 1) == argc) ? "" : ",");
+	}
+	printf("]\n");
+	return 0;
+}
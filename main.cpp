@@ -3,11 +3,43 @@
 #include "gb4mqtt.h"
 //#include "gb4xbee.h"
 #include "MQTTPacket.h"
+#include "cbor_report.h"
+#include "delta_report.h"
+#include "json_report.h"
+#include "lz_dictionary.h"
+#include "report_filter.h"
+#include "report_history.h"
+#include "sam3x_flash_region.h"
+#include "stack_monitor.h"
+#include "telemetry_batcher.h"
 #include <cstdio>
 #include <ctime>
 #include <sys/time.h>
 
 #define SENTINEL_DESTINATION
+//Define one to send reports CBOR or delta encoded instead of as JSON.
+//	See cbor_report.h, delta_report.h and json_report.h
+//#define SENTINEL_CBOR_REPORTS
+//#define SENTINEL_DELTA_REPORTS
+//Define to compress the batches with LZCodec and the preset dictionary
+//	trained on log.json. See lz_codec.h
+//#define SENTINEL_COMPRESS_REPORTS
+
+//Reports kept in RAM while they can't be batched, thinned out once it fills
+//	up. See report_history.h
+#define SENTINEL_HISTORY_SIZE 256
+
+#if defined(SENTINEL_DELTA_REPORTS)
+typedef SentinelDeltaEncoder SentinelEncoder;
+#elif defined(SENTINEL_CBOR_REPORTS)
+typedef SentinelCBOREncoder SentinelEncoder;
+#else
+typedef SentinelJSONEncoder SentinelEncoder;
+#endif
+typedef TelemetryBatcher<
+	SentinelEncoder,
+	MQTTRequest::MESSAGE_MAX_SIZE,
+	GB4MQTT> SentinelBatcher;
 
 #ifdef SENTINEL_DESTINATION
 char constexpr client_id[] = "tonitrus";
@@ -26,10 +58,66 @@ char constexpr password[] = "";
 char constexpr topic[] = "hello";
 #endif //BRIDGE_DESTINATION
 
+#ifdef SENTINEL_DESTINATION
+/**
+ *	Publish a single report on its own as an alarm, ahead of any batches
+ *	waiting to be published
+ *	@param codec - Codec the batches are compressed with, or nullptr
+ *	@return
+ *		true - The alarm was queued
+ *		false - The alarm could not be encoded, or was refused by GB4MQTT
+ */
+static bool publishAlarm(
+	GB4MQTT &mqtt,
+	uint8_t topic_id,
+	SentinelReport const &report,
+	LZCodec *codec)
+{
+	static size_t constexpr ALARM_MAX_SIZE = 192;
+	uint8_t encoded[ALARM_MAX_SIZE];
+	uint8_t compressed[LZCodec::maxCompressedLength(ALARM_MAX_SIZE)];
+	SentinelEncoder encoder;
+	if(
+		(false == encoder.begin(encoded, sizeof encoded, client_id)) ||
+		(false == encoder.add(report)))
+	{
+		return false;
+	}
+	uint8_t *alarm = encoded;
+	size_t alarm_len = encoder.finish();
+	if(nullptr != codec)
+	{
+		alarm = compressed;
+		alarm_len = codec->compress(
+			encoded,
+			alarm_len,
+			compressed,
+			sizeof compressed);
+		if(0 == alarm_len)
+		{
+			return false;
+		}
+	}
+	GB4MQTT::Return status = mqtt.publish(
+		topic_id,
+		alarm,
+		alarm_len,
+		1,
+		true,
+		MQTTPriority::ALARM);
+	return
+		(GB4MQTT::Return::PUBLISH_QUEUED == status) ||
+		(GB4MQTT::Return::PUBLISH_STORED == status);
+}
+#endif //SENTINEL_DESTINATION
+
 int main()
 {
 	init();
 	watchdogDisable();
+	//Before anything else takes up stack. The deepest it has grown can be
+	//	read with the stack command in gdb
+	g_stack.paint();
 
 	pinMode(LED_BUILTIN, OUTPUT);
 	digitalWrite(LED_BUILTIN, LOW);
@@ -47,6 +135,8 @@ int main()
 	Serial.setTimeout(10000);
 
 	mqtt.begin();
+	uint8_t topic_id;
+	mqtt.registerTopic(topic, sizeof topic, &topic_id);
 	
 	char const compile_time[22] = __DATE__ " " __TIME__;
 	char const mon[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
@@ -71,49 +161,98 @@ int main()
 		snprintf(reinterpret_cast<char*>(&cnt_s[i * 3]), 3, " 02X", i * 3); 
 	}
 	size_t cnt_len = sizeof cnt_s;	
+	//Only the latest count is of interest, so a count that is still waiting
+	//	for the session is replaced rather than queued behind
+	mqtt.setCoalescing(topic_id, true);
 #endif //BRIDGE_DESTINATION	
 
+	//Keep the session open between consecutive batches, and have it ready
+	//	ahead of the first one
+	static int32_t constexpr report_interval = 10000;
+	static int32_t constexpr publish_interval = 6 * report_interval;
+	static int32_t constexpr prewarm_interval = 20000;
+	mqtt.setLinger(publish_interval + report_interval);
+	mqtt.setPrewarm(prewarm_interval);
+	//Guard the data plan against a runaway publish loop. Routine publishes
+	//	get about twice the rate of one full batch a minute, and alarms a
+	//	handful an hour
+	mqtt.setBudget(MQTTPriority::NORMAL, 8192, 128 * 1024, 8, 120);
+	mqtt.setBudget(MQTTPriority::ALARM, 2048, 4096, 4, 12);
+	//Keep the publishes that don't fit into the queues while the link is
+	//	down in the upper flash bank, rather than refusing them
+	static SAM3XFlashRegion store_region;
+	static FlashQueue store(store_region);
+	if(FlashQueue::Return::READY == store.begin())
+	{
+		mqtt.setStore(&store);
+	}
+
 	int delay_start = millis();
 #ifdef SENTINEL_DESTINATION
 	float lat = 15.0;
 	float lon = 30.0;
-	static size_t constexpr report_size = 150;
-	static size_t constexpr number_of_reports = 6;
-	static size_t constexpr report_buffer_size = 
-		report_size * number_of_reports;
-	uint8_t cnt_s[report_buffer_size] = "[";
-	size_t report_index = 1;
-
-//	mqtt.publish(topic, sizeof topic, cnt_s + 1, report_size * 4, true);
+	//Publish a batch half a report interval after its 6th report, or as soon
+	//	as the next report doesn't fit into it
+	static int32_t constexpr batch_max_age =
+		publish_interval - (report_interval / 2);
+	static SentinelBatcher batcher(mqtt, topic_id, client_id, batch_max_age);
+	static SentinelReportHistory<SENTINEL_HISTORY_SIZE> history;
+	//Batches that could never be published, and were dropped. Read it in gdb
+	static uint32_t dropped_batches = 0;
+#ifdef SENTINEL_COMPRESS_REPORTS
+	static LZCodec codec(SENTINEL_LZ_DICTIONARY, sizeof SENTINEL_LZ_DICTIONARY);
+	static uint8_t encode_buffer[MQTTRequest::MESSAGE_MAX_SIZE];
+	batcher.setCompressor(&codec, encode_buffer, sizeof encode_buffer);
+	LZCodec *alarm_codec = &codec;
+#else
+	LZCodec *alarm_codec = nullptr;
+#endif //SENTINEL_COMPRESS_REPORTS
+	//An error is raised as an alarm once when the robot enters the state,
+	//	and the report is batched as usual as well
+	bool alarm_raised = false;
+	//Only send a report when the robot moved, changed state, or has been
+	//	quiet for the heartbeat interval. cnt still counts every report.
+	static float constexpr min_report_distance = 25.0f;
+	static uint32_t constexpr heartbeat_interval = 300;
+	SentinelReportFilter filter(min_report_distance, heartbeat_interval);
+#else
+	mqtt.schedulePublish(publish_interval);
 #endif //SENTINEL_DESTINATION
 	for(uint32_t cnt = 0, objnum = 0;;)
 	{	
-		if((millis() - delay_start) > 10000)
+		if((millis() - delay_start) > report_interval)
 		{
 			delay_start = millis();
 #ifdef SENTINEL_DESTINATION
-			
-			char t_buf[32];
 			time_t now = epoch + (delay_start / 1000);
-			size_t t_buf_len = strftime(
-				t_buf, 32,
-				"%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
-			report_index += snprintf(
-				reinterpret_cast<char*>(&cnt_s[report_index]), report_size,
-			 	"{"
-			 		"\"device_id\":\"%s\","
-			 		"\"latitude\":%f,"
-			 		"\"longitude\":%f,"
-			 		"\"robotState\":\"Error\","
-			 		"\"timestamp\":\"%.*s\","
-					"\"cnt\":%d"
-			 	"}%c",
-				client_id,
-				lat,
-				lon,
-				32, t_buf,
-				objnum,
-				cnt < 5 ? ',' : ']');
+			SentinelReport report;
+			report.latitude = lat;
+			report.longitude = lon;
+			report.robot_state = SentinelReport::RobotState::ERROR;
+			report.timestamp = now;
+			report.cnt = objnum;
+			alarm_raised =
+				(SentinelReport::RobotState::ERROR == report.robot_state) &&
+				(
+					(true == alarm_raised) ||
+					(true == publishAlarm(mqtt, topic_id, report, alarm_codec)));
+			//A report the batcher can't take waits in the history, and so
+			//	does every report after it, until the link is back
+			if(true == filter.accept(report))
+			{
+				SentinelBatcher::Return status =
+					SentinelBatcher::Return::BUFFER_BUSY;
+				if(true == history.isEmpty())
+				{
+					status = batcher.add(report);
+				}
+				if(
+					(SentinelBatcher::Return::BUFFER_BUSY == status) ||
+					(SentinelBatcher::Return::PUBLISH_ERROR == status))
+				{
+					history.add(report);
+				}
+			}
 			lat += 0.1;
 			lon -= 0.05;
 #endif //SENTINEL_DESTINATION
@@ -121,15 +260,30 @@ int main()
 			objnum++;
 		}
 
+#ifdef SENTINEL_DESTINATION
+		//A batch GB4MQTT refuses for now stays in the batcher, and is
+		//	offered again here. Until it is taken, the history keeps the
+		//	reports after it
+		SentinelBatcher::Return batch_status = batcher.poll();
+		if(SentinelBatcher::Return::PUBLISH_ERROR == batch_status)
+		{
+			dropped_batches++;
+		}
+		if(
+			(SentinelBatcher::Return::BUFFER_BUSY != batch_status) &&
+			(true == mqtt.isReady()))
+		{
+			history.drain(batcher);
+		}
+#endif //SENTINEL_DESTINATION
+#ifdef BRIDGE_DESTINATION
 		if(6 == cnt)
 		{
 			cnt = 0;
-#ifdef SENTINEL_DESTINATION
-			size_t cnt_len = report_index; 
-			report_index = 1;
-#endif //SENTINEL_DESTINATION
-			mqtt.publish(topic, sizeof topic, cnt_s, cnt_len, 1, true);
+			mqtt.publish(topic_id, cnt_s, cnt_len, 1, true);
+			mqtt.schedulePublish(publish_interval);
 		}
+#endif //BRIDGE_DESTINATION
 	
 		mqtt.poll();
 	}
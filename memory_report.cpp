@@ -0,0 +1,41 @@
+/**
+ * memory_report.cpp
+ * Sizes of the classes that hold most of the RAM, as built for the target.
+ * This file is compiled, but never linked into the firmware. Each class gets
+ * an array of its own size, and memory_report.sh reads the sizes of the
+ * arrays from the object file, so no code has to run on the target.
+ * See make memory_report
+ */
+
+#include "gb4mqtt.h"
+#include "json_report.h"
+#include "report_history.h"
+#include "sam3x_flash_region.h"
+#include "stack_monitor.h"
+#include "telemetry_batcher.h"
+
+//As main.cpp has them with its default settings
+typedef TelemetryBatcher<
+	SentinelJSONEncoder,
+	MQTTRequest::MESSAGE_MAX_SIZE,
+	GB4MQTT> SentinelBatcher;
+typedef SentinelReportHistory<256> SentinelHistory;
+typedef StaticQueue<MQTTRequest, GB4MQTT_MAX_QUEUE_DEPTH> PublishQueue;
+
+#define REPORT_SIZE(type) uint8_t memory_report_##type[sizeof(type)]
+
+REPORT_SIZE(GB4MQTT);
+REPORT_SIZE(GB4XBee);
+REPORT_SIZE(MQTTRequest);
+REPORT_SIZE(MQTTTopicRegistry);
+REPORT_SIZE(PublishQueue);
+REPORT_SIZE(GB4MQTTPayloadPool);
+REPORT_SIZE(TokenBucket);
+REPORT_SIZE(XBeeNotify);
+REPORT_SIZE(XBeeReceive);
+REPORT_SIZE(FlashQueue);
+REPORT_SIZE(SAM3XFlashRegion);
+REPORT_SIZE(SentinelBatcher);
+REPORT_SIZE(SentinelHistory);
+REPORT_SIZE(SentinelReport);
+REPORT_SIZE(StackMonitor);
@@ -0,0 +1,45 @@
+#!/bin/bash
+#Print the stack used by each function, the static RAM of each object, and
+#	the size of the main classes of the firmware. Run by make memory_report
+#	$1 - Build directory, holding the .su files written by -fstack-usage
+#	$2 - Firmware ELF file
+#	$3 - memory_report.o. See memory_report.cpp
+
+BUILD_DIR=$1
+ELF=$2
+SIZES=$3
+NM=${NM:-arm-none-eabi-nm}
+SIZE=${SIZE:-arm-none-eabi-size}
+#Lines of each list printed
+TOP=${TOP:-30}
+#SRAM0 and SRAM1 of the SAM3X8E, which are contiguous
+RAM_SIZE=98304
+
+echo "Stack frame of each function, largest first"
+echo "   bytes  qualifier        function"
+find $BUILD_DIR -name '*.su' -exec cat {} + | \
+	sort -t $'\t' -k 2 -n -r | \
+	head -n $TOP | \
+	awk -F '\t' '{printf "%8d  %-15s  %s\n", $2, $3, $1}'
+echo "Frames marked dynamic also use a variable amount, and those marked"
+echo "bounded use at most the amount shown"
+echo
+
+echo "Static RAM of each object, largest first"
+echo "   bytes  object"
+$NM --print-size --size-sort --reverse-sort --radix=d --demangle $ELF | \
+	awk '$3 ~ /^[bBdD]$/ {name = $0; sub(/^[^ ]+ [^ ]+ [^ ]+ /, "", name); \
+		printf "%8d  %s\n", $2, name}' | \
+	head -n $TOP
+echo
+
+echo "Size of each class"
+echo "   bytes  class"
+$NM --print-size --size-sort --reverse-sort --radix=d $SIZES | \
+	awk '$4 ~ /^memory_report_/ {sub(/^memory_report_/, "", $4); \
+		printf "%8d  %s\n", $2, $4}'
+echo
+
+$SIZE $ELF | awk -v ram=$RAM_SIZE 'NR == 2 { \
+	printf "Static RAM: %d bytes (data %d, bss %d)\n", $2 + $3, $2, $3; \
+	printf "Left for the heap and the stack: %d bytes\n", ram - $2 - $3}'
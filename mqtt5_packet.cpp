@@ -0,0 +1,356 @@
+/**
+ * mqtt5_packet.cpp
+ */
+
+#include "mqtt5_packet.h"
+
+/**
+ *	Number of bytes needed to encode a value as a variable byte integer
+ */
+static int varintLength(int value)
+{
+	int len = 1;
+	for(; value >= 128; value /= 128)
+	{
+		len++;
+	}
+	return len;
+}
+
+
+static void writeUint16(uint8_t **ptr, uint16_t value)
+{
+	*(*ptr)++ = static_cast<uint8_t>(value >> 8);
+	*(*ptr)++ = static_cast<uint8_t>(value & 0xFF);
+}
+
+
+static void writeUint32(uint8_t **ptr, uint32_t value)
+{
+	writeUint16(ptr, static_cast<uint16_t>(value >> 16));
+	writeUint16(ptr, static_cast<uint16_t>(value & 0xFFFF));
+}
+
+
+static uint16_t readUint16(uint8_t const *ptr)
+{
+	return (static_cast<uint16_t>(ptr[0]) << 8) | ptr[1];
+}
+
+
+static uint32_t readUint32(uint8_t const *ptr)
+{
+	return (static_cast<uint32_t>(readUint16(ptr)) << 16) | readUint16(&ptr[2]);
+}
+
+
+/**
+ *	Decode a variable byte integer, without reading past the end of a buffer
+ *	@param ptr - Input - The first byte of the integer
+ *	@param end - End of the buffer
+ *	@param value - Output - The decoded integer
+ *	@return
+ *		-1 if the integer runs past end, or is longer than 4 bytes
+ *		Otherwise, the length of the integer in bytes
+ */
+static int decodeVarint(uint8_t const *ptr, uint8_t const *end, int *value)
+{
+	*value = 0;
+	int multiplier = 1;
+	for(int len = 1; len <= 4; len++, ptr++)
+	{
+		if(ptr >= end)
+		{
+			return -1;
+		}
+		*value += (*ptr & 0x7F) * multiplier;
+		if(0 == (*ptr & 0x80))
+		{
+			return len;
+		}
+		multiplier *= 128;
+	}
+	return -1;
+}
+
+
+/**
+ *	Find the length of a property value, so that properties GB4MQTT does not
+ *	care about can be skipped. Length prefixes are only read if they lie
+ *	before end.
+ *	@param id - Property identifier
+ *	@param value - Input - The property value following the identifier
+ *	@param end - End of the properties
+ *	@return
+ *		-1 if the identifier is unknown, or the value runs past end
+ *		Otherwise, the length of the property value in bytes
+ */
+static int propertyLength(uint8_t id, uint8_t const *value, uint8_t const *end)
+{
+	int len = -1;
+	switch(id)
+	{
+		case 0x01: case 0x17: case 0x19: case 0x24:
+		case 0x25: case 0x28: case 0x29: case 0x2A:
+		len = 1;
+		break;
+
+		case 0x13: case 0x21: case 0x22: case 0x23:
+		len = 2;
+		break;
+
+		case 0x02: case 0x11: case 0x18: case 0x27:
+		len = 4;
+		break;
+
+		case 0x0B:
+		{
+			int subscription_id;
+			len = decodeVarint(value, end, &subscription_id);
+		}
+		break;
+
+		case 0x03: case 0x08: case 0x09: case 0x12: case 0x15:
+		case 0x16: case 0x1A: case 0x1C: case 0x1F:
+		if((end - value) >= 2)
+		{
+			len = 2 + readUint16(value);
+		}
+		break;
+
+		case 0x26:
+		if((end - value) >= 2)
+		{
+			int key_len = 2 + readUint16(value);
+			if((end - value) >= (key_len + 2))
+			{
+				len = key_len + 2 + readUint16(&value[key_len]);
+			}
+		}
+		break;
+
+		default:
+		break;
+	}
+	if((len < 0) || (len > (end - value)))
+	{
+		return -1;
+	}
+	return len;
+}
+
+
+/**
+ *	Serialize an MQTT 5 CONNECT packet
+ *	@param buf - Output - Buffer to serialize the packet into
+ *	@param buflen - Size of buf in bytes
+ *	@param options - Client ID, credentials, keepalive, and clean start, as
+ *	                 used by MQTTSerialize_connect(). Will options are not
+ *	                 supported.
+ *	@param properties - CONNECT properties. Properties set to 0 are omitted
+ *	@return
+ *		MQTTPACKET_BUFFER_TOO_SHORT - The packet does not fit into buf
+ *		Otherwise, the length of the packet in bytes
+ */
+int MQTTV5Serialize_connect(
+	uint8_t buf[],
+	int buflen,
+	MQTTPacket_connectData const *options,
+	MQTTV5ConnectProperties const *properties)
+{
+	bool has_username =
+		(nullptr != options->username.cstring) ||
+		(nullptr != options->username.lenstring.data);
+	bool has_password =
+		(nullptr != options->password.cstring) ||
+		(nullptr != options->password.lenstring.data);
+
+	int properties_len = 0;
+	if(0 != properties->receive_maximum)
+	{
+		properties_len += 3;
+	}
+	if(0 != properties->maximum_packet_size)
+	{
+		properties_len += 5;
+	}
+
+	//Protocol name (6) + protocol version (1) + connect flags (1) + keepalive (2)
+	int remaining_len = 10;
+	remaining_len += varintLength(properties_len) + properties_len;
+	remaining_len += MQTTstrlen(options->clientID) + 2;
+	if(true == has_username)
+	{
+		remaining_len += MQTTstrlen(options->username) + 2;
+	}
+	if(true == has_password)
+	{
+		remaining_len += MQTTstrlen(options->password) + 2;
+	}
+	if(MQTTPacket_len(remaining_len) > buflen)
+	{
+		return MQTTPACKET_BUFFER_TOO_SHORT;
+	}
+
+	uint8_t *ptr = buf;
+	*ptr++ = CONNECT << 4;
+	ptr += MQTTPacket_encode(ptr, remaining_len);
+	writeCString(&ptr, "MQTT");
+	*ptr++ = MQTTV5_PROTOCOL_VERSION;
+	*ptr++ =
+		((true == has_username) ? 0x80 : 0x00) |
+		((true == has_password) ? 0x40 : 0x00) |
+		((0 != options->cleansession) ? 0x02 : 0x00);
+	writeUint16(&ptr, options->keepAliveInterval);
+
+	ptr += MQTTPacket_encode(ptr, properties_len);
+	if(0 != properties->receive_maximum)
+	{
+		*ptr++ = static_cast<uint8_t>(MQTTV5Property::RECEIVE_MAXIMUM);
+		writeUint16(&ptr, properties->receive_maximum);
+	}
+	if(0 != properties->maximum_packet_size)
+	{
+		*ptr++ = static_cast<uint8_t>(MQTTV5Property::MAXIMUM_PACKET_SIZE);
+		writeUint32(&ptr, properties->maximum_packet_size);
+	}
+
+	writeMQTTString(&ptr, options->clientID);
+	if(true == has_username)
+	{
+		writeMQTTString(&ptr, options->username);
+	}
+	if(true == has_password)
+	{
+		writeMQTTString(&ptr, options->password);
+	}
+	return ptr - buf;
+}
+
+
+/**
+ *	Deserialize an MQTT 5 CONNACK packet
+ *	@param session_present - Output - Session present flag
+ *	@param reason_code - Output - CONNACK reason code. 0 is success, and
+ *	                     values of 0x80 and above are failures
+ *	@param properties - Output - Properties sent by the broker. Properties the
+ *	                    broker omitted keep their default values
+ *	@param buf - Input - Received packet
+ *	@param buflen - Length of buf in bytes
+ *	@return
+ *		0 - The packet is not a CONNACK, or is malformed or truncated
+ *		1 - Success
+ */
+int MQTTV5Deserialize_connack(
+	uint8_t *session_present,
+	uint8_t *reason_code,
+	MQTTV5ConnackProperties *properties,
+	uint8_t const buf[],
+	int buflen)
+{
+	uint8_t const *ptr = buf;
+	uint8_t const *buf_end = buf + buflen;
+	if((buflen < 4) || (CONNACK != (*ptr++ >> 4)))
+	{
+		return 0;
+	}
+	int remaining_len;
+	int varint_len = decodeVarint(ptr, buf_end, &remaining_len);
+	if(varint_len < 0)
+	{
+		return 0;
+	}
+	ptr += varint_len;
+	if((remaining_len < 2) || (remaining_len > (buf_end - ptr)))
+	{
+		return 0;
+	}
+	uint8_t const *end = ptr + remaining_len;
+
+	*session_present = *ptr++ & 0x01;
+	*reason_code = *ptr++;
+	*properties = MQTTV5ConnackProperties();
+	if(ptr >= end)
+	{
+		return 1;
+	}
+
+	int properties_len;
+	varint_len = decodeVarint(ptr, end, &properties_len);
+	if(varint_len < 0)
+	{
+		return 0;
+	}
+	ptr += varint_len;
+	if(properties_len > (end - ptr))
+	{
+		return 0;
+	}
+	uint8_t const *properties_end = ptr + properties_len;
+	while(ptr < properties_end)
+	{
+		uint8_t id = *ptr++;
+		//The whole value must be in the packet before any of it is read
+		int len = propertyLength(id, ptr, properties_end);
+		if(len < 0)
+		{
+			return 0;
+		}
+		switch(static_cast<MQTTV5Property>(id))
+		{
+			case MQTTV5Property::RECEIVE_MAXIMUM:
+			properties->receive_maximum = readUint16(ptr);
+			break;
+
+			case MQTTV5Property::TOPIC_ALIAS_MAXIMUM:
+			properties->topic_alias_maximum = readUint16(ptr);
+			break;
+
+			case MQTTV5Property::MAXIMUM_PACKET_SIZE:
+			properties->maximum_packet_size = readUint32(ptr);
+			break;
+
+			case MQTTV5Property::MAXIMUM_QOS:
+			properties->maximum_qos = *ptr;
+			break;
+
+			default:
+			break;
+		}
+		ptr += len;
+	}
+	return 1;
+}
+
+
+/**
+ *	Serialize the properties section of an MQTT 5 PUBLISH packet, including
+ *	its length prefix
+ *	@param buf - Output - At least MQTTV5_PUBLISH_PROPERTIES_MAX_SIZE bytes
+ *	@param topic_alias - Topic alias. 0 omits the property
+ *	@param message_expiry_interval - Message expiry interval in seconds.
+ *	                                 0 omits the property, and the message
+ *	                                 never expires
+ *	@return Length of the properties section in bytes
+ */
+int MQTTV5Serialize_publishProperties(
+	uint8_t buf[],
+	uint16_t topic_alias,
+	uint32_t message_expiry_interval)
+{
+	//The properties are always shorter than 128 bytes, so the length prefix
+	//	is a single byte
+	uint8_t *ptr = &buf[1];
+	if(0 != message_expiry_interval)
+	{
+		*ptr++ = static_cast<uint8_t>(MQTTV5Property::MESSAGE_EXPIRY_INTERVAL);
+		writeUint32(&ptr, message_expiry_interval);
+	}
+	if(0 != topic_alias)
+	{
+		*ptr++ = static_cast<uint8_t>(MQTTV5Property::TOPIC_ALIAS);
+		writeUint16(&ptr, topic_alias);
+	}
+	buf[0] = static_cast<uint8_t>(ptr - buf - 1);
+	return ptr - buf;
+}
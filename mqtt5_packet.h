@@ -0,0 +1,72 @@
+/**
+ * mqtt5_packet.h
+ * Serialization of the MQTT 5 control packets used by GB4MQTT, built on the
+ * helpers of paho's MQTTPacket, which only speaks MQTT 3.1.1
+ */
+
+#ifndef MQTT5_PACKET_H
+#define MQTT5_PACKET_H
+
+#include <cstddef>
+#include <cstdint>
+#include "MQTTPacket.h"
+
+static uint8_t constexpr MQTTV5_PROTOCOL_VERSION = 5;
+static size_t constexpr MQTTV5_PUBLISH_PROPERTIES_MAX_SIZE = 9;
+
+enum class MQTTV5Property {
+	MESSAGE_EXPIRY_INTERVAL = 0x02,
+	RECEIVE_MAXIMUM = 0x21,
+	TOPIC_ALIAS_MAXIMUM = 0x22,
+	TOPIC_ALIAS = 0x23,
+	MAXIMUM_QOS = 0x24,
+	MAXIMUM_PACKET_SIZE = 0x27,
+};
+
+class MQTTV5ConnectProperties {
+	public:
+	MQTTV5ConnectProperties()
+	{
+		receive_maximum = 0;
+		maximum_packet_size = 0;
+	}
+
+	uint16_t receive_maximum;
+	uint32_t maximum_packet_size;
+};
+
+class MQTTV5ConnackProperties {
+	public:
+	static uint16_t constexpr DEFAULT_RECEIVE_MAXIMUM = 65535;
+
+	MQTTV5ConnackProperties()
+	{
+		receive_maximum = DEFAULT_RECEIVE_MAXIMUM;
+		topic_alias_maximum = 0;
+		maximum_packet_size = 0;
+		maximum_qos = 2;
+	}
+
+	uint16_t receive_maximum;
+	uint16_t topic_alias_maximum;
+	uint32_t maximum_packet_size;
+	uint8_t maximum_qos;
+};
+
+int MQTTV5Serialize_connect(
+	uint8_t buf[],
+	int buflen,
+	MQTTPacket_connectData const *options,
+	MQTTV5ConnectProperties const *properties);
+int MQTTV5Deserialize_connack(
+	uint8_t *session_present,
+	uint8_t *reason_code,
+	MQTTV5ConnackProperties *properties,
+	uint8_t const buf[],
+	int buflen);
+int MQTTV5Serialize_publishProperties(
+	uint8_t buf[],
+	uint16_t topic_alias,
+	uint32_t message_expiry_interval);
+
+#endif //MQTT5_PACKET_H
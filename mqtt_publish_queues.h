@@ -0,0 +1,180 @@
+/**
+ * mqtt_publish_queues.h
+ * Publish requests waiting to be sent, in one queue per priority class, and
+ * the policies GB4MQTT applies to them: which request is sent next, which
+ * request a publish on a coalescing topic replaces, and which requests have
+ * expired. The policies only read the request fields they need, so they can
+ * be tested without a radio.
+ */
+
+#ifndef MQTT_PUBLISH_QUEUES_H
+#define MQTT_PUBLISH_QUEUES_H
+
+#include "static_queue.h"
+#include <cstddef>
+#include <cstdint>
+
+/**
+ *	@tparam Request - Publish request with topic_id, ready_to_send,
+ *	                  in_flight, tries and stored members, and an
+ *	                  isExpired(int32_t now) method. See MQTTRequest
+ *	@tparam CLASSES - Number of priority classes. Class 0 goes first
+ *	@tparam DEPTH - Requests queued per priority class
+ *	@tparam STARVATION_LIMIT - Times in a row a class with requests waiting
+ *	                           is passed over before it is served regardless
+ */
+template<
+	class Request,
+	size_t CLASSES,
+	size_t DEPTH,
+	uint8_t STARVATION_LIMIT>
+class MQTTPublishQueues {
+	public:
+	typedef StaticQueue<Request, DEPTH> Queue;
+
+	MQTTPublishQueues()
+	{
+		for(size_t p = 0; p < CLASSES; p++)
+		{
+			m_passed_over[p] = 0;
+		}
+	}
+
+	/**
+	 *	Queue of a priority class
+	 */
+	Queue &operator[](size_t p)
+	{
+		return m_queues[p];
+	}
+
+	bool isEmpty()
+	{
+		for(size_t p = 0; p < CLASSES; p++)
+		{
+			if(false == m_queues[p].isEmpty())
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 *	Pick the publish request to send next: the oldest request of the
+	 *	highest priority class that has one, unless a lower class with
+	 *	requests waiting has been passed over STARVATION_LIMIT times in a
+	 *	row, in which case the oldest request of that class goes first.
+	 *	@return
+	 *		nullptr - No publish requests are queued
+	 *		Otherwise, the request to send
+	 */
+	Request *next()
+	{
+		size_t served = CLASSES;
+		for(size_t p = 0; p < CLASSES; p++)
+		{
+			if(true == m_queues[p].isEmpty())
+			{
+				continue;
+			}
+			if(CLASSES == served)
+			{
+				served = p;
+			}
+			else if(m_passed_over[p] >= STARVATION_LIMIT)
+			{
+				served = p;
+				break;
+			}
+		}
+		if(CLASSES == served)
+		{
+			return nullptr;
+		}
+		for(size_t p = 0; p < CLASSES; p++)
+		{
+			if(served == p)
+			{
+				m_passed_over[p] = 0;
+			}
+			else if(
+				(false == m_queues[p].isEmpty()) &&
+				(m_passed_over[p] < STARVATION_LIMIT))
+			{
+				m_passed_over[p]++;
+			}
+		}
+		return m_queues[served].peak();
+	}
+
+	/**
+	 *	Find a queued publish request that a new publish on the topic may
+	 *	replace
+	 *	@param topic_id - Topic of the new publish
+	 *	@param p - Priority class of the new publish. Only requests of the
+	 *	           same class are replaced
+	 *	@return
+	 *		nullptr - Every queued request on the topic has been sent at
+	 *		          least once, or came from the store
+	 *		Otherwise, the request to replace
+	 */
+	Request *findCoalescable(uint8_t topic_id, size_t p)
+	{
+		for(
+			LinkedNode<Request> *node = m_queues[p].peakNode();
+			nullptr != node;
+			node = node->next())
+		{
+			Request &req = node->value();
+			if(
+				(topic_id == req.topic_id) &&
+				(true == req.ready_to_send) &&
+				(false == req.in_flight) &&
+				(0 == req.tries) &&
+				(false == req.stored))
+			{
+				return &req;
+			}
+		}
+		return nullptr;
+	}
+
+	/**
+	 *	Remove the first queued publish request that has expired. It stays
+	 *	in its slot until the slot is used again, so that what it holds can
+	 *	still be released.
+	 *	@param now - Current time, as given by millis()
+	 *	@param sending - The request being sent, which is left to its sender
+	 *	                 to check before every transmission, or nullptr
+	 *	@return
+	 *		nullptr - No other request has expired
+	 *		Otherwise, the request removed
+	 */
+	Request *removeExpired(int32_t now, Request const *sending)
+	{
+		for(size_t p = 0; p < CLASSES; p++)
+		{
+			for(
+				LinkedNode<Request> *node = m_queues[p].peakNode();
+				nullptr != node;
+				node = node->next())
+			{
+				Request &req = node->value();
+				if((&req != sending) && (true == req.isExpired(now)))
+				{
+					m_queues[p].remove(node);
+					return &req;
+				}
+			}
+		}
+		return nullptr;
+	}
+
+	private:
+	Queue m_queues[CLASSES];
+	//Times each class has been passed over since it was last served
+	uint8_t m_passed_over[CLASSES];
+};
+
+#endif //MQTT_PUBLISH_QUEUES_H
@@ -0,0 +1,104 @@
+/**
+ * stack_monitor.cpp
+ */
+
+#include "stack_monitor.h"
+#include "Arduino.h"
+
+//Moves the end of the heap. See syscalls_sam3.c
+extern "C" char *_sbrk(int incr);
+
+StackMonitor g_stack;
+
+/**
+ *	End of the heap, rounded up to a word
+ */
+static uint32_t *heapEnd()
+{
+	uintptr_t end = reinterpret_cast<uintptr_t>(_sbrk(0));
+	return reinterpret_cast<uint32_t*>(
+		(end + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1));
+}
+
+
+StackMonitor::StackMonitor()
+{
+	m_bottom = nullptr;
+	m_top = nullptr;
+}
+
+
+/**
+ *	Fill the RAM between the end of the heap and the stack pointer with
+ *	StackMonitor::PAINT. Call once, as early in main() as possible, as the
+ *	stack already in use isn't measured.
+ */
+void StackMonitor::paint()
+{
+	//The first word of the vector table is the initial stack pointer
+	m_top = reinterpret_cast<uint32_t*>(
+		*reinterpret_cast<uint32_t const volatile*>(SCB->VTOR));
+	m_bottom = heapEnd();
+	uint32_t *sp;
+	__asm__ volatile("mov %0, sp" : "=r"(sp));
+	uint32_t volatile *end = sp - (PAINT_MARGIN / sizeof(uint32_t));
+	for(uint32_t volatile *word = m_bottom; word < end; word++)
+	{
+		*word = PAINT;
+	}
+}
+
+
+/**
+ *	Most bytes of stack used since StackMonitor::paint(). Scans the painted
+ *	RAM, which takes about a millisecond per 10 KB not yet used.
+ *	@return
+ *		0 - StackMonitor::paint() hasn't been called
+ *		Otherwise, bytes from the initial stack pointer to the deepest word
+ *		written
+ */
+size_t StackMonitor::highWater()
+{
+	if(nullptr == m_top)
+	{
+		return 0;
+	}
+	return (m_top - deepest()) * sizeof(uint32_t);
+}
+
+
+/**
+ *	Bytes between the end of the heap and the deepest the stack has grown,
+ *	which neither has ever used. This is the RAM left over in the worst case
+ *	seen so far.
+ *	@return
+ *		0 - StackMonitor::paint() hasn't been called, or the heap and the
+ *		    stack have met
+ */
+size_t StackMonitor::headroom()
+{
+	if(nullptr == m_top)
+	{
+		return 0;
+	}
+	return (deepest() - heapEnd()) * sizeof(uint32_t);
+}
+
+
+/**
+ *	Lowest word that the stack has written, looking up from the end of the
+ *	heap, which may have grown into the painted RAM since
+ */
+uint32_t const volatile *StackMonitor::deepest()
+{
+	uint32_t const volatile *word = heapEnd();
+	if(word < m_bottom)
+	{
+		word = m_bottom;
+	}
+	while((word < m_top) && (PAINT == *word))
+	{
+		word++;
+	}
+	return word;
+}
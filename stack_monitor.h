@@ -0,0 +1,36 @@
+/**
+ * stack_monitor.h
+ * Measures the deepest the stack has grown since start up. The free RAM
+ * between the heap and the stack is filled with a pattern early in main(),
+ * and the stack has reached as deep as the lowest word that no longer holds
+ * it. Interrupt handlers run on the same stack, so they are included.
+ */
+
+#ifndef STACK_MONITOR_H
+#define STACK_MONITOR_H
+
+#include <cstddef>
+#include <cstdint>
+
+class StackMonitor {
+	public:
+	static uint32_t constexpr PAINT = 0x5A5A5A5A;
+	//Bytes below the stack pointer that StackMonitor::paint() leaves alone
+	static size_t constexpr PAINT_MARGIN = 32;
+
+	StackMonitor();
+	void paint();
+	size_t highWater();
+	size_t headroom();
+
+	private:
+	uint32_t const volatile *deepest();
+
+	//Lowest word painted, and the initial stack pointer
+	uint32_t *m_bottom;
+	uint32_t *m_top;
+};
+
+extern StackMonitor g_stack;
+
+#endif //STACK_MONITOR_H
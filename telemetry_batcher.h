@@ -0,0 +1,314 @@
+/**
+ * telemetry_batcher.h
+ * Collects Sentinel reports into batches and publishes each batch with
+ * GB4MQTT::publishBuffer(), straight from the buffer it was encoded into.
+ * A batch is published when the next report doesn't fit into it, or when
+ * its first report is older than the maximum age, so the delay of a report
+ * is bounded by the maximum age rather than by the number of reports.
+ * Two buffers are used, so a new batch can be filled while the previous
+ * one is still being published. A batch GB4MQTT refuses for now, because
+ * its queue or its budget is exhausted, is kept in its buffer and offered
+ * again on the next poll, and no reports are taken until it is accepted.
+ * Batches can optionally be compressed with LZCodec, in which case they are
+ * encoded into a separate buffer and compressed into the publish buffers.
+ */
+
+#ifndef TELEMETRY_BATCHER_H
+#define TELEMETRY_BATCHER_H
+
+#include "Arduino.h"
+#include "lz_codec.h"
+#include "sentinel_report.h"
+
+/**
+ *	@tparam Encoder - Batch encoder, such as SentinelJSONEncoder, providing
+ *	                  begin(), add(), finish() and count()
+ *	@tparam BUFFER_SIZE - Size of each batch buffer in bytes
+ *	@tparam Client - GB4MQTT, or anything with its MESSAGE_MAX_SIZE, Return,
+ *	                 publishBuffer(), isBufferInUse() and schedulePublish()
+ */
+template<class Encoder, size_t BUFFER_SIZE, class Client>
+class TelemetryBatcher {
+	public:
+	static_assert(
+		BUFFER_SIZE <= Client::MESSAGE_MAX_SIZE,
+		"A batch must fit into a single publish");
+
+	enum class Return {
+		PUBLISH_ERROR = -3,
+		BUFFER_BUSY = -2,
+		REPORT_TOO_LARGE = -1,
+		WAITING = 0,
+		ADDED,
+		FLUSHED,
+	};
+
+	/**
+	 *	@param client - Client the batches are published with
+	 *	@param topic_id - Topic given by GB4MQTT::registerTopic()
+	 *	@param device_id - Null terminated device ID given to the encoder.
+	 *	                   Must stay valid for the lifetime of the batcher.
+	 *	@param max_age - Milliseconds after its first report that a batch is
+	 *	                 published
+	 *	@param qos - Publish Quality of Service of the batches
+	 *	@param disconnect - Passed to GB4MQTT::publishBuffer() with each batch
+	 */
+	TelemetryBatcher(
+		Client &client,
+		uint8_t topic_id,
+		char const *device_id,
+		int32_t max_age,
+		uint8_t qos = 1,
+		bool disconnect = true) :
+		m_client(client)
+	{
+		m_topic_id = topic_id;
+		m_device_id = device_id;
+		m_max_age = max_age;
+		m_qos = qos;
+		m_disconnect = disconnect;
+		m_batch_start_time = 0;
+		m_active = 0;
+		m_open = false;
+		m_pending = false;
+		m_pending_len = 0;
+		m_codec = nullptr;
+		m_encode_buffer = nullptr;
+		m_encode_size = 0;
+	}
+
+	/**
+	 *	Compress the batches that are started from now on
+	 *	@param codec - Codec to compress with, or nullptr to stop compressing
+	 *	@param buffer - Buffer the batches are encoded into before being
+	 *	                compressed. Only as much of it is used as is sure to
+	 *	                compress into a publish buffer.
+	 *	@param size - Size of buffer in bytes
+	 */
+	void setCompressor(LZCodec *codec, uint8_t buffer[], size_t size)
+	{
+		static size_t constexpr ENCODE_MAX_SIZE =
+			LZCodec::maxInputLength(BUFFER_SIZE);
+		m_codec = codec;
+		m_encode_buffer = buffer;
+		m_encode_size = (size < ENCODE_MAX_SIZE) ? size : ENCODE_MAX_SIZE;
+	}
+
+	/**
+	 *	Add a report to the current batch, publishing the batch first if the
+	 *	report doesn't fit into it
+	 *	@return
+	 *		TelemetryBatcher::Return::BUFFER_BUSY - Both buffers are waiting
+	 *		                                        to be published, or a
+	 *		                                        batch GB4MQTT refused is
+	 *		                                        waiting to be offered
+	 *		                                        again. The report is not
+	 *		                                        added.
+	 *		TelemetryBatcher::Return::REPORT_TOO_LARGE - The report doesn't
+	 *		                                             fit into an empty
+	 *		                                             batch
+	 *		TelemetryBatcher::Return::PUBLISH_ERROR - The full batch could
+	 *		                                          never be published, and
+	 *		                                          is dropped. The report
+	 *		                                          is not added.
+	 *		TelemetryBatcher::Return::FLUSHED - The full batch was published,
+	 *		                                    and the report starts a new one
+	 *		TelemetryBatcher::Return::ADDED
+	 */
+	Return add(SentinelReport const &report)
+	{
+		if((true == m_pending) && (Return::BUFFER_BUSY == publishPending()))
+		{
+			return Return::BUFFER_BUSY;
+		}
+		if((false == m_open) && (false == open()))
+		{
+			return Return::BUFFER_BUSY;
+		}
+		if(true == addToBatch(report))
+		{
+			return Return::ADDED;
+		}
+		if(0 == m_encoder.count())
+		{
+			return Return::REPORT_TOO_LARGE;
+		}
+
+		Return status = flush();
+		if(Return::FLUSHED != status)
+		{
+			return status;
+		}
+		if(false == open())
+		{
+			return Return::BUFFER_BUSY;
+		}
+		if(false == addToBatch(report))
+		{
+			return Return::REPORT_TOO_LARGE;
+		}
+		return Return::FLUSHED;
+	}
+
+	/**
+	 *	Offer a batch GB4MQTT refused again, or publish the current batch if
+	 *	it has reached the maximum age
+	 *	Note: Must be called once per main loop
+	 *	@return
+	 *		TelemetryBatcher::Return::WAITING - The batch is empty or not due
+	 *		See TelemetryBatcher::flush()
+	 */
+	Return poll()
+	{
+		if(true == m_pending)
+		{
+			return publishPending();
+		}
+		int32_t age = millis() - m_batch_start_time;
+		if((false == m_open) || (0 == m_encoder.count()) || (age < m_max_age))
+		{
+			return Return::WAITING;
+		}
+		return flush();
+	}
+
+	/**
+	 *	Publish the current batch now, or the batch GB4MQTT refused if there
+	 *	is one
+	 *	@return
+	 *		TelemetryBatcher::Return::WAITING - The batch is empty
+	 *		TelemetryBatcher::Return::BUFFER_BUSY - GB4MQTT refused the batch
+	 *		                                        for now. It is kept, and
+	 *		                                        offered again on the next
+	 *		                                        poll or add.
+	 *		TelemetryBatcher::Return::PUBLISH_ERROR - The batch could never be
+	 *		                                          published, or did not
+	 *		                                          compress, and is dropped
+	 *		TelemetryBatcher::Return::FLUSHED
+	 */
+	Return flush()
+	{
+		if(true == m_pending)
+		{
+			return publishPending();
+		}
+		if((false == m_open) || (0 == m_encoder.count()))
+		{
+			return Return::WAITING;
+		}
+		size_t len = m_encoder.finish();
+		if(nullptr != m_codec)
+		{
+			len = m_codec->compress(
+				m_encode_buffer,
+				len,
+				m_buffers[m_active],
+				BUFFER_SIZE);
+			if(0 == len)
+			{
+				m_open = false;
+				return Return::PUBLISH_ERROR;
+			}
+		}
+		m_open = false;
+		m_pending = true;
+		m_pending_len = len;
+		return publishPending();
+	}
+
+	size_t count()
+	{
+		return (true == m_open) ? m_encoder.count() : 0;
+	}
+
+	private:
+	/**
+	 *	Hand the finished batch in the active buffer to GB4MQTT, and move on
+	 *	to the other buffer once it is taken. A batch refused because the
+	 *	queue, the store or the budget is full is kept for the next try.
+	 */
+	Return publishPending()
+	{
+		typename Client::Return status = m_client.publishBuffer(
+			m_topic_id,
+			m_buffers[m_active],
+			m_pending_len,
+			m_qos,
+			m_disconnect);
+		if(
+			(Client::Return::PUBLISH_QUEUE_FULL == status) ||
+			(Client::Return::PUBLISH_BUDGET_EXHAUSTED == status))
+		{
+			return Return::BUFFER_BUSY;
+		}
+		m_pending = false;
+		m_active ^= 1;
+		if(
+			(Client::Return::PUBLISH_QUEUED != status) &&
+			(Client::Return::PUBLISH_COALESCED != status) &&
+			(Client::Return::PUBLISH_STORED != status))
+		{
+			return Return::PUBLISH_ERROR;
+		}
+		return Return::FLUSHED;
+	}
+
+	/**
+	 *	Start a new batch in the active buffer, unless GB4MQTT is still
+	 *	publishing from it
+	 */
+	bool open()
+	{
+		if(true == m_client.isBufferInUse(m_buffers[m_active]))
+		{
+			return false;
+		}
+		if(nullptr != m_codec)
+		{
+			m_open = m_encoder.begin(m_encode_buffer, m_encode_size, m_device_id);
+		}
+		else
+		{
+			m_open = m_encoder.begin(m_buffers[m_active], BUFFER_SIZE, m_device_id);
+		}
+		return m_open;
+	}
+
+	/**
+	 *	Add a report, and announce the publish of a new batch to GB4MQTT so
+	 *	that it can pre-warm the connection
+	 */
+	bool addToBatch(SentinelReport const &report)
+	{
+		if(false == m_encoder.add(report))
+		{
+			return false;
+		}
+		if(1 == m_encoder.count())
+		{
+			m_batch_start_time = millis();
+			m_client.schedulePublish(m_max_age);
+		}
+		return true;
+	}
+
+	Client &m_client;
+	Encoder m_encoder;
+	uint8_t m_buffers[2][BUFFER_SIZE];
+	uint8_t m_topic_id;
+	char const *m_device_id;
+	int32_t m_max_age;
+	int32_t m_batch_start_time;
+	uint8_t m_qos;
+	uint8_t m_active;
+	bool m_disconnect;
+	bool m_open;
+	//A finished batch GB4MQTT refused is in the active buffer
+	bool m_pending;
+	size_t m_pending_len;
+	LZCodec *m_codec;
+	uint8_t *m_encode_buffer;
+	size_t m_encode_size;
+};
+
+#endif //TELEMETRY_BATCHER_H
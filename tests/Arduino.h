@@ -0,0 +1,18 @@
+/**
+ * Arduino.h
+ * Stand-in for the Arduino core on a host, with a clock the tests set
+ */
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <cstdint>
+
+extern uint32_t g_millis;
+
+inline uint32_t millis()
+{
+	return g_millis;
+}
+
+#endif //ARDUINO_H
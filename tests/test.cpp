@@ -0,0 +1,778 @@
+/**
+ * test.cpp
+ * Unit test for the MQTT 5 CONNACK deserializer, for TelemetryBatcher with
+ * stand-ins for its encoder and GB4MQTT, for TokenBucket, and for the
+ * publish queue policies with a stand-in for MQTTRequest
+ */
+
+#include "mqtt5_packet.h"
+#include "mqtt_publish_queues.h"
+#include "report_history.h"
+#include "telemetry_batcher.h"
+#include "token_bucket.h"
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <vector>
+
+uint32_t g_millis = 0;
+
+
+class TestConnack {
+	public:
+	TestConnack() {}
+
+	/**
+	 * Deserialize a CONNACK with properties GB4MQTT reads, and properties it
+	 * skips
+	 * Verify that the properties read are set, and the others left at their
+	 * defaults
+	 */
+	bool properties()
+	{
+		m_name.assign("properties");
+		std::vector<uint8_t> packet = {
+			0x20, 23, 0x01, 0x00, 20,
+			0x21, 0x00, 0x0A,
+			0x27, 0x00, 0x00, 0x04, 0x00,
+			0x1F, 0x00, 0x02, 'o', 'k',
+			0x26, 0x00, 0x01, 'k', 0x00, 0x01, 'v'};
+		return
+			(1 == deserialize(packet)) &&
+			(1 == m_session_present) &&
+			(0 == m_reason_code) &&
+			(10 == m_properties.receive_maximum) &&
+			(1024 == m_properties.maximum_packet_size) &&
+			(0 == m_properties.topic_alias_maximum) &&
+			(2 == m_properties.maximum_qos);
+	}
+
+	/**
+	 * Deserialize CONNACKs whose last property runs past the end of the
+	 * properties, which is also the end of the packet
+	 * Verify that each is rejected, and the truncated value isn't read
+	 */
+	bool truncatedProperties()
+	{
+		m_name.assign("truncatedProperties");
+		std::vector<std::vector<uint8_t>> packets = {
+			//Maximum packet size with 2 of its 4 bytes
+			{0x20, 6, 0x00, 0x00, 3, 0x27, 0x00, 0x04},
+			//Receive maximum with no value
+			{0x20, 4, 0x00, 0x00, 1, 0x21},
+			//Reason string with 1 byte of its length
+			{0x20, 5, 0x00, 0x00, 2, 0x1F, 0x00},
+			//Reason string longer than what is left
+			{0x20, 7, 0x00, 0x00, 4, 0x1F, 0x00, 0x05, 'a'},
+			//User property with 1 byte of the length of its value
+			{0x20, 8, 0x00, 0x00, 5, 0x26, 0x00, 0x01, 'k', 0x00},
+			//Subscription identifier whose last byte is missing
+			{0x20, 5, 0x00, 0x00, 2, 0x0B, 0x80}};
+		for(std::vector<uint8_t> const &packet : packets)
+		{
+			if(
+				(0 != deserialize(packet)) ||
+				(0 != m_properties.maximum_packet_size))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Deserialize CONNACKs whose variable byte integers are truncated, too
+	 * long, or larger than the packet
+	 * Verify that each is rejected
+	 */
+	bool truncatedLengths()
+	{
+		m_name.assign("truncatedLengths");
+		std::vector<std::vector<uint8_t>> packets = {
+			//Remaining length running past the buffer
+			{0x20, 0x80, 0x80, 0x80},
+			//Remaining length of 5 bytes
+			{0x20, 0xFF, 0xFF, 0xFF, 0xFF, 0x7F},
+			//Remaining length longer than the buffer
+			{0x20, 4, 0x00, 0x00, 0},
+			//Property length running past the remaining length
+			{0x20, 3, 0x00, 0x00, 0x80},
+			//Property length longer than the remaining length
+			{0x20, 4, 0x00, 0x00, 4, 0x24}};
+		for(std::vector<uint8_t> const &packet : packets)
+		{
+			if(0 != deserialize(packet))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	std::string printResult()
+	{
+		std::string result = m_name;
+		result += "\nResult:\n";
+		result += "\treturn = " + std::to_string(m_return) + "\n";
+		result += "\tpacket = ";
+		for(uint8_t byte : m_packet)
+		{
+			result += std::to_string(byte) + " ";
+		}
+		result += "\n";
+		result += "\treceive_maximum = " +
+			std::to_string(m_properties.receive_maximum) + "\n";
+		result += "\tmaximum_packet_size = " +
+			std::to_string(m_properties.maximum_packet_size) + "\n";
+		return result;
+	}
+
+	private:
+	/**
+	 * Deserialize a packet from a buffer of exactly its length, so that
+	 * valgrind reports any read past its end
+	 */
+	int deserialize(std::vector<uint8_t> const &packet)
+	{
+		m_packet = packet;
+		uint8_t *buf = new uint8_t[packet.size()];
+		memcpy(buf, packet.data(), packet.size());
+		m_return = MQTTV5Deserialize_connack(
+			&m_session_present,
+			&m_reason_code,
+			&m_properties,
+			buf,
+			static_cast<int>(packet.size()));
+		delete[] buf;
+		return m_return;
+	}
+
+	int m_return = 0;
+	uint8_t m_session_present = 0;
+	uint8_t m_reason_code = 0;
+	MQTTV5ConnackProperties m_properties;
+	std::vector<uint8_t> m_packet;
+	std::string m_name;
+};
+
+
+/**
+ *	Stands in for a batch encoder, writing the cnt of each report as 4 bytes
+ */
+class FakeEncoder {
+	public:
+	bool begin(uint8_t buf[], size_t size, char const *device_id)
+	{
+		(void)device_id;
+		m_buf = buf;
+		m_size = size;
+		m_count = 0;
+		return true;
+	}
+
+	bool add(SentinelReport const &report)
+	{
+		if(((m_count + 1) * 4) > m_size)
+		{
+			return false;
+		}
+		memcpy(&m_buf[m_count * 4], &report.cnt, 4);
+		m_count++;
+		return true;
+	}
+
+	size_t finish()
+	{
+		return m_count * 4;
+	}
+
+	size_t count()
+	{
+		return m_count;
+	}
+
+	private:
+	uint8_t *m_buf = nullptr;
+	size_t m_size = 0;
+	size_t m_count = 0;
+};
+
+
+/**
+ *	Stands in for GB4MQTT, queueing a number of batches and refusing the
+ *	rest, and sending one queued batch at a time
+ */
+class FakeClient {
+	public:
+	static size_t constexpr MESSAGE_MAX_SIZE = 64;
+
+	enum class Return {
+		PUBLISH_BUDGET_EXHAUSTED = -19,
+		PUBLISH_QUEUE_FULL = -13,
+		TOPIC_UNKNOWN = -7,
+		PUBLISH_QUEUED = 1,
+		PUBLISH_COALESCED,
+		PUBLISH_STORED,
+	};
+
+	Return publishBuffer(
+		uint8_t topic_id,
+		uint8_t const message[],
+		size_t message_len,
+		uint8_t qos,
+		bool disconnect)
+	{
+		(void)topic_id;
+		(void)qos;
+		(void)disconnect;
+		if(0 == room)
+		{
+			return refusal;
+		}
+		room--;
+		m_queue.push_back(std::make_pair(message, message_len));
+		return Return::PUBLISH_QUEUED;
+	}
+
+	bool isBufferInUse(uint8_t const buffer[])
+	{
+		for(auto const &batch : m_queue)
+		{
+			if(buffer == batch.first)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void schedulePublish(int32_t delay)
+	{
+		(void)delay;
+	}
+
+	/**
+	 *	Send the oldest queued batch, reading the cnts out of its buffer
+	 */
+	void send()
+	{
+		if(true == m_queue.empty())
+		{
+			return;
+		}
+		for(size_t i = 0; i < m_queue.front().second; i += 4)
+		{
+			uint32_t cnt;
+			memcpy(&cnt, &m_queue.front().first[i], 4);
+			published.push_back(cnt);
+		}
+		m_queue.pop_front();
+	}
+
+	bool isIdle()
+	{
+		return m_queue.empty();
+	}
+
+	size_t room = 0;
+	Return refusal = Return::PUBLISH_QUEUE_FULL;
+	std::vector<uint32_t> published;
+
+	private:
+	std::deque<std::pair<uint8_t const*, size_t>> m_queue;
+};
+
+
+class TestTelemetryBatcher {
+	public:
+	//4 reports to a batch
+	typedef TelemetryBatcher<FakeEncoder, 16, FakeClient> Batcher;
+	typedef SentinelReportHistory<64> History;
+
+	TestTelemetryBatcher() {}
+
+	/**
+	 * Batch reports the way main.cpp does, while GB4MQTT refuses batches
+	 * for a while because its budget is exhausted, and later because its
+	 * queue is full
+	 * Verify that every report is published once, in order
+	 */
+	bool refusedBatches()
+	{
+		m_name.assign("refusedBatches");
+		static uint32_t constexpr REPORT_COUNT = 200;
+		FakeClient client;
+		Batcher batcher(client, 0, "test", 3000);
+		History history;
+		for(uint32_t cnt = 0; cnt < REPORT_COUNT; cnt++)
+		{
+			g_millis += 1000;
+			if((cnt >= 30) && (cnt < 90))
+			{
+				client.room = 0;
+				client.refusal = FakeClient::Return::PUBLISH_BUDGET_EXHAUSTED;
+			}
+			else if((cnt >= 120) && (cnt < 150))
+			{
+				client.room = 0;
+				client.refusal = FakeClient::Return::PUBLISH_QUEUE_FULL;
+			}
+			else
+			{
+				client.room = 1;
+			}
+			SentinelReport report;
+			report.cnt = cnt;
+			step(batcher, history, &report);
+			client.send();
+		}
+		//Let everything left go out
+		client.room = REPORT_COUNT;
+		for(size_t i = 0; i < 100; i++)
+		{
+			g_millis += 1000;
+			step(batcher, history, nullptr);
+			client.send();
+		}
+		m_published = client.published;
+		if(
+			(REPORT_COUNT != m_published.size()) ||
+			(0 != history.thinned()) ||
+			(false == history.isEmpty()) ||
+			(false == client.isIdle()))
+		{
+			return false;
+		}
+		for(uint32_t cnt = 0; cnt < REPORT_COUNT; cnt++)
+		{
+			if(cnt != m_published[cnt])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Have GB4MQTT refuse a batch for good
+	 * Verify that the batch is dropped, rather than offered forever, and
+	 * that the next batch is published
+	 */
+	bool droppedBatch()
+	{
+		m_name.assign("droppedBatch");
+		FakeClient client;
+		Batcher batcher(client, 0, "test", 3000);
+		client.refusal = FakeClient::Return::TOPIC_UNKNOWN;
+		SentinelReport report;
+		for(uint32_t cnt = 0; cnt < 4; cnt++)
+		{
+			report.cnt = cnt;
+			if(Batcher::Return::ADDED != batcher.add(report))
+			{
+				return false;
+			}
+		}
+		if(Batcher::Return::PUBLISH_ERROR != batcher.flush())
+		{
+			return false;
+		}
+		client.room = 1;
+		report.cnt = 4;
+		if(
+			(Batcher::Return::ADDED != batcher.add(report)) ||
+			(Batcher::Return::FLUSHED != batcher.flush()))
+		{
+			return false;
+		}
+		client.send();
+		m_published = client.published;
+		return (1 == m_published.size()) && (4 == m_published[0]);
+	}
+
+	std::string printResult()
+	{
+		std::string result = m_name;
+		result += "\nResult:\n";
+		result += "\tpublished = ";
+		for(uint32_t cnt : m_published)
+		{
+			result += std::to_string(cnt) + " ";
+		}
+		result += "\n";
+		return result;
+	}
+
+	private:
+	/**
+	 * One pass of the main loop of main.cpp
+	 * @param report - New report, or nullptr
+	 */
+	static void step(Batcher &batcher, History &history, SentinelReport *report)
+	{
+		if(nullptr != report)
+		{
+			Batcher::Return status = Batcher::Return::BUFFER_BUSY;
+			if(true == history.isEmpty())
+			{
+				status = batcher.add(*report);
+			}
+			if(
+				(Batcher::Return::BUFFER_BUSY == status) ||
+				(Batcher::Return::PUBLISH_ERROR == status))
+			{
+				history.add(*report);
+			}
+		}
+		if(Batcher::Return::BUFFER_BUSY != batcher.poll())
+		{
+			history.drain(batcher);
+		}
+	}
+
+	std::vector<uint32_t> m_published;
+	std::string m_name;
+};
+
+
+class TestTokenBucket {
+	public:
+	TestTokenBucket() {}
+
+	/**
+	 * Refill an empty bucket at 1000 tokens an hour, one token every 3.6s,
+	 * in steps of 1s, which each come to less than a token
+	 * Verify that the fractions add up to a token every 3.6s
+	 */
+	bool refillFraction()
+	{
+		m_name.assign("refillFraction");
+		g_millis = 0;
+		TokenBucket bucket;
+		bucket.configure(100, 1000);
+		bucket.take(100);
+		for(uint32_t second = 1; second <= 36; second++)
+		{
+			g_millis += 1000;
+			m_tokens = bucket.tokens();
+			if((second * 1000 / 3600) != m_tokens)
+			{
+				return false;
+			}
+		}
+		return 10 == m_tokens;
+	}
+
+	/**
+	 * Refill and give back tokens well past the capacity
+	 * Verify that the bucket never holds more than its capacity
+	 */
+	bool capacity()
+	{
+		m_name.assign("capacity");
+		g_millis = 0;
+		TokenBucket bucket;
+		bucket.configure(5, TokenBucket::MS_PER_HOUR);
+		bucket.take(3);
+		g_millis += 10000;
+		m_tokens = bucket.tokens();
+		if(5 != m_tokens)
+		{
+			return false;
+		}
+		bucket.take(1);
+		bucket.give(100);
+		m_tokens = bucket.tokens();
+		return 5 == m_tokens;
+	}
+
+	/**
+	 * Check for and take tokens from a bucket that doesn't refill, and from
+	 * one that doesn't limit
+	 * Verify that has() only passes counts the bucket holds, that take()
+	 * empties the bucket rather than overdrawing it, and that a bucket with
+	 * no capacity passes everything
+	 */
+	bool hasTake()
+	{
+		m_name.assign("hasTake");
+		g_millis = 0;
+		TokenBucket bucket;
+		bucket.configure(100, 0);
+		if(
+			(false == bucket.has(100)) ||
+			(true == bucket.has(101)))
+		{
+			return false;
+		}
+		bucket.take(60);
+		m_tokens = bucket.tokens();
+		if(
+			(40 != m_tokens) ||
+			(false == bucket.has(40)) ||
+			(true == bucket.has(41)))
+		{
+			return false;
+		}
+		bucket.take(1000);
+		m_tokens = bucket.tokens();
+		if((0 != m_tokens) || (true == bucket.has(1)))
+		{
+			return false;
+		}
+		TokenBucket unlimited;
+		unlimited.configure(0, 0);
+		unlimited.take(1000);
+		return
+			(false == unlimited.isLimited()) &&
+			(true == unlimited.has(UINT32_MAX));
+	}
+
+	std::string printResult()
+	{
+		std::string result = m_name;
+		result += "\nResult:\n";
+		result += "\ttokens = " + std::to_string(m_tokens) + "\n";
+		result += "\tmillis = " + std::to_string(g_millis) + "\n";
+		return result;
+	}
+
+	private:
+	uint32_t m_tokens = 0;
+	std::string m_name;
+};
+
+
+/**
+ *	Stands in for MQTTRequest, with the members the queue policies read,
+ *	and an ID to tell requests apart
+ */
+struct FakeRequest {
+	FakeRequest(uint32_t request_id, uint8_t topic, int32_t expiry_ms = 0)
+	{
+		id = request_id;
+		topic_id = topic;
+		queue_time = g_millis;
+		expiry = expiry_ms;
+	}
+
+	bool isExpired(int32_t now)
+	{
+		return (0 != expiry) && ((now - queue_time) >= expiry);
+	}
+
+	uint32_t id;
+	uint8_t topic_id;
+	bool ready_to_send = true;
+	bool in_flight = false;
+	uint8_t tries = 0;
+	bool stored = false;
+	int32_t queue_time;
+	int32_t expiry;
+};
+
+
+class TestPublishQueues {
+	public:
+	static uint8_t constexpr STARVATION_LIMIT = 4;
+	typedef MQTTPublishQueues<FakeRequest, 3, 8, STARVATION_LIMIT> Queues;
+
+	TestPublishQueues() {}
+
+	/**
+	 * Fill the highest class, and put one request in each of the others.
+	 * Send the request next() picks, one at a time
+	 * Verify that the highest class is served until the others have been
+	 * passed over STARVATION_LIMIT times, that they are then served one
+	 * after the other, and that it is served again after them
+	 */
+	bool starvation()
+	{
+		m_name.assign("starvation");
+		m_ids.clear();
+		Queues queues;
+		for(uint32_t i = 0; i < 8; i++)
+		{
+			queues[0].emplace(i, 0);
+		}
+		queues[1].emplace(100, 0);
+		queues[2].emplace(200, 0);
+		FakeRequest *req;
+		while(nullptr != (req = queues.next()))
+		{
+			m_ids.push_back(req->id);
+			queues[req->id / 100].dequeue();
+		}
+		std::vector<uint32_t> expected = {0, 1, 2, 3, 100, 200, 4, 5, 6, 7};
+		return expected == m_ids;
+	}
+
+	/**
+	 * Queue requests on a topic that have been sent, are being sent, came
+	 * from the store, or wait to be retransmitted, ahead of one that has
+	 * not been sent
+	 * Verify that only the one that has not been sent is replaced, and only
+	 * by a publish of its own class
+	 */
+	bool coalescing()
+	{
+		m_name.assign("coalescing");
+		m_ids.clear();
+		Queues queues;
+		queues[1].emplace(0, 1)->tries = 1;
+		queues[1].emplace(1, 1)->in_flight = true;
+		queues[1].emplace(2, 1)->stored = true;
+		queues[1].emplace(3, 1)->ready_to_send = false;
+		queues[1].emplace(4, 2);
+		queues[1].emplace(5, 1);
+		queues[2].emplace(6, 3);
+		FakeRequest *req = queues.findCoalescable(1, 1);
+		m_ids.push_back((nullptr != req) ? req->id : UINT32_MAX);
+		req = queues.findCoalescable(3, 1);
+		m_ids.push_back((nullptr != req) ? req->id : UINT32_MAX);
+		req = queues.findCoalescable(1, 2);
+		m_ids.push_back((nullptr != req) ? req->id : UINT32_MAX);
+		req = queues.findCoalescable(3, 2);
+		m_ids.push_back((nullptr != req) ? req->id : UINT32_MAX);
+		std::vector<uint32_t> expected = {5, UINT32_MAX, UINT32_MAX, 6};
+		return expected == m_ids;
+	}
+
+	/**
+	 * Queue requests that never expire, expire later, and have expired, in
+	 * every class, one of which is being sent
+	 * Verify that every request that has expired is removed, except the
+	 * one being sent, and that the others are left in order
+	 */
+	bool expiry()
+	{
+		m_name.assign("expiry");
+		m_ids.clear();
+		g_millis = 1000;
+		Queues queues;
+		queues[0].emplace(0, 0, 500);
+		queues[0].emplace(1, 0, 0);
+		FakeRequest *sending = queues[1].emplace(2, 0, 500);
+		queues[1].emplace(3, 0, 2000);
+		queues[2].emplace(4, 0, 1000);
+		queues[2].emplace(5, 0, 500);
+		g_millis += 1000;
+		FakeRequest *req;
+		while(nullptr != (req = queues.removeExpired(g_millis, sending)))
+		{
+			m_ids.push_back(req->id);
+		}
+		std::vector<uint32_t> expected = {0, 4, 5};
+		if(expected != m_ids)
+		{
+			return false;
+		}
+		m_ids.clear();
+		while(nullptr != (req = queues.next()))
+		{
+			m_ids.push_back(req->id);
+			queues[(req->id < 2) ? 0 : 1].dequeue();
+		}
+		expected = {1, 2, 3};
+		return expected == m_ids;
+	}
+
+	std::string printResult()
+	{
+		std::string result = m_name;
+		result += "\nResult:\n";
+		result += "\tids = ";
+		for(uint32_t id : m_ids)
+		{
+			result += std::to_string(id) + " ";
+		}
+		result += "\n";
+		return result;
+	}
+
+	private:
+	std::vector<uint32_t> m_ids;
+	std::string m_name;
+};
+
+
+int main()
+{
+	TestConnack test;
+
+	if(false == test.properties())
+	{
+		std::cout << test.printResult();
+		return -1;
+	}
+
+	if(false == test.truncatedProperties())
+	{
+		std::cout << test.printResult();
+		return -1;
+	}
+
+	if(false == test.truncatedLengths())
+	{
+		std::cout << test.printResult();
+		return -1;
+	}
+
+	TestTelemetryBatcher batcher_test;
+
+	if(false == batcher_test.refusedBatches())
+	{
+		std::cout << batcher_test.printResult();
+		return -1;
+	}
+
+	if(false == batcher_test.droppedBatch())
+	{
+		std::cout << batcher_test.printResult();
+		return -1;
+	}
+
+	TestTokenBucket bucket_test;
+
+	if(false == bucket_test.refillFraction())
+	{
+		std::cout << bucket_test.printResult();
+		return -1;
+	}
+
+	if(false == bucket_test.capacity())
+	{
+		std::cout << bucket_test.printResult();
+		return -1;
+	}
+
+	if(false == bucket_test.hasTake())
+	{
+		std::cout << bucket_test.printResult();
+		return -1;
+	}
+
+	TestPublishQueues queues_test;
+
+	if(false == queues_test.starvation())
+	{
+		std::cout << queues_test.printResult();
+		return -1;
+	}
+
+	if(false == queues_test.coalescing())
+	{
+		std::cout << queues_test.printResult();
+		return -1;
+	}
+
+	if(false == queues_test.expiry())
+	{
+		std::cout << queues_test.printResult();
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,115 @@
+/**
+ * token_bucket.h
+ * Rate limiter that allows bursts of up to its capacity, refilled at a
+ * steady rate. Rates are given per hour, since budgets of a few megabytes a
+ * month come to only a few bytes a second. Fractions of a token are carried
+ * over between refills, so slow rates are exact.
+ */
+
+#ifndef TOKEN_BUCKET_H
+#define TOKEN_BUCKET_H
+
+#include "Arduino.h"
+#include <cstdint>
+
+class TokenBucket {
+	public:
+	static uint32_t constexpr MS_PER_HOUR = 3600000;
+
+	TokenBucket()
+	{
+		m_capacity = 0;
+		m_rate = 0;
+		m_tokens = 0;
+		m_fraction = 0;
+		m_last_refill = 0;
+	}
+
+	/**
+	 *	Set the limit, and fill the bucket
+	 *	@param capacity - Most tokens the bucket holds. 0 disables the limit
+	 *	@param rate - Tokens added per hour
+	 */
+	void configure(uint32_t capacity, uint32_t rate)
+	{
+		m_capacity = capacity;
+		m_rate = rate;
+		m_tokens = capacity;
+		m_fraction = 0;
+		m_last_refill = millis();
+	}
+
+	bool isLimited()
+	{
+		return 0 != m_capacity;
+	}
+
+	/**
+	 *	Check if the bucket holds at least the given number of tokens
+	 */
+	bool has(uint32_t count)
+	{
+		if(false == isLimited())
+		{
+			return true;
+		}
+		refill();
+		return count <= m_tokens;
+	}
+
+	/**
+	 *	Take tokens out of the bucket. Taking more than it holds empties it,
+	 *	for costs that can't be refused, such as retransmissions.
+	 */
+	void take(uint32_t count)
+	{
+		if(false == isLimited())
+		{
+			return;
+		}
+		refill();
+		m_tokens = (count < m_tokens) ? (m_tokens - count) : 0;
+	}
+
+	/**
+	 *	Put back tokens taken for a cost that turned out smaller
+	 */
+	void give(uint32_t count)
+	{
+		if(false == isLimited())
+		{
+			return;
+		}
+		refill();
+		uint64_t tokens = static_cast<uint64_t>(m_tokens) + count;
+		m_tokens = (tokens < m_capacity) ? tokens : m_capacity;
+	}
+
+	uint32_t tokens()
+	{
+		refill();
+		return m_tokens;
+	}
+
+	private:
+	void refill()
+	{
+		uint32_t now = millis();
+		uint32_t elapsed = now - m_last_refill;
+		m_last_refill = now;
+		uint64_t added =
+			(static_cast<uint64_t>(elapsed) * m_rate) + m_fraction;
+		m_fraction = added % MS_PER_HOUR;
+		added /= MS_PER_HOUR;
+		uint64_t tokens = m_tokens + added;
+		m_tokens = (tokens < m_capacity) ? tokens : m_capacity;
+	}
+
+	uint32_t m_capacity;
+	uint32_t m_rate;
+	uint32_t m_tokens;
+	uint32_t m_fraction;
+	uint32_t m_last_refill;
+};
+
+#endif //TOKEN_BUCKET_H
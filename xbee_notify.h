@@ -5,6 +5,7 @@
 #ifndef XBEE_NOTIFY_H
 #define XBEE_NOTIFY_H
 
+#include "gb4_config.h"
 #include "xbee/socket.h"
 #include "xbee/platform.h"
 
@@ -125,7 +126,8 @@ class XBeeNotify {
 
 class XBeeReceive {
 	public:
-	static size_t constexpr MESSAGE_PAYLOAD_SIZE = 300; 	
+	static size_t constexpr MESSAGE_PAYLOAD_SIZE =
+		GB4BuildConfig::XBEE_RECEIVE_PAYLOAD_SIZE;
 
 	XBeeReceive();
 	size_t read(uint8_t *buffer, size_t len);